@@ -150,6 +150,20 @@ inline bool is_editor_hint() {
 	return is_editor(); // Alias
 }
 
+/// @brief Defer writes to objects until the current call returns, and have the host apply
+/// them all in one go, grouped by object. Deferred are the Node2D and Node3D position,
+/// rotation, scale and transform setters, Object::set() with names shorter than 24
+/// characters, and Node::queue_free(). Stays on for later calls until turned off.
+/// @param enabled True to start deferring writes. False applies the pending writes, and
+/// makes writes right away again.
+/// @note The Node2D and Node3D getters and Object::get() apply the pending writes first.
+/// Other calls see the old values until the writes are applied. An error in a deferred
+/// write is reported when it is applied, and does not stop the other writes.
+extern void set_deferred_writes(bool enabled);
+
+/// @brief Apply the pending deferred writes now. See set_deferred_writes().
+extern void flush_deferred_writes();
+
 /// @brief Load a resource (at run-time) from the given path. Can be denied.
 /// @param path The path to the resource.
 /// @return The loaded resource.
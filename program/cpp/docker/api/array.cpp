@@ -3,6 +3,7 @@
 #include "syscalls.h"
 
 MAKE_SYSCALL(ECALL_ARRAY_OPS, void, sys_array_ops, Array_Op, unsigned, int, Variant *);
+MAKE_SYSCALL(ECALL_ARRAY_OPS, unsigned, sys_array_range, Array_Op, unsigned, int, const Variant *, unsigned);
 MAKE_SYSCALL(ECALL_ARRAY_AT, void, sys_array_at, unsigned, int, Variant *);
 MAKE_SYSCALL(ECALL_ARRAY_SIZE, int, sys_array_size, unsigned);
 EXTERN_SYSCALL(unsigned, sys_vassign, unsigned, unsigned);
@@ -85,6 +86,14 @@ std::vector<Variant> Array::to_vector() const {
 	return result;
 }
 
+unsigned Array::get_range(int idx, Variant *values, unsigned count) const {
+	return sys_array_range(Array_Op::GET_SLICE, m_idx, idx, values, count);
+}
+
+void Array::set_range(int idx, const Variant *values, unsigned count) {
+	(void)sys_array_range(Array_Op::SET_SLICE, m_idx, idx, values, count);
+}
+
 
 ArrayProxy &ArrayProxy::operator=(const Variant &value) { // set
 	const int set_idx = -this->m_idx - 1;
@@ -37,6 +37,19 @@ struct Array {
 
 	std::vector<Variant> to_vector() const;
 
+	/// @brief Copy a range of elements into a buffer, all in one system call.
+	/// @param idx The index of the first element.
+	/// @param values The buffer to copy the elements into.
+	/// @param count The number of elements to copy.
+	/// @return The number of elements copied, which is less than count at the end of the array.
+	unsigned get_range(int idx, Variant *values, unsigned count) const;
+
+	/// @brief Assign a range of elements from a buffer, all in one system call.
+	/// @param idx The index of the first element. The range must be within the array.
+	/// @param values The values to assign.
+	/// @param count The number of values.
+	void set_range(int idx, const Variant *values, unsigned count);
+
 	// Array size
 	int size() const;
 	bool is_empty() const { return size() == 0; }
@@ -179,17 +192,30 @@ inline Variant Array::back() const {
 }
 
 
+// Elements are fetched a chunk at a time, so changes made to the array while iterating
+// over it may not be seen until the iterator reaches the next chunk.
 class ArrayIterator {
 public:
+	static constexpr unsigned CHUNK_SIZE = 32;
+
 	ArrayIterator(const Array &array, unsigned idx) : m_array(array), m_idx(idx) {}
 
 	bool operator!=(const ArrayIterator &other) const { return m_idx != other.m_idx; }
 	ArrayIterator &operator++() { m_idx++; return *this; }
-	Variant operator*() const { return m_array[m_idx]; }
+	const Variant &operator*() const {
+		if (m_idx - m_chunk_begin >= m_chunk_size) {
+			m_chunk_begin = m_idx;
+			m_chunk_size = m_array.get_range(m_idx, m_chunk, CHUNK_SIZE);
+		}
+		return m_chunk[m_idx - m_chunk_begin];
+	}
 
 private:
 	const Array m_array;
 	unsigned m_idx;
+	mutable unsigned m_chunk_begin = 0;
+	mutable unsigned m_chunk_size = 0;
+	mutable Variant m_chunk[CHUNK_SIZE];
 };
 
 inline auto Array::begin() {
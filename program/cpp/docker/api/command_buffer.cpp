@@ -0,0 +1,58 @@
+#include "command_buffer.hpp"
+
+#include "api.hpp"
+
+MAKE_SYSCALL(ECALL_COMMAND_BUFFER, void, sys_command_buffer, Command_Buffer_Op, CommandBuffer *);
+
+// 16KB, enough for a few hundred nodes per call before the buffer is applied early.
+static constexpr unsigned COMMAND_CAPACITY = 256;
+static Command commands[COMMAND_CAPACITY];
+
+namespace deferred {
+CommandBuffer buffer{ (unsigned long long)&commands[0], 0, 0 };
+
+Command *append(uint64_t object, Command_Op op) {
+	// A capacity of zero means writes are not being deferred.
+	if (buffer.capacity == 0) {
+		return nullptr;
+	}
+	if (UNLIKELY(buffer.count >= buffer.capacity)) {
+		flush();
+	}
+	// The host empties the buffer when flushing. If it did not, the caller
+	// falls back to a direct call rather than writing past the buffer.
+	if (UNLIKELY(buffer.count >= buffer.capacity || buffer.count >= COMMAND_CAPACITY)) {
+		return nullptr;
+	}
+	Command &cmd = commands[buffer.count++];
+	cmd.object = object;
+	cmd.op = op;
+	cmd.name_len = 0;
+	return &cmd;
+}
+
+void flush() {
+	sys_command_buffer(Command_Buffer_Op::FLUSH, nullptr);
+}
+} //namespace deferred
+
+void set_deferred_writes(bool enabled) {
+	if (enabled == (deferred::buffer.capacity != 0)) {
+		return;
+	}
+	if (enabled) {
+		deferred::buffer.count = 0;
+		deferred::buffer.capacity = COMMAND_CAPACITY;
+		sys_command_buffer(Command_Buffer_Op::SET, &deferred::buffer);
+	} else {
+		deferred::flush();
+		deferred::buffer.capacity = 0;
+		sys_command_buffer(Command_Buffer_Op::SET, nullptr);
+	}
+}
+
+void flush_deferred_writes() {
+	if (deferred::buffer.count != 0) {
+		deferred::flush();
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "syscalls.h"
+#include "variant.hpp"
+
+// Deferred writes, see set_deferred_writes() in api.hpp.
+namespace deferred {
+	extern CommandBuffer buffer;
+
+	/// @brief Append a command to the buffer, applying the buffer first when it is full.
+	/// @return The command to fill in, or nullptr when writes are not being deferred.
+	Command *append(uint64_t object, Command_Op op);
+
+	/// @brief Defer writing a value to an object.
+	/// @return The command, or nullptr when the write has to be made right away instead.
+	inline Command *write(uint64_t object, Command_Op op, const Variant &value) {
+		if constexpr (sizeof(Variant) != sizeof(Command::value)) {
+			return nullptr;
+		}
+		Command *cmd = append(object, op);
+		if (cmd != nullptr) {
+			__builtin_memcpy(cmd->value, &value, sizeof(cmd->value));
+		}
+		return cmd;
+	}
+
+	/// @brief Apply the pending writes now.
+	void flush();
+
+	/// @brief Apply the pending writes before something that has to come after them, such
+	/// as reading a value that they may change, or a write that is not deferred.
+	inline void sync() {
+		if (UNLIKELY(buffer.count != 0)) {
+			flush();
+		}
+	}
+} //namespace deferred
@@ -41,6 +41,15 @@ Variant Dictionary::get_or_add(const Variant &key, const Variant &default_value)
 	return v;
 }
 
+unsigned Dictionary::get_entries(const Variant *after, DictionaryEntry *entries, unsigned count) const {
+	static_assert(sizeof(DictionaryEntry) == 2 * sizeof(Variant), "DictionaryEntry must be a key/value pair of Variants");
+	return sys_dict_ops(Dictionary_Op::GET_ENTRIES, m_idx, entries, after, count);
+}
+
+void Dictionary::set_entries(const DictionaryEntry *entries, unsigned count) {
+	(void)sys_dict_ops(Dictionary_Op::SET_ENTRIES, m_idx, entries, nullptr, count);
+}
+
 void Dictionary::merge(const Dictionary &other) {
 	Variant v(other);
 	(void)sys_dict_ops(Dictionary_Op::MERGE, m_idx, &v);
@@ -2,6 +2,12 @@
 
 #include "variant.hpp"
 struct DictAccessor;
+class DictionaryIterator;
+
+struct DictionaryEntry {
+	Variant key;
+	Variant value;
+};
 
 struct Dictionary {
 	constexpr Dictionary() {} // DON'T TOUCH
@@ -33,6 +39,22 @@ struct Dictionary {
 	bool recursive_equal(const Dictionary &dictionary, int recursion_count) const;
 	Variant values() const;
 
+	/// @brief Copy a range of key/value pairs into a buffer, all in one system call.
+	/// @param after The key to continue after, in the order the Dictionary iterates them,
+	/// or nullptr to start from the first entry.
+	/// @param entries The buffer to copy the entries into.
+	/// @param count The number of entries to copy.
+	/// @return The number of entries copied, which is less than count at the end of the Dictionary.
+	unsigned get_entries(const Variant *after, DictionaryEntry *entries, unsigned count) const;
+
+	/// @brief Assign many key/value pairs from a buffer, all in one system call.
+	/// @param entries The key/value pairs to assign.
+	/// @param count The number of entries.
+	void set_entries(const DictionaryEntry *entries, unsigned count);
+
+	inline DictionaryIterator begin() const;
+	inline DictionaryIterator end() const;
+
 	// Call methods on the Dictionary
 	template <typename... Args>
 	Variant operator () (std::string_view method, Args&&... args);
@@ -89,6 +111,41 @@ inline DictAccessor Dictionary::operator[](const Variant &key) {
 	return DictAccessor(*this, key);
 }
 
+// Entries are fetched a chunk at a time, so changes made to the Dictionary while iterating
+// over it may not be seen until the iterator reaches the next chunk.
+class DictionaryIterator {
+public:
+	static constexpr unsigned CHUNK_SIZE = 32;
+
+	DictionaryIterator(const Dictionary &dict, unsigned idx) : m_dict(Dictionary::from_variant_index(dict.get_variant_index())), m_idx(idx) {}
+
+	bool operator!=(const DictionaryIterator &other) const { return m_idx != other.m_idx; }
+	DictionaryIterator &operator++() { m_idx++; return *this; }
+	const DictionaryEntry &operator*() const {
+		if (m_idx - m_chunk_begin >= m_chunk_size) {
+			// Continue after the last key of the previous chunk.
+			const Variant *after = m_chunk_size > 0 ? &m_chunk[m_chunk_size - 1].key : nullptr;
+			m_chunk_begin = m_idx;
+			m_chunk_size = m_dict.get_entries(after, m_chunk, CHUNK_SIZE);
+		}
+		return m_chunk[m_idx - m_chunk_begin];
+	}
+
+private:
+	const Dictionary m_dict;
+	unsigned m_idx;
+	mutable unsigned m_chunk_begin = 0;
+	mutable unsigned m_chunk_size = 0;
+	mutable DictionaryEntry m_chunk[CHUNK_SIZE];
+};
+
+inline DictionaryIterator Dictionary::begin() const {
+	return DictionaryIterator(*this, 0);
+}
+inline DictionaryIterator Dictionary::end() const {
+	return DictionaryIterator(*this, size());
+}
+
 template <typename... Args>
 inline Variant Dictionary::operator () (std::string_view method, Args&&... args) {
 	return Variant(*this).method_call(method, std::forward<Args>(args)...);
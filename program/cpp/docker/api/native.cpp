@@ -55,10 +55,6 @@
 #endif
 
 #if !WRAP_FANCY
-CREATE_SYSCALL(malloc, SYSCALL_MALLOC);
-CREATE_SYSCALL(calloc, SYSCALL_CALLOC);
-CREATE_SYSCALL(realloc, SYSCALL_REALLOC);
-CREATE_SYSCALL(free, SYSCALL_FREE);
 CREATE_SYSCALL(memset, SYSCALL_MEMSET);
 CREATE_SYSCALL(memcpy, SYSCALL_MEMCPY);
 CREATE_SYSCALL(memmove, SYSCALL_MEMMOVE);
@@ -66,31 +62,8 @@ CREATE_SYSCALL(memcmp, SYSCALL_MEMCMP);
 CREATE_SYSCALL(strlen, SYSCALL_STRLEN);
 CREATE_SYSCALL_STRCMP(strcmp, SYSCALL_STRCMP);
 CREATE_SYSCALL(strncmp, SYSCALL_STRCMP);
-
-extern "C" void *__wrap_malloc(size_t size) {
-	register void *ret __asm__("a0");
-	register size_t a0 __asm__("a0") = size;
-	register long syscall_id __asm__("a7") = SYSCALL_MALLOC;
-
-	asm volatile("ecall"
-				 : "=m"(*(char(*)[size])ret), "=r"(ret)
-				 : "r"(a0), "r"(syscall_id));
-	return ret;
-}
-extern "C" void __wrap_free(void *ptr) {
-	register void *a0 __asm__("a0") = ptr;
-	register long syscall_id __asm__("a7") = SYSCALL_FREE;
-
-	asm volatile("ecall"
-				 :
-				 : "r"(a0), "r"(syscall_id));
-}
 #else // WRAP_FANCY
 
-CREATE_SYSCALL(__wrap_malloc, SYSCALL_MALLOC);
-CREATE_SYSCALL(__wrap_calloc, SYSCALL_CALLOC);
-CREATE_SYSCALL(__wrap_realloc, SYSCALL_REALLOC);
-CREATE_SYSCALL(__wrap_free, SYSCALL_FREE);
 CREATE_SYSCALL(__wrap_memset, SYSCALL_MEMSET);
 CREATE_SYSCALL(__wrap_memcpy, SYSCALL_MEMCPY);
 CREATE_SYSCALL(__wrap_memmove, SYSCALL_MEMMOVE);
@@ -98,11 +71,194 @@ CREATE_SYSCALL(__wrap_memcmp, SYSCALL_MEMCMP);
 CREATE_SYSCALL(__wrap_strlen, SYSCALL_STRLEN);
 CREATE_SYSCALL_STRCMP(__wrap_strcmp, SYSCALL_STRCMP);
 CREATE_SYSCALL_STRCMP(__wrap_strncmp, SYSCALL_STRCMP);
-
-extern "C" void *__wrap_malloc(size_t size);
-extern "C" void __wrap_free(void *ptr);
 #endif // WRAP_FANCY
 
+// The host heap. Large blocks come from here, and so do the regions that small blocks are
+// handed out from.
+CREATE_SYSCALL(sys_host_malloc, SYSCALL_MALLOC);
+CREATE_SYSCALL(sys_host_calloc, SYSCALL_CALLOC);
+CREATE_SYSCALL(sys_host_realloc, SYSCALL_REALLOC);
+CREATE_SYSCALL(sys_host_free, SYSCALL_FREE);
+extern "C" void *sys_host_malloc(size_t size);
+extern "C" void *sys_host_calloc(size_t count, size_t size);
+extern "C" void *sys_host_realloc(void *ptr, size_t size);
+extern "C" void sys_host_free(void *ptr);
+
+/**
+ * Small blocks never leave the guest: every allocation and free would otherwise be a
+ * system call, and programs that build strings or grow vectors make a great many of them.
+ * Each size class keeps a list of its free blocks, and carves new ones out of a page of
+ * its own when the list is empty. Pages come from regions taken from the host heap, and
+ * are never given back, nor handed to another class.
+ *
+ * A pointer that is not inside a region came from the host heap, either from here or
+ * from the host itself (eg. a std::string it filled in), and goes back there.
+ **/
+extern "C" {
+GuestHeapStats __sandbox_heap = {};
+}
+
+namespace {
+static constexpr size_t HEAP_PAGE_SIZE = 4096;
+static constexpr size_t REGION_PAGES = 64;
+static constexpr size_t REGION_SIZE = REGION_PAGES * HEAP_PAGE_SIZE;
+static constexpr size_t MAX_REGIONS = 16;
+static constexpr size_t SMALL_MAX = 1024;
+// Multiples of 16, for malloc()'s alignment. The powers of two are aligned to their size.
+static constexpr unsigned short CLASS_SIZES[] = { 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024 };
+static constexpr size_t NUM_CLASSES = sizeof(CLASS_SIZES) / sizeof(CLASS_SIZES[0]);
+
+// The size class for each size, rounded up to 16.
+struct SizeClassIndex {
+	unsigned char index[SMALL_MAX / 16 + 1];
+	constexpr SizeClassIndex() : index() {
+		unsigned c = 0;
+		for (size_t i = 0; i <= SMALL_MAX / 16; i++) {
+			while (CLASS_SIZES[c] < i * 16)
+				c++;
+			index[i] = c;
+		}
+	}
+};
+static constexpr SizeClassIndex size_class_index;
+
+struct FreeBlock {
+	FreeBlock *next;
+};
+struct SizeClass {
+	FreeBlock *free;
+	char *next; // The rest of the page being carved up.
+	char *end;
+};
+static SizeClass classes[NUM_CLASSES];
+static char *regions[MAX_REGIONS];
+static unsigned char page_classes[MAX_REGIONS][REGION_PAGES];
+static unsigned region_count = 0;
+static unsigned next_page = REGION_PAGES; // In the last region.
+
+static inline int find_region(const void *ptr) {
+	for (unsigned r = 0; r < region_count; r++) {
+		if (uintptr_t(ptr) - uintptr_t(regions[r]) < REGION_SIZE)
+			return r;
+	}
+	return -1;
+}
+
+static inline unsigned class_of(int region, const void *ptr) {
+	return page_classes[region][(uintptr_t(ptr) - uintptr_t(regions[region])) / HEAP_PAGE_SIZE];
+}
+
+static bool add_page(unsigned c) {
+	GuestHeapStats &heap = __sandbox_heap;
+	if (next_page == REGION_PAGES) {
+		if (region_count == MAX_REGIONS)
+			return false;
+		// The host heap only aligns to 16 bytes, and pages are found by their address.
+		void *raw = sys_host_malloc(REGION_SIZE + HEAP_PAGE_SIZE);
+		if (raw == nullptr)
+			return false;
+		regions[region_count++] = (char *)((uintptr_t(raw) + HEAP_PAGE_SIZE - 1) & ~uintptr_t(HEAP_PAGE_SIZE - 1));
+		next_page = 0;
+		heap.region_bytes += REGION_SIZE + HEAP_PAGE_SIZE;
+		heap.regions++;
+	}
+	page_classes[region_count - 1][next_page] = c;
+	char *page = regions[region_count - 1] + next_page * HEAP_PAGE_SIZE;
+	next_page++;
+	classes[c].next = page;
+	classes[c].end = page + HEAP_PAGE_SIZE - HEAP_PAGE_SIZE % CLASS_SIZES[c];
+	return true;
+}
+
+static void *small_malloc(size_t size) {
+	GuestHeapStats &heap = __sandbox_heap;
+	if (heap.max_blocks != 0 && heap.live_blocks >= heap.max_blocks)
+		return nullptr;
+	const unsigned c = size_class_index.index[(size + 15) / 16];
+	SizeClass &sc = classes[c];
+	void *block = sc.free;
+	if (block != nullptr) {
+		sc.free = sc.free->next;
+	} else {
+		if (sc.next == sc.end && !add_page(c))
+			return sys_host_malloc(size);
+		block = sc.next;
+		sc.next += CLASS_SIZES[c];
+	}
+	heap.live_blocks++;
+	heap.live_bytes += CLASS_SIZES[c];
+	heap.allocations++;
+	return block;
+}
+
+static void small_free(int region, void *ptr) {
+	GuestHeapStats &heap = __sandbox_heap;
+	const unsigned c = class_of(region, ptr);
+	FreeBlock *block = (FreeBlock *)ptr;
+	block->next = classes[c].free;
+	classes[c].free = block;
+	heap.live_blocks--;
+	heap.live_bytes -= CLASS_SIZES[c];
+	heap.deallocations++;
+}
+} //namespace
+
+extern "C" void *__wrap_malloc(size_t size) {
+	if (size <= SMALL_MAX)
+		return small_malloc(size);
+	return sys_host_malloc(size);
+}
+extern "C" void *__wrap_calloc(size_t count, size_t size) {
+	size_t bytes;
+	if (__builtin_mul_overflow(count, size, &bytes))
+		return nullptr;
+	if (bytes > SMALL_MAX)
+		return sys_host_calloc(count, size);
+	void *ptr = small_malloc(bytes);
+	if (ptr != nullptr)
+		__builtin_memset(ptr, 0, bytes);
+	return ptr;
+}
+extern "C" void *__wrap_realloc(void *ptr, size_t size) {
+	const int region = find_region(ptr);
+	if (region < 0) {
+		return (ptr != nullptr) ? sys_host_realloc(ptr, size) : __wrap_malloc(size);
+	}
+	const size_t old_size = CLASS_SIZES[class_of(region, ptr)];
+	if (size <= old_size)
+		return ptr;
+	void *result = __wrap_malloc(size);
+	if (result != nullptr) {
+		__builtin_memcpy(result, ptr, old_size);
+		small_free(region, ptr);
+	}
+	return result;
+}
+extern "C" void __wrap_free(void *ptr) {
+	const int region = find_region(ptr);
+	if (region >= 0) {
+		small_free(region, ptr);
+	} else if (ptr != nullptr) {
+		sys_host_free(ptr);
+	}
+}
+
+#if !WRAP_FANCY
+// Without --wrap, the allocator takes the place of the C library's.
+extern "C" void *malloc(size_t size) {
+	return __wrap_malloc(size);
+}
+extern "C" void *calloc(size_t count, size_t size) {
+	return __wrap_calloc(count, size);
+}
+extern "C" void *realloc(void *ptr, size_t size) {
+	return __wrap_realloc(ptr, size);
+}
+extern "C" void free(void *ptr) {
+	__wrap_free(ptr);
+}
+#endif
+
 // extern "C" void *__wrap_memset(void *vdest, const int ch, size_t size) {
 // 	register char *a0 __asm__("a0") = (char *)vdest;
 // 	register int a1 __asm__("a1") = ch;
@@ -197,12 +353,25 @@ extern "C" void *memalign(size_t alignment, size_t size) {
 	if (alignment <= 16) {
 		return __wrap_malloc(size);
 	}
+	if (alignment <= SMALL_MAX && size <= SMALL_MAX) {
+		// Blocks of a power-of-two size class are aligned to their size.
+		size_t block = alignment;
+		while (block < size)
+			block *= 2;
+		void *result = __wrap_malloc(block);
+		if (result == nullptr || (uintptr_t)result % alignment == 0) {
+			return result;
+		}
+		__wrap_free(result);
+	}
 
+	// Only the host heap can be coaxed into larger alignments.
+	const size_t host_size = (size > SMALL_MAX) ? size : SMALL_MAX + 1;
 	std::array<void *, 16> list;
 	size_t i = 0;
 	void *result = nullptr;
 	for (i = 0; i < list.size(); i++) {
-		result = __wrap_malloc(size);
+		result = __wrap_malloc(host_size);
 		list[i] = result;
 		const bool aligned = ((uintptr_t)result % alignment) == 0;
 		if (result && aligned) {
@@ -1,5 +1,6 @@
 #include "node.hpp"
 
+#include "command_buffer.hpp"
 #include "syscalls.h"
 
 MAKE_SYSCALL(ECALL_GET_NODE, uint64_t, sys_get_node, uint64_t, const char *, size_t);
@@ -90,7 +91,14 @@ Node Node::get_node(std::string_view name) const {
 	return Node(sys_fast_get_node(address(), name.begin(), name.size()));
 }
 
+Node Node::get_node(Name path) const {
+	return Node(sys_fast_get_node(address(), path.data(), Name::HANDLE_LENGTH));
+}
+
 void Node::queue_free() {
+	if (deferred::append(address(), Command_Op::QUEUE_FREE) != nullptr) {
+		return;
+	}
 	sys_node(Node_Op::QUEUE_FREE, address(), nullptr);
 	//this->m_address = 0;
 }
@@ -37,6 +37,16 @@ struct Node : public Object {
 		return T(get_node(path));
 	}
 
+	/// @brief Get the Node object at an interned path, see Name::node_path().
+	/// @param path The interned path to the Node object, relative to this node.
+	/// @return The Node object.
+	Node get_node(Name path) const;
+
+	template <typename T>
+	T get_node(Name path) const {
+		return T(get_node(path));
+	}
+
 	/// @brief Get the number of children of the node.
 	/// @return The number of children.
 	unsigned get_child_count() const;
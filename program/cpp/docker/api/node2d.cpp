@@ -1,5 +1,6 @@
 #include "node2d.hpp"
 
+#include "command_buffer.hpp"
 #include "syscalls.h"
 #include "transform2d.hpp"
 
@@ -12,57 +13,69 @@ static inline void node2d(Node2D_Op op, uint64_t address, const Variant &value)
 	sys_node2d(op, address, const_cast<Variant *>(&value));
 }
 
+static inline void node2d_get(Node2D_Op op, uint64_t address, Variant &value) {
+	deferred::sync();
+	sys_node2d(op, address, &value);
+}
+
+static inline void node2d_set(Node2D_Op op, Command_Op deferred_op, uint64_t address, const Variant &value) {
+	if (!deferred::write(address, deferred_op, value)) {
+		node2d(op, address, value);
+	}
+}
+
 Vector2 Node2D::get_position() const {
 	Variant var;
-	node2d(Node2D_Op::GET_POSITION, address(), var);
+	node2d_get(Node2D_Op::GET_POSITION, address(), var);
 	return var.v2();
 }
 
 void Node2D::set_position(const Vector2 &position) {
 	Variant value(position);
-	node2d(Node2D_Op::SET_POSITION, address(), value);
+	node2d_set(Node2D_Op::SET_POSITION, Command_Op::NODE2D_SET_POSITION, address(), value);
 }
 
 float Node2D::get_rotation() const {
 	Variant var;
-	node2d(Node2D_Op::GET_ROTATION, address(), var);
+	node2d_get(Node2D_Op::GET_ROTATION, address(), var);
 	return var.operator float();
 }
 
 void Node2D::set_rotation(real_t angle) {
 	Variant value(angle);
-	node2d(Node2D_Op::SET_ROTATION, address(), value);
+	node2d_set(Node2D_Op::SET_ROTATION, Command_Op::NODE2D_SET_ROTATION, address(), value);
 }
 
 Vector2 Node2D::get_scale() const {
 	Variant var;
-	node2d(Node2D_Op::GET_SCALE, address(), var);
+	node2d_get(Node2D_Op::GET_SCALE, address(), var);
 	return var.v2();
 }
 
 void Node2D::set_scale(const Vector2 &scale) {
 	Variant value(scale);
-	node2d(Node2D_Op::SET_SCALE, address(), value);
+	node2d_set(Node2D_Op::SET_SCALE, Command_Op::NODE2D_SET_SCALE, address(), value);
 }
 
 float Node2D::get_skew() const {
 	Variant var;
-	node2d(Node2D_Op::GET_SKEW, address(), var);
+	node2d_get(Node2D_Op::GET_SKEW, address(), var);
 	return var.operator float();
 }
 
 void Node2D::set_skew(const Variant &value) {
+	deferred::sync();
 	node2d(Node2D_Op::SET_SKEW, address(), value);
 }
 
 void Node2D::set_transform(const Transform2D &value) {
 	Variant var(value);
-	node2d(Node2D_Op::SET_TRANSFORM, address(), var);
+	node2d_set(Node2D_Op::SET_TRANSFORM, Command_Op::NODE2D_SET_TRANSFORM, address(), var);
 }
 
 Transform2D Node2D::get_transform() const {
 	Variant var;
-	node2d(Node2D_Op::GET_TRANSFORM, address(), var);
+	node2d_get(Node2D_Op::GET_TRANSFORM, address(), var);
 	return var.as_transform2d();
 }
 
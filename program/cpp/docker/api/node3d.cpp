@@ -1,5 +1,6 @@
 #include "node3d.hpp"
 
+#include "command_buffer.hpp"
 #include "quaternion.hpp"
 #include "syscalls.h"
 #include "transform3d.hpp"
@@ -13,34 +14,45 @@ static inline void node3d(Node3D_Op op, uint64_t address, const Variant &value)
 	sys_node3d(op, address, const_cast<Variant *>(&value));
 }
 
+static inline void node3d_get(Node3D_Op op, uint64_t address, Variant &value) {
+	deferred::sync();
+	sys_node3d(op, address, &value);
+}
+
+static inline void node3d_set(Node3D_Op op, Command_Op deferred_op, uint64_t address, const Variant &value) {
+	if (!deferred::write(address, deferred_op, value)) {
+		node3d(op, address, value);
+	}
+}
+
 Vector3 Node3D::get_position() const {
 	Variant var;
-	node3d(Node3D_Op::GET_POSITION, address(), var);
+	node3d_get(Node3D_Op::GET_POSITION, address(), var);
 	return var.v3();
 }
 
 void Node3D::set_position(const Variant &value) {
-	node3d(Node3D_Op::SET_POSITION, address(), value);
+	node3d_set(Node3D_Op::SET_POSITION, Command_Op::NODE3D_SET_POSITION, address(), value);
 }
 
 Vector3 Node3D::get_rotation() const {
 	Variant var;
-	node3d(Node3D_Op::GET_ROTATION, address(), var);
+	node3d_get(Node3D_Op::GET_ROTATION, address(), var);
 	return var.v3();
 }
 
 void Node3D::set_rotation(const Variant &value) {
-	node3d(Node3D_Op::SET_ROTATION, address(), value);
+	node3d_set(Node3D_Op::SET_ROTATION, Command_Op::NODE3D_SET_ROTATION, address(), value);
 }
 
 Vector3 Node3D::get_scale() const {
 	Variant var;
-	node3d(Node3D_Op::GET_SCALE, address(), var);
+	node3d_get(Node3D_Op::GET_SCALE, address(), var);
 	return var.v3();
 }
 
 void Node3D::set_scale(const Variant &value) {
-	node3d(Node3D_Op::SET_SCALE, address(), value);
+	node3d_set(Node3D_Op::SET_SCALE, Command_Op::NODE3D_SET_SCALE, address(), value);
 }
 
 Node3D Node3D::duplicate(int flags) const {
@@ -53,22 +65,23 @@ Node3D Node3D::Create(std::string_view path) {
 
 Transform3D Node3D::get_transform() const {
 	Variant var;
-	sys_node3d(Node3D_Op::GET_TRANSFORM, address(), &var);
+	node3d_get(Node3D_Op::GET_TRANSFORM, address(), var);
 	return var.as_transform3d();
 }
 
 void Node3D::set_transform(const Transform3D &value) {
 	Variant var(value);
-	sys_node3d(Node3D_Op::SET_TRANSFORM, address(), &var);
+	node3d_set(Node3D_Op::SET_TRANSFORM, Command_Op::NODE3D_SET_TRANSFORM, address(), var);
 }
 
 Quaternion Node3D::get_quaternion() const {
 	Variant var;
-	sys_node3d(Node3D_Op::GET_QUATERNION, address(), &var);
+	node3d_get(Node3D_Op::GET_QUATERNION, address(), var);
 	return var;
 }
 
 void Node3D::set_quaternion(const Quaternion &value) {
 	Variant var(value);
+	deferred::sync();
 	sys_node3d(Node3D_Op::SET_QUATERNION, address(), &var);
 }
@@ -1,5 +1,6 @@
 #include "object.hpp"
 
+#include "command_buffer.hpp"
 #include "syscalls.h"
 #include "variant.hpp"
 #include <stdexcept>
@@ -9,8 +10,11 @@ MAKE_SYSCALL(ECALL_OBJ, void, sys_obj, Object_Op, uint64_t, Variant *);
 MAKE_SYSCALL(ECALL_OBJ_CALLP, void, sys_obj_callp, uint64_t, const char *, size_t, bool, Variant *, const Variant *, unsigned);
 MAKE_SYSCALL(ECALL_OBJ_PROP_GET, void, sys_obj_property_get, uint64_t, const char *, size_t, Variant *);
 MAKE_SYSCALL(ECALL_OBJ_PROP_SET, void, sys_obj_property_set, uint64_t, const char *, size_t, const Variant *);
+MAKE_SYSCALL(ECALL_INTERN_NAME, unsigned, sys_intern_name, const char *, size_t, Variant::Type);
 
 static_assert(sizeof(std::vector<std::string>) == 24, "std::vector<std::string> is not 24 bytes");
+static_assert(sizeof(PtrCallValue) == sizeof(PtrCallSlot), "PtrCallValue must match PtrCallSlot");
+static_assert(Name::HANDLE_LENGTH == ECALL_NAME_IS_HANDLE, "Name::HANDLE_LENGTH must match ECALL_NAME_IS_HANDLE");
 
 Object::Object(const std::string &name) :
 		m_address{ sys_get_obj(name.c_str(), name.size()) } {
@@ -26,14 +30,35 @@ std::vector<std::string> Object::get_method_list() const {
 	}
 }
 
+Name Name::intern(std::string_view name) {
+	Name result;
+	result.m_handle = sys_intern_name(name.data(), name.size(), Variant::STRING_NAME);
+	return result;
+}
+
+Name Name::node_path(std::string_view path) {
+	Name result;
+	result.m_handle = sys_intern_name(path.data(), path.size(), Variant::NODE_PATH);
+	return result;
+}
+
 Variant Object::get(std::string_view name) const {
+	return get(name.data(), name.size());
+}
+
+Variant Object::get(Name name) const {
+	return get(name.data(), Name::HANDLE_LENGTH);
+}
+
+Variant Object::get(const char *name, size_t name_len) const {
 	Variant var;
+	deferred::sync();
 #if 0
-	sys_obj_property_get(address(), name.data(), name.size(), &var);
+	sys_obj_property_get(address(), name, name_len, &var);
 #else
 	register uint64_t object asm("a0") = address();
-	register const char *property asm("a1") = name.data();
-	register size_t property_size asm("a2") = name.size();
+	register const char *property asm("a1") = name;
+	register size_t property_size asm("a2") = name_len;
 	register Variant *var_ptr asm("a3") = &var;
 	register int syscall_number asm("a7") = ECALL_OBJ_PROP_GET;
 
@@ -47,12 +72,28 @@ Variant Object::get(std::string_view name) const {
 }
 
 void Object::set(std::string_view name, const Variant &value) {
+	if (name.size() < sizeof(Command::name)) {
+		if (Command *cmd = deferred::write(address(), Command_Op::OBJ_PROP_SET, value)) {
+			__builtin_memcpy(cmd->name, name.data(), name.size());
+			cmd->name_len = name.size();
+			return;
+		}
+	}
+	set(name.data(), name.size(), value);
+}
+
+void Object::set(Name name, const Variant &value) {
+	set(name.data(), Name::HANDLE_LENGTH, value);
+}
+
+void Object::set(const char *name, size_t name_len, const Variant &value) {
+	deferred::sync();
 #if 0
-	sys_obj_property_set(address(), name.data(), name.size(), &value);
+	sys_obj_property_set(address(), name, name_len, &value);
 #else
 	register uint64_t object asm("a0") = address();
-	register const char *property asm("a1") = name.data();
-	register size_t property_size asm("a2") = name.size();
+	register const char *property asm("a1") = name;
+	register size_t property_size asm("a2") = name_len;
 	register const Variant *value_ptr asm("a3") = &value;
 	register int syscall_number asm("a7") = ECALL_OBJ_PROP_SET;
 
@@ -2,6 +2,32 @@
 #include "callable.hpp"
 #include "string.hpp"
 #include "syscalls_fwd.hpp"
+#include <type_traits>
+
+// An argument or return value of Object::ptrcall(), the same as PtrCallSlot in syscalls.h.
+struct PtrCallValue {
+	uint64_t data[2];
+};
+
+/// @brief A method or property name, or a node path, interned once on the host.
+/// @note Passing a Name instead of a string spares the host from reading and looking up
+/// the name on every call. Interned names live as long as the program, so intern each name
+/// once and keep it, eg. in a static variable.
+struct Name {
+	/// @brief Intern a method or property name.
+	static Name intern(std::string_view name);
+	/// @brief Intern a node path, for Node::get_node().
+	static Name node_path(std::string_view path);
+
+	/// @brief The handle of the name, passed in place of the address of its characters.
+	unsigned handle() const noexcept { return m_handle; }
+	const char *data() const noexcept { return (const char *)uintptr_t(m_handle); }
+	/// @brief Passed in place of the length of the name, the same as ECALL_NAME_IS_HANDLE.
+	static constexpr size_t HANDLE_LENGTH = 0xFFFFFFFF;
+
+private:
+	unsigned m_handle = 0;
+};
 
 struct Object {
 	/// @brief Construct an Object object from an allowed global object.
@@ -24,21 +50,42 @@ struct Object {
 	/// @param args The arguments to pass to the method.
 	void voidcallv(std::string_view method, bool deferred, const Variant *argv, unsigned argc);
 
+	/// Call a method on the node by an interned name, see Name.
+	Variant callv(Name method, bool deferred, const Variant *argv, unsigned argc);
+	void voidcallv(Name method, bool deferred, const Variant *argv, unsigned argc);
+
 	template <typename... Args>
 	Variant call(std::string_view method, Args... args);
 
+	template <typename... Args>
+	Variant call(Name method, Args... args);
+
 	template <typename... Args>
 	Variant call(std::string_view method, Args... args) const;
 
 	template <typename... Args>
 	void voidcall(std::string_view method, Args... args);
 
+	template <typename... Args>
+	void voidcall(Name method, Args... args);
+
 	template <typename... Args>
 	Variant operator () (std::string_view method, Args... args);
 
 	template <typename... Args>
 	void call_deferred(std::string_view method, Args... args);
 
+	/// @brief Call an engine method with its arguments and return value in native form,
+	/// without creating any Variants.
+	/// @tparam R The return type of the method, or void.
+	/// @param method The method to call.
+	/// @param hash The hash of the method, which the host checks the method against.
+	/// @param args The arguments to pass to the method. Default arguments must be passed too.
+	/// @note The generated API uses this for methods that take and return plain values.
+	/// Unlike call(), this does not call a method of the same name in the object's script.
+	template <typename R, typename... Args>
+	R ptrcall(std::string_view method, uint32_t hash, Args... args);
+
 	/// @brief Get a list of methods available on the object.
 	/// @return A list of method names.
 	std::vector<std::string> get_method_list() const;
@@ -47,11 +94,13 @@ struct Object {
 	/// @param name The name of the property.
 	/// @return The value of the property.
 	Variant get(std::string_view name) const;
+	Variant get(Name name) const;
 
 	/// @brief Set a property of the object.
 	/// @param name The name of the property.
 	/// @param value The value to set the property to.
 	void set(std::string_view name, const Variant &value);
+	void set(Name name, const Variant &value);
 
 	/// @brief Assign a value to a property of the object, at the end of the frame.
 	/// @param property The name of the property.
@@ -162,6 +211,12 @@ struct Object {
 
 protected:
 	uint64_t m_address;
+
+private:
+	Variant callv(const char *method, size_t method_len, bool deferred, const Variant *argv, unsigned argc);
+	void voidcallv(const char *method, size_t method_len, bool deferred, const Variant *argv, unsigned argc);
+	Variant get(const char *name, size_t name_len) const;
+	void set(const char *name, size_t name_len, const Variant &value);
 };
 
 inline Object Variant::as_object() const {
@@ -202,6 +257,80 @@ inline void Object::voidcall(std::string_view method, Args... args) {
 	this->voidcallv(method, false, argv, sizeof...(Args));
 }
 
+template <typename... Args>
+inline Variant Object::call(Name method, Args... args) {
+	Variant argv[] = {args...};
+	return callv(method, false, argv, sizeof...(Args));
+}
+
+template <typename... Args>
+inline void Object::voidcall(Name method, Args... args) {
+	Variant argv[] = {args...};
+	this->voidcallv(method, false, argv, sizeof...(Args));
+}
+
+template <typename T>
+inline void ptrcall_store(PtrCallValue &slot, const T &value) {
+	if constexpr (std::is_base_of_v<Object, T>) {
+		slot.data[0] = value.address();
+	} else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+		slot.data[0] = int64_t(value);
+	} else if constexpr (std::is_floating_point_v<T>) {
+		const double d = value;
+		__builtin_memcpy(slot.data, &d, sizeof(d));
+	} else {
+		static_assert(sizeof(T) <= sizeof(slot.data), "Type is too large to be passed with ptrcall");
+		__builtin_memcpy(slot.data, &value, sizeof(T));
+	}
+}
+
+template <typename T>
+inline T ptrcall_load(const PtrCallValue &slot) {
+	if constexpr (std::is_same_v<T, bool>) {
+		return slot.data[0] != 0;
+	} else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+		return T(int64_t(slot.data[0]));
+	} else if constexpr (std::is_floating_point_v<T>) {
+		double d;
+		__builtin_memcpy(&d, slot.data, sizeof(d));
+		return T(d);
+	} else {
+		static_assert(sizeof(T) <= sizeof(slot.data), "Type is too large to be returned with ptrcall");
+		T value;
+		__builtin_memcpy(&value, slot.data, sizeof(T));
+		return value;
+	}
+}
+
+// The system call is made inline, like in callv(), as the host caches the method per call site.
+template <typename R, typename... Args>
+inline R Object::ptrcall(std::string_view method, uint32_t hash, Args... args) {
+	static constexpr int ECALL_OBJ_PTRCALL = 552; // Call a method with native arguments
+	PtrCallValue argv[sizeof...(Args) + 1];
+	unsigned i = 0;
+	(ptrcall_store(argv[i++], args), ...);
+	(void)i;
+	PtrCallValue ret;
+
+	register uint64_t object asm("a0") = address();
+	register const char *method_ptr asm("a1") = method.begin();
+	register size_t method_size asm("a2") = method.size();
+	register uint32_t hash_reg asm("a3") = hash;
+	register const PtrCallValue *argv_ptr asm("a4") = argv;
+	register unsigned argc_reg asm("a5") = sizeof...(Args);
+	register PtrCallValue *ret_ptr asm("a6") = std::is_void_v<R> ? nullptr : &ret;
+	register int syscall_number asm("a7") = ECALL_OBJ_PTRCALL;
+
+	asm volatile(
+		"ecall"
+		: "=m"(ret)
+		: "r"(object), "r"(method_ptr), "r"(method_size), "r"(hash_reg), "r"(argv_ptr), "m"(argv), "r"(argc_reg), "r"(ret_ptr), "r"(syscall_number)
+	);
+	if constexpr (!std::is_void_v<R>) {
+		return ptrcall_load<R>(ret);
+	}
+}
+
 template <typename... Args>
 inline Variant Object::operator () (std::string_view method, Args... args) {
 	return call(method, args...);
@@ -220,14 +349,27 @@ inline void Object::disconnect(const std::string &signal, std::string_view metho
 	this->disconnect(*this, signal, method);
 }
 
-// This is one of the most heavily used functions in the API, so it's worth optimizing.
 inline Variant Object::callv(std::string_view method, bool deferred, const Variant *argv, unsigned argc) {
+	return callv(method.begin(), method.size(), deferred, argv, argc);
+}
+inline Variant Object::callv(Name method, bool deferred, const Variant *argv, unsigned argc) {
+	return callv(method.data(), Name::HANDLE_LENGTH, deferred, argv, argc);
+}
+inline void Object::voidcallv(std::string_view method, bool deferred, const Variant *argv, unsigned argc) {
+	voidcallv(method.begin(), method.size(), deferred, argv, argc);
+}
+inline void Object::voidcallv(Name method, bool deferred, const Variant *argv, unsigned argc) {
+	voidcallv(method.data(), Name::HANDLE_LENGTH, deferred, argv, argc);
+}
+
+// This is one of the most heavily used functions in the API, so it's worth optimizing.
+inline Variant Object::callv(const char *method, size_t method_len, bool deferred, const Variant *argv, unsigned argc) {
 	static constexpr int ECALL_OBJ_CALLP = 506; // Call a method on an object
 	Variant var;
 	// We will attempt to call the method using inline assembly.
 	register uint64_t object asm("a0") = address();
-	register const char *method_ptr asm("a1") = method.begin();
-	register size_t method_size asm("a2") = method.size();
+	register const char *method_ptr asm("a1") = method;
+	register size_t method_size asm("a2") = method_len;
 	register bool deferred_flag asm("a3") = deferred;
 	register Variant *var_ptr asm("a4") = &var;
 	register const Variant *argv_ptr asm("a5") = argv;
@@ -243,12 +385,12 @@ inline Variant Object::callv(std::string_view method, bool deferred, const Varia
 }
 
 // This variation of the function is used when the return value is not needed. We simply don't pass a pointer to the return value.
-inline void Object::voidcallv(std::string_view method, bool deferred, const Variant *argv, unsigned argc) {
+inline void Object::voidcallv(const char *method, size_t method_len, bool deferred, const Variant *argv, unsigned argc) {
 	static constexpr int ECALL_OBJ_CALLP = 506; // Call a method on an object
 	// We will attempt to call the method using inline assembly.
 	register uint64_t object asm("a0") = address();
-	register const char *method_ptr asm("a1") = method.begin();
-	register size_t method_size asm("a2") = method.size();
+	register const char *method_ptr asm("a1") = method;
+	register size_t method_size asm("a2") = method_len;
 	register bool deferred_flag asm("a3") = deferred;
 	register Variant *var_ptr asm("a4") = nullptr;
 	register const Variant *argv_ptr asm("a5") = argv;
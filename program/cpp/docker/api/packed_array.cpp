@@ -1,10 +1,25 @@
 #include "variant.hpp"
 
-#include "syscalls_fwd.hpp"
+#include "syscalls.h"
 
 EXTERN_SYSCALL(void, sys_vcreate, Variant *, int, int, const void *);
 EXTERN_SYSCALL(void, sys_vstore, unsigned *, Variant::Type, const void *, size_t);
 EXTERN_SYSCALL(void, sys_vfetch, unsigned, void *, int);
+MAKE_SYSCALL(ECALL_PACKED_ARRAY_OPS, void, sys_packed_array_ops, PackedArray_Op, ...);
+
+static_assert(sizeof(PackedArray<float>::View) == sizeof(PackedArrayView), "PackedArray views must match the host");
+
+void packed_array_map(unsigned idx, bool writable, void *view) {
+	sys_packed_array_ops(PackedArray_Op::MAP, idx, writable, view);
+}
+
+void packed_array_commit(const void *data) {
+	sys_packed_array_ops(PackedArray_Op::COMMIT, data);
+}
+
+void packed_array_unmap(const void *data) {
+	sys_packed_array_ops(PackedArray_Op::UNMAP, data);
+}
 
 template <>
 PackedArray<uint8_t>::PackedArray(const std::vector<uint8_t> &data) {
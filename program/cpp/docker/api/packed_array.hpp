@@ -5,6 +5,11 @@
 #include "vector.hpp"
 struct Variant;
 
+// Implemented in packed_array.cpp, see PackedArray<T>::map().
+void packed_array_map(unsigned idx, bool writable, void *view);
+void packed_array_commit(const void *data);
+void packed_array_unmap(const void *data);
+
 /**
  * @brief A reference to a host-side Packed Array.
  * Supported:
@@ -58,6 +63,40 @@ struct PackedArray {
 	/// @param data The data to store.
 	void store(const T *data, size_t size);
 
+	/// @brief The host-side array, mapped into guest memory. See map().
+	struct View {
+		T *data() const noexcept { return m_data; }
+		size_t size() const noexcept { return m_size; }
+		bool is_empty() const noexcept { return m_size == 0; }
+		T *begin() const noexcept { return m_data; }
+		T *end() const noexcept { return m_data + m_size; }
+		T &operator[](size_t idx) const { return m_data[idx]; }
+
+		/// @brief Make the writes through a writable view visible to the host.
+		void commit() const { if (m_data) packed_array_commit(m_data); }
+		/// @brief Remove the view, committing it if writable. The view may not be used after.
+		void unmap() { if (m_data) packed_array_unmap(m_data); m_data = nullptr; m_size = 0; }
+
+	private:
+		// The layout of PackedArrayView in syscalls.h.
+		T *m_data = nullptr;
+		size_t m_size = 0;
+	};
+
+	/// @brief Map the host-side array into guest memory, to work on it in place instead of
+	/// fetching a copy and storing it back. Unmapped when the current call returns.
+	/// @param writable If true, writes through the view change the host-side array, and
+	/// are all visible to the host after commit() or unmap(), or when the call returns.
+	/// @return The view, which is empty when the array is.
+	/// @note Changing the array by other means, eg. resizing it, while it is mapped leaves
+	/// the view with the storage the array had before.
+	View map(bool writable = false) const {
+		static_assert(!std::is_same_v<T, std::string>, "PackedStringArray cannot be mapped");
+		View view;
+		packed_array_map(m_idx, writable, &view);
+		return view;
+	}
+
 	/// @brief Call a method on the packed array.
 	/// @tparam Args The method arguments.
 	template <typename... Args>
@@ -79,7 +79,23 @@
 // Channelled print (printerr, prints, push_error, ...). See Print_Channel.
 #define ECALL_PRINT_CHANNEL (GAME_API_BASE + 50)
 
-#define ECALL_LAST (GAME_API_BASE + 51)
+// Deferred writes to objects, see Command_Buffer_Op and Command below.
+#define ECALL_COMMAND_BUFFER (GAME_API_BASE + 51)
+
+// Call an engine method through its method bind, with native arguments, see PtrCallSlot.
+#define ECALL_OBJ_PTRCALL (GAME_API_BASE + 52)
+
+// Intern a name as a permanent StringName or NodePath, and get a handle to it. Object calls,
+// property access and get_node() take the handle in place of the name's address, along with
+// a name length of ECALL_NAME_IS_HANDLE.
+#define ECALL_INTERN_NAME (GAME_API_BASE + 53)
+#define ECALL_NAME_IS_HANDLE (0xFFFFFFFFu)
+
+// Release a permanent Variant, so that its slot can hold another one. Copies of the handle
+// stop working, see Sandbox::release_permanent_variant().
+#define ECALL_VRELEASE (GAME_API_BASE + 54)
+
+#define ECALL_LAST (GAME_API_BASE + 55)
 
 #define STRINGIFY_HELPER(x) #x
 #define STRINGIFY(x) STRINGIFY_HELPER(x)
@@ -166,6 +182,80 @@ enum class Node3D_Op {
 	SET_QUATERNION,
 };
 
+enum class Command_Buffer_Op {
+	SET = 0, // Use the buffer at the given address, or stop deferring when it is 0.
+	FLUSH,   // Apply every command in the buffer now.
+};
+
+// Write-only operations that the guest may defer. The host applies them in one pass when
+// the guest flushes its buffer, and when the VM call that wrote them returns.
+enum class Command_Op : unsigned {
+	NODE2D_SET_POSITION = 0,
+	NODE2D_SET_ROTATION,
+	NODE2D_SET_SCALE,
+	NODE2D_SET_TRANSFORM,
+	NODE3D_SET_POSITION,
+	NODE3D_SET_ROTATION,
+	NODE3D_SET_SCALE,
+	NODE3D_SET_TRANSFORM,
+	OBJ_PROP_SET,
+	QUEUE_FREE,
+};
+
+// One deferred command, 64 bytes. The value is a Variant in the guest's layout, and it
+// may refer to Variants scoped to the current call. Property names are stored inline.
+struct Command {
+	unsigned long long object;
+	Command_Op op;
+	unsigned name_len;
+	unsigned char value[24];
+	char name[24];
+};
+
+// The guest's command buffer, in guest memory. Points to capacity commands, of which
+// the first count are waiting to be applied. The host sets count to 0 once applied.
+struct CommandBuffer {
+	unsigned long long commands;
+	unsigned count;
+	unsigned capacity;
+};
+
+// The guest's allocator for small blocks, which it hands out from regions of the host heap
+// without a system call. The host finds it by GUEST_HEAP_SYMBOL, adds the guest's counts
+// to its own heap monitors, and writes the allocation limit into max_blocks.
+#define GUEST_HEAP_SYMBOL "__sandbox_heap"
+struct GuestHeapStats {
+	unsigned long long region_bytes;  // Taken from the host heap for small blocks.
+	unsigned long long regions;       // The host allocations holding region_bytes.
+	unsigned long long live_bytes;    // Small blocks currently handed out, by their size class.
+	unsigned long long live_blocks;
+	unsigned long long allocations;   // Small blocks ever handed out.
+	unsigned long long deallocations; // Small blocks ever freed.
+	unsigned long long max_blocks;    // Written by the host. 0 is no limit.
+};
+
+// An argument or the return value of ECALL_OBJ_PTRCALL, in native form: bool and int as a
+// 64-bit integer, float as a double, vectors, rects, planes, quaternions and colors as their
+// components, and an object argument as its address.
+struct PtrCallSlot {
+	unsigned long long data[2];
+};
+
+// ECALL_PACKED_ARRAY_OPS takes a Packed*Array Variant type to create an array of that type.
+// Everything else it does has an operation beyond the Variant types.
+enum class PackedArray_Op {
+	MAP = 64, // Map a scoped Packed*Array into guest memory, see PackedArrayView.
+	COMMIT,   // Make the writes through a writable view visible to the host.
+	UNMAP,    // Remove a view. Views are also removed when the call that made them returns.
+};
+
+// A Packed*Array mapped into guest memory. The whole pages of the array are the host's own
+// storage, and only the partial pages at either end are copies.
+struct PackedArrayView {
+	unsigned long long data; // Guest address of the first element, or 0 when empty.
+	unsigned long long size; // Number of elements.
+};
+
 enum class Array_Op {
 	CREATE = 0,
 	PUSH_BACK,
@@ -180,6 +270,8 @@ enum class Array_Op {
 	SORT,
 	FETCH_TO_VECTOR,
 	HAS,
+	GET_SLICE, // Copy up to a4 elements from idx into a GuestVariant buffer, returns the count.
+	SET_SLICE, // Assign a4 elements from a GuestVariant buffer, starting at idx.
 };
 
 enum class Dictionary_Op {
@@ -193,6 +285,8 @@ enum class Dictionary_Op {
 	CLEAR,
 	MERGE,
 	GET_OR_ADD,
+	GET_ENTRIES, // Copy up to a4 key/value pairs following the key at a3 (or from the start if null) into a GuestVariant buffer.
+	SET_ENTRIES, // Assign a4 key/value pairs from a GuestVariant buffer.
 };
 
 enum class String_Op {
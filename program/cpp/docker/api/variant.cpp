@@ -10,6 +10,7 @@ MAKE_SYSCALL(ECALL_VASSIGN, unsigned, sys_vassign, unsigned, Variant *);
 MAKE_SYSCALL(ECALL_VCREATE, void, sys_vcreate, Variant *, int, int, ...);
 MAKE_SYSCALL(ECALL_VFETCH, void, sys_vfetch, unsigned, void *, int);
 MAKE_SYSCALL(ECALL_VCLONE, void, sys_vclone, const Variant *, Variant *);
+MAKE_SYSCALL(ECALL_VRELEASE, void, sys_vrelease, unsigned);
 MAKE_SYSCALL(ECALL_VSTORE, void, sys_vstore, unsigned *, const void *, size_t);
 
 MAKE_SYSCALL(ECALL_CALLABLE_CREATE, unsigned, sys_callable_create, void (*)(), const Variant *, const void *, size_t);
@@ -102,3 +103,12 @@ Variant &Variant::make_permanent() {
 bool Variant::is_permanent() const noexcept {
 	return int32_t(uint32_t(this->v.i)) < 0;
 }
+
+void Variant::release_permanent() {
+	// Only the types that the host holds on to have an index, the rest are stored inline.
+	const bool indexed = m_type == STRING || m_type == STRING_NAME || m_type == NODE_PATH || (m_type >= CALLABLE && m_type < VARIANT_MAX);
+	if (indexed && this->is_permanent()) {
+		sys_vrelease(this->v.i);
+	}
+	this->m_type = NIL;
+}
@@ -288,6 +288,9 @@ struct Variant
 	/// @return Updates the Variant to the new permanent Variant and returns it.
 	Variant &make_permanent();
 	bool is_permanent() const noexcept;
+	/// @brief Give up a permanent Variant, so that its slot can hold another one. The
+	/// Variant becomes Nil, and any other copies of it are no longer valid.
+	void release_permanent();
 
 	Variant &operator=(const Variant &other);
 	Variant &operator=(Variant &&other);
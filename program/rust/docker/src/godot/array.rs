@@ -98,6 +98,49 @@ impl GodotArray {
 		}
 	}
 
+	/// Copy elements starting at idx into values, all in one system call.
+	/// Returns the number of elements copied, which is less than values.len()
+	/// at the end of the array.
+	pub fn get_range(&self, idx: i32, values: &mut [Variant]) -> usize {
+		const ECALL_ARRAY_OPS: i32 = 521;
+		let count: usize;
+		unsafe {
+			asm!("ecall",
+				inlateout("a0") 13 => count, // OP_GET_SLICE
+				in("a1") self.reference,
+				in("a2") idx,
+				in("a3") values.as_mut_ptr(),
+				in("a4") values.len(),
+				in("a7") ECALL_ARRAY_OPS,
+			);
+		}
+		count
+	}
+	/// Assign values to the elements starting at idx, all in one system call.
+	pub fn set_range(&self, idx: i32, values: &[Variant]) {
+		const ECALL_ARRAY_OPS: i32 = 521;
+		unsafe {
+			asm!("ecall",
+				in("a0") 14, // OP_SET_SLICE
+				in("a1") self.reference,
+				in("a2") idx,
+				in("a3") values.as_ptr(),
+				in("a4") values.len(),
+				in("a7") ECALL_ARRAY_OPS,
+			);
+		}
+	}
+
+	pub fn iter(&self) -> GodotArrayIter {
+		GodotArrayIter {
+			array: GodotArray::from_ref(self.reference),
+			idx: 0,
+			chunk: std::array::from_fn(|_| Variant::new_nil()),
+			chunk_pos: 0,
+			chunk_len: 0,
+		}
+	}
+
 	/* Make a method call on the string (as Variant) */
 	pub fn call(&self, method: &str, args: &[Variant]) -> Variant {
 		// Call the method using Variant::callp
@@ -105,3 +148,39 @@ impl GodotArray {
 		var.call(method, &args)
 	}
 }
+
+/// Iterates over the elements of an array, fetching them a chunk at a time.
+pub struct GodotArrayIter {
+	array: GodotArray,
+	idx: i32,
+	chunk: [Variant; 32],
+	chunk_pos: usize,
+	chunk_len: usize,
+}
+
+impl Iterator for GodotArrayIter {
+	type Item = Variant;
+
+	fn next(&mut self) -> Option<Variant> {
+		if self.chunk_pos == self.chunk_len {
+			self.chunk_len = self.array.get_range(self.idx, &mut self.chunk);
+			self.chunk_pos = 0;
+			if self.chunk_len == 0 {
+				return None;
+			}
+			self.idx += self.chunk_len as i32;
+		}
+		let var = std::mem::replace(&mut self.chunk[self.chunk_pos], Variant::new_nil());
+		self.chunk_pos += 1;
+		Some(var)
+	}
+}
+
+impl<'a> IntoIterator for &'a GodotArray {
+	type Item = Variant;
+	type IntoIter = GodotArrayIter;
+
+	fn into_iter(self) -> GodotArrayIter {
+		self.iter()
+	}
+}
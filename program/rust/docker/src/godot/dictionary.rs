@@ -3,6 +3,19 @@ use core::arch::asm;
 use crate::Variant;
 use crate::VariantType;
 
+/// A key/value pair, laid out the way the host reads and writes them.
+#[repr(C)]
+pub struct DictionaryEntry {
+	pub key: Variant,
+	pub value: Variant,
+}
+
+impl DictionaryEntry {
+	pub fn new(key: Variant, value: Variant) -> DictionaryEntry {
+		DictionaryEntry { key, value }
+	}
+}
+
 #[repr(C)]
 pub struct GodotDictionary {
 	pub reference: i32
@@ -77,6 +90,54 @@ impl GodotDictionary {
 		}
 	}
 
+	/// Copy key/value pairs into entries, continuing after the given key, or
+	/// from the first entry when there is none, all in one system call.
+	/// Returns the number of pairs copied, which is less than entries.len()
+	/// at the end of the dictionary.
+	pub fn get_entries(&self, after: Option<&Variant>, entries: &mut [DictionaryEntry]) -> usize {
+		let after: *const Variant = match after {
+			Some(key) => key,
+			None => core::ptr::null(),
+		};
+		const ECALL_DICTIONARY_OPS: i32 = 524;
+		let count: usize;
+		unsafe {
+			asm!("ecall",
+				inlateout("a0") 10 => count, // OP_GET_ENTRIES
+				in("a1") self.reference,
+				in("a2") entries.as_mut_ptr(),
+				in("a3") after,
+				in("a4") entries.len(),
+				in("a7") ECALL_DICTIONARY_OPS,
+			);
+		}
+		count
+	}
+	/// Assign many key/value pairs, all in one system call.
+	pub fn set_entries(&self, entries: &[DictionaryEntry]) {
+		const ECALL_DICTIONARY_OPS: i32 = 524;
+		unsafe {
+			asm!("ecall",
+				in("a0") 11, // OP_SET_ENTRIES
+				in("a1") self.reference,
+				in("a2") entries.as_ptr(),
+				in("a3") 0,
+				in("a4") entries.len(),
+				in("a7") ECALL_DICTIONARY_OPS,
+			);
+		}
+	}
+
+	pub fn iter(&self) -> GodotDictionaryIter {
+		GodotDictionaryIter {
+			dict: GodotDictionary::from_ref(self.reference),
+			cursor: None,
+			chunk: std::array::from_fn(|_| DictionaryEntry::new(Variant::new_nil(), Variant::new_nil())),
+			chunk_pos: 0,
+			chunk_len: 0,
+		}
+	}
+
 	/* Make a method call on the string (as Variant) */
 	pub fn call(&self, method: &str, args: &[Variant]) -> Variant {
 		// Call the method using Variant::callp
@@ -84,3 +145,43 @@ impl GodotDictionary {
 		var.call(method, &args)
 	}
 }
+
+/// Iterates over the key/value pairs of a dictionary, fetching them a chunk at a time.
+pub struct GodotDictionaryIter {
+	dict: GodotDictionary,
+	cursor: Option<Variant>,
+	chunk: [DictionaryEntry; 32],
+	chunk_pos: usize,
+	chunk_len: usize,
+}
+
+impl Iterator for GodotDictionaryIter {
+	type Item = (Variant, Variant);
+
+	fn next(&mut self) -> Option<(Variant, Variant)> {
+		if self.chunk_pos == self.chunk_len {
+			self.chunk_len = self.dict.get_entries(self.cursor.as_ref(), &mut self.chunk);
+			self.chunk_pos = 0;
+			if self.chunk_len == 0 {
+				return None;
+			}
+		}
+		let entry = &mut self.chunk[self.chunk_pos];
+		// The next chunk continues after the last key handed out. Variants are plain
+		// handles into the host, so a bitwise copy refers to the same key.
+		self.cursor = Some(unsafe { core::ptr::read(&entry.key) });
+		let key = std::mem::replace(&mut entry.key, Variant::new_nil());
+		let value = std::mem::replace(&mut entry.value, Variant::new_nil());
+		self.chunk_pos += 1;
+		Some((key, value))
+	}
+}
+
+impl<'a> IntoIterator for &'a GodotDictionary {
+	type Item = (Variant, Variant);
+	type IntoIter = GodotDictionaryIter;
+
+	fn into_iter(self) -> GodotDictionaryIter {
+		self.iter()
+	}
+}
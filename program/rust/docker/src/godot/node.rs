@@ -35,6 +35,9 @@ impl Node
 		Node::new(node_address)
 	}
 
+	// Inlined so that every caller makes the system call from its own address,
+	// which the host uses to cache the method it resolved to.
+	#[inline(always)]
 	pub fn call(&self, method: &str, args: &[Variant]) -> Variant
 	{
 		let address = self.address;
@@ -58,6 +61,7 @@ fn godot_node_get(parent_address: usize, path: *const c_char, size: usize) -> us
 	return new_address;
 }
 
+#[inline(always)]
 fn godot_method_call(address: usize, method: *const c_char, msize: usize, args: *const Variant, num_args: usize) -> Variant
 {
 	const SYSCALL_OBJ_CALLP: i32 = 506;
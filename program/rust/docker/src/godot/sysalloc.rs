@@ -8,33 +8,222 @@ struct SysAllocator;
 
 /** Native-performance host-side implementations of common heap functions */
 
+#[inline]
+unsafe fn host_malloc(size: usize, align: usize) -> *mut u8 {
+    let ret: *mut u8;
+    asm!("ecall", in("a7") NATIVE_SYSCALLS_BASE + 0,
+        in("a0") size, in("a1") align,
+        lateout("a0") ret);
+    return ret;
+}
+#[inline]
+unsafe fn host_calloc(size: usize) -> *mut u8 {
+    let ret: *mut u8;
+    asm!("ecall", in("a7") NATIVE_SYSCALLS_BASE + 1,
+        in("a0") size, in("a1") 1, lateout("a0") ret);
+    return ret;
+}
+#[inline]
+unsafe fn host_realloc(ptr: *mut u8, new_size: usize) -> *mut u8 {
+    let ret: *mut u8;
+    asm!("ecall", in("a7") NATIVE_SYSCALLS_BASE + 2,
+        in("a0") ptr, in("a1") new_size, lateout("a0") ret);
+    return ret;
+}
+#[inline]
+unsafe fn host_free(ptr: *mut u8) {
+    asm!("ecall", in("a7") NATIVE_SYSCALLS_BASE + 3,
+        in("a0") ptr, lateout("a0") _);
+}
+
+/** Small blocks are handed out without a system call, from size classes carved out of
+    pages in regions taken from the host heap. The same allocator as the C++ runtime. */
+
+const HEAP_PAGE_SIZE: usize = 4096;
+const REGION_PAGES: usize = 64;
+const REGION_SIZE: usize = REGION_PAGES * HEAP_PAGE_SIZE;
+const MAX_REGIONS: usize = 16;
+const SMALL_MAX: usize = 1024;
+const NUM_CLASSES: usize = 12;
+const CLASS_SIZES: [usize; NUM_CLASSES] = [16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024];
+
+const fn size_class_index() -> [u8; SMALL_MAX / 16 + 1] {
+    let mut index = [0u8; SMALL_MAX / 16 + 1];
+    let mut c = 0;
+    let mut i = 0;
+    while i <= SMALL_MAX / 16 {
+        while CLASS_SIZES[c] < i * 16 {
+            c += 1;
+        }
+        index[i] = c as u8;
+        i += 1;
+    }
+    index
+}
+const SIZE_CLASS_INDEX: [u8; SMALL_MAX / 16 + 1] = size_class_index();
+
+/** Read by the host for its heap monitors. Must match GuestHeapStats in syscalls.h. */
+#[repr(C)]
+pub struct GuestHeapStats {
+    region_bytes: u64,
+    regions: u64,
+    live_bytes: u64,
+    live_blocks: u64,
+    allocations: u64,
+    deallocations: u64,
+    max_blocks: u64,
+}
+
+#[no_mangle]
+pub static mut __sandbox_heap: GuestHeapStats = GuestHeapStats {
+    region_bytes: 0, regions: 0, live_bytes: 0, live_blocks: 0,
+    allocations: 0, deallocations: 0, max_blocks: 0,
+};
+
+struct SmallHeap {
+    free: [*mut u8; NUM_CLASSES],
+    next: [usize; NUM_CLASSES],
+    end: [usize; NUM_CLASSES],
+    regions: [usize; MAX_REGIONS],
+    page_classes: [[u8; REGION_PAGES]; MAX_REGIONS],
+    region_count: usize,
+    next_page: usize,
+}
+
+static mut HEAP: SmallHeap = SmallHeap {
+    free: [core::ptr::null_mut(); NUM_CLASSES],
+    next: [0; NUM_CLASSES],
+    end: [0; NUM_CLASSES],
+    regions: [0; MAX_REGIONS],
+    page_classes: [[0; REGION_PAGES]; MAX_REGIONS],
+    region_count: 0,
+    next_page: REGION_PAGES,
+};
+
+/** The size a layout takes from the small heap, if it fits there. Blocks of a
+    power-of-two size class are aligned to their size. */
+#[inline]
+fn small_size(layout: &Layout) -> Option<usize> {
+    if layout.size() > SMALL_MAX {
+        None
+    } else if layout.align() <= 16 {
+        Some(layout.size())
+    } else if layout.align() <= SMALL_MAX {
+        Some(layout.size().max(layout.align()).next_power_of_two())
+    } else {
+        None
+    }
+}
+
+impl SmallHeap {
+    #[inline]
+    fn find_region(&self, ptr: *mut u8) -> Option<usize> {
+        (0..self.region_count).find(|&r| (ptr as usize).wrapping_sub(self.regions[r]) < REGION_SIZE)
+    }
+    #[inline]
+    fn class_of(&self, region: usize, ptr: *mut u8) -> usize {
+        self.page_classes[region][(ptr as usize - self.regions[region]) / HEAP_PAGE_SIZE] as usize
+    }
+    unsafe fn add_page(&mut self, c: usize) -> bool {
+        if self.next_page == REGION_PAGES {
+            if self.region_count == MAX_REGIONS {
+                return false;
+            }
+            let raw = host_malloc(REGION_SIZE + HEAP_PAGE_SIZE, 16);
+            if raw.is_null() {
+                return false;
+            }
+            self.regions[self.region_count] = (raw as usize + HEAP_PAGE_SIZE - 1) & !(HEAP_PAGE_SIZE - 1);
+            self.region_count += 1;
+            self.next_page = 0;
+            __sandbox_heap.region_bytes += (REGION_SIZE + HEAP_PAGE_SIZE) as u64;
+            __sandbox_heap.regions += 1;
+        }
+        let region = self.region_count - 1;
+        self.page_classes[region][self.next_page] = c as u8;
+        let page = self.regions[region] + self.next_page * HEAP_PAGE_SIZE;
+        self.next_page += 1;
+        self.next[c] = page;
+        self.end[c] = page + HEAP_PAGE_SIZE - HEAP_PAGE_SIZE % CLASS_SIZES[c];
+        true
+    }
+    unsafe fn alloc(&mut self, size: usize) -> *mut u8 {
+        if __sandbox_heap.max_blocks != 0 && __sandbox_heap.live_blocks >= __sandbox_heap.max_blocks {
+            return core::ptr::null_mut();
+        }
+        let c = SIZE_CLASS_INDEX[(size + 15) / 16] as usize;
+        let block: *mut u8;
+        if !self.free[c].is_null() {
+            block = self.free[c];
+            self.free[c] = *(block as *mut *mut u8);
+        } else {
+            if self.next[c] == self.end[c] && !self.add_page(c) {
+                return host_malloc(size, 16);
+            }
+            block = self.next[c] as *mut u8;
+            self.next[c] += CLASS_SIZES[c];
+        }
+        __sandbox_heap.live_blocks += 1;
+        __sandbox_heap.live_bytes += CLASS_SIZES[c] as u64;
+        __sandbox_heap.allocations += 1;
+        block
+    }
+    unsafe fn free(&mut self, region: usize, ptr: *mut u8) {
+        let c = self.class_of(region, ptr);
+        *(ptr as *mut *mut u8) = self.free[c];
+        self.free[c] = ptr;
+        __sandbox_heap.live_blocks -= 1;
+        __sandbox_heap.live_bytes -= CLASS_SIZES[c] as u64;
+        __sandbox_heap.deallocations += 1;
+    }
+}
+
 unsafe impl GlobalAlloc for SysAllocator {
     #[inline]
     unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
-        let ret: *mut u8;
-        asm!("ecall", in("a7") NATIVE_SYSCALLS_BASE + 0,
-            in("a0") layout.size(), in("a1") layout.align(),
-            lateout("a0") ret);
-        return ret;
+        match small_size(&layout) {
+            Some(size) => (*core::ptr::addr_of_mut!(HEAP)).alloc(size),
+            None => host_malloc(layout.size(), layout.align()),
+        }
     }
     #[inline]
     unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
-        let ret: *mut u8;
-        asm!("ecall", in("a7") NATIVE_SYSCALLS_BASE + 1,
-            in("a0") layout.size(), in("a1") 1, lateout("a0") ret);
-        return ret;
+        match small_size(&layout) {
+            Some(size) => {
+                let ret = (*core::ptr::addr_of_mut!(HEAP)).alloc(size);
+                if !ret.is_null() {
+                    core::ptr::write_bytes(ret, 0, layout.size());
+                }
+                ret
+            }
+            None => host_calloc(layout.size()),
+        }
     }
     #[inline]
-    unsafe fn realloc(&self, ptr: *mut u8, _layout: Layout, new_size: usize) -> *mut u8 {
-        let ret: *mut u8;
-        asm!("ecall", in("a7") NATIVE_SYSCALLS_BASE + 2,
-            in("a0") ptr, in("a1") new_size, lateout("a0") ret);
-        return ret;
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        let heap = &mut *core::ptr::addr_of_mut!(HEAP);
+        let region = match heap.find_region(ptr) {
+            Some(region) => region,
+            None => return host_realloc(ptr, new_size),
+        };
+        let old_size = CLASS_SIZES[heap.class_of(region, ptr)];
+        if new_size <= old_size {
+            return ptr;
+        }
+        let ret = self.alloc(Layout::from_size_align_unchecked(new_size, layout.align()));
+        if !ret.is_null() {
+            core::ptr::copy_nonoverlapping(ptr, ret, old_size);
+            heap.free(region, ptr);
+        }
+        ret
     }
     #[inline]
     unsafe fn dealloc(&self, ptr: *mut u8, _layout: Layout) {
-        asm!("ecall", in("a7") NATIVE_SYSCALLS_BASE + 3,
-            in("a0") ptr, lateout("a0") _);
+        let heap = &mut *core::ptr::addr_of_mut!(HEAP);
+        match heap.find_region(ptr) {
+            Some(region) => heap.free(region, ptr),
+            None => host_free(ptr),
+        }
     }
 }
 
@@ -1,6 +1,8 @@
 //
 // Godot Sandbox Zig API
 //
+const std = @import("std");
+
 pub const V = union { b: bool, i: i64, f: f64, obj: u64, bytes: [16]u8 };
 pub extern fn sys_vcall(self: *Variant, method: [*]const u8, method_len: usize, args: [*]Variant, args_len: usize, result: *Variant) void;
 
@@ -39,6 +41,238 @@ pub const Variant = struct {
     }
 };
 
+pub extern fn sys_array_ops(op: i32, array: i32, idx: i32, values: [*]Variant, count: usize) usize;
+pub extern fn sys_array_size(array: i32) i32;
+pub extern fn sys_dict_ops(op: i32, dict: i32, entries: [*]DictionaryEntry, after: ?*const Variant, count: usize) usize;
+
+pub const Array = struct {
+    idx: i32,
+
+    pub fn fromVariant(v: Variant) Array {
+        return Array{ .idx = @intCast(v.v.i) };
+    }
+
+    pub fn size(self: Array) i32 {
+        return sys_array_size(self.idx);
+    }
+
+    /// Copy the elements from idx on into values, all in one system call.
+    /// Returns the number of elements copied, fewer at the end of the array.
+    pub fn getRange(self: Array, idx: i32, values: []Variant) usize {
+        return sys_array_ops(13, self.idx, idx, values.ptr, values.len); // GET_SLICE
+    }
+
+    /// Assign values to the elements from idx on, all in one system call.
+    pub fn setRange(self: Array, idx: i32, values: []Variant) void {
+        _ = sys_array_ops(14, self.idx, idx, values.ptr, values.len); // SET_SLICE
+    }
+
+    pub fn iterator(self: Array) ArrayIterator {
+        return ArrayIterator{ .array = self };
+    }
+};
+
+/// Iterates over the elements of an Array, fetching them a chunk at a time.
+pub const ArrayIterator = struct {
+    array: Array,
+    idx: i32 = 0,
+    chunk: [32]Variant = undefined,
+    chunk_pos: usize = 0,
+    chunk_len: usize = 0,
+
+    pub fn next(self: *ArrayIterator) ?Variant {
+        if (self.chunk_pos == self.chunk_len) {
+            self.chunk_len = self.array.getRange(self.idx, &self.chunk);
+            self.chunk_pos = 0;
+            if (self.chunk_len == 0) return null;
+            self.idx += @intCast(self.chunk_len);
+        }
+        self.chunk_pos += 1;
+        return self.chunk[self.chunk_pos - 1];
+    }
+};
+
+pub const DictionaryEntry = struct {
+    key: Variant,
+    value: Variant,
+};
+
+pub const Dictionary = struct {
+    idx: i32,
+
+    pub fn fromVariant(v: Variant) Dictionary {
+        return Dictionary{ .idx = @intCast(v.v.i) };
+    }
+
+    /// Copy the key/value pairs following the key after (or from the first
+    /// entry when null) into entries, all in one system call. Returns the
+    /// number of pairs copied, fewer at the end.
+    pub fn getEntries(self: Dictionary, after: ?*const Variant, entries: []DictionaryEntry) usize {
+        return sys_dict_ops(10, self.idx, entries.ptr, after, entries.len); // GET_ENTRIES
+    }
+
+    /// Assign many key/value pairs, all in one system call.
+    pub fn setEntries(self: Dictionary, entries: []DictionaryEntry) void {
+        _ = sys_dict_ops(11, self.idx, entries.ptr, null, entries.len); // SET_ENTRIES
+    }
+
+    pub fn iterator(self: Dictionary) DictionaryIterator {
+        return DictionaryIterator{ .dict = self };
+    }
+};
+
+/// Iterates over the key/value pairs of a Dictionary, fetching them a chunk at a time.
+pub const DictionaryIterator = struct {
+    dict: Dictionary,
+    chunk: [32]DictionaryEntry = undefined,
+    chunk_pos: usize = 0,
+    chunk_len: usize = 0,
+
+    pub fn next(self: *DictionaryIterator) ?DictionaryEntry {
+        if (self.chunk_pos == self.chunk_len) {
+            // Continue after the last key of the previous chunk.
+            var after: ?Variant = null;
+            if (self.chunk_len > 0) after = self.chunk[self.chunk_len - 1].key;
+            self.chunk_len = self.dict.getEntries(if (after) |*key| key else null, &self.chunk);
+            self.chunk_pos = 0;
+            if (self.chunk_len == 0) return null;
+        }
+        self.chunk_pos += 1;
+        return self.chunk[self.chunk_pos - 1];
+    }
+};
+
+pub extern fn sys_host_malloc(size: usize) ?[*]u8;
+pub extern fn sys_host_free(ptr: [*]u8) void;
+
+/// Read by the host for its heap monitors. Must match GuestHeapStats in syscalls.h.
+pub const GuestHeapStats = extern struct {
+    region_bytes: u64 = 0,
+    regions: u64 = 0,
+    live_bytes: u64 = 0,
+    live_blocks: u64 = 0,
+    allocations: u64 = 0,
+    deallocations: u64 = 0,
+    max_blocks: u64 = 0,
+};
+export var __sandbox_heap: GuestHeapStats = .{};
+
+/// Hands out small blocks without a system call, from size classes carved out of
+/// pages in regions taken from the host heap. Larger blocks come from the host heap.
+/// The same allocator as the C++ and Rust runtimes.
+pub const allocator = std.mem.Allocator{
+    .ptr = undefined,
+    .vtable = &.{ .alloc = SmallHeap.alloc, .resize = SmallHeap.resize, .free = SmallHeap.free },
+};
+
+const SmallHeap = struct {
+    const page_size = 4096;
+    const region_pages = 64;
+    const region_size = region_pages * page_size;
+    const max_regions = 16;
+    const small_max = 1024;
+    const class_sizes = [_]usize{ 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024 };
+    const class_index = blk: {
+        var index: [small_max / 16 + 1]u8 = undefined;
+        var c: usize = 0;
+        for (&index, 0..) |*entry, i| {
+            while (class_sizes[c] < i * 16) c += 1;
+            entry.* = @intCast(c);
+        }
+        break :blk index;
+    };
+
+    var free_lists = [_]usize{0} ** class_sizes.len;
+    var next = [_]usize{0} ** class_sizes.len;
+    var end = [_]usize{0} ** class_sizes.len;
+    var regions: [max_regions]usize = undefined;
+    var page_classes: [max_regions][region_pages]u8 = undefined;
+    var region_count: usize = 0;
+    var next_page: usize = region_pages;
+
+    /// The size a block takes from the small heap, if it fits there. Blocks of a
+    /// power-of-two size class are aligned to their size.
+    fn smallSize(len: usize, log2_align: u8) ?usize {
+        const alignment = @as(usize, 1) << @intCast(log2_align);
+        if (len > small_max or alignment > small_max) return null;
+        if (alignment <= 16) return len;
+        return std.math.ceilPowerOfTwoAssert(usize, @max(len, alignment));
+    }
+
+    fn findRegion(ptr: usize) ?usize {
+        for (regions[0..region_count], 0..) |base, r| {
+            if (ptr -% base < region_size) return r;
+        }
+        return null;
+    }
+
+    fn classOf(region: usize, ptr: usize) usize {
+        return page_classes[region][(ptr - regions[region]) / page_size];
+    }
+
+    fn addPage(c: usize) bool {
+        if (next_page == region_pages) {
+            if (region_count == max_regions) return false;
+            const raw = sys_host_malloc(region_size + page_size) orelse return false;
+            regions[region_count] = std.mem.alignForward(usize, @intFromPtr(raw), page_size);
+            region_count += 1;
+            next_page = 0;
+            __sandbox_heap.region_bytes += region_size + page_size;
+            __sandbox_heap.regions += 1;
+        }
+        page_classes[region_count - 1][next_page] = @intCast(c);
+        const page = regions[region_count - 1] + next_page * page_size;
+        next_page += 1;
+        next[c] = page;
+        end[c] = page + page_size - page_size % class_sizes[c];
+        return true;
+    }
+
+    fn alloc(_: *anyopaque, len: usize, log2_align: u8, _: usize) ?[*]u8 {
+        const size = smallSize(len, log2_align) orelse {
+            // The host heap aligns to 16 bytes.
+            if (log2_align > 4) return null;
+            return sys_host_malloc(len);
+        };
+        const heap = &__sandbox_heap;
+        if (heap.max_blocks != 0 and heap.live_blocks >= heap.max_blocks) return null;
+        const c = class_index[(size + 15) / 16];
+        var block: usize = free_lists[c];
+        if (block != 0) {
+            free_lists[c] = @as(*usize, @ptrFromInt(block)).*;
+        } else {
+            if (next[c] == end[c] and !addPage(c)) {
+                if (log2_align > 4) return null;
+                return sys_host_malloc(len);
+            }
+            block = next[c];
+            next[c] += class_sizes[c];
+        }
+        heap.live_blocks += 1;
+        heap.live_bytes += class_sizes[c];
+        heap.allocations += 1;
+        return @ptrFromInt(block);
+    }
+
+    fn resize(_: *anyopaque, buf: []u8, _: u8, new_len: usize, _: usize) bool {
+        if (findRegion(@intFromPtr(buf.ptr))) |region| {
+            return new_len <= class_sizes[classOf(region, @intFromPtr(buf.ptr))];
+        }
+        return new_len <= buf.len;
+    }
+
+    fn free(_: *anyopaque, buf: []u8, _: u8, _: usize) void {
+        const ptr = @intFromPtr(buf.ptr);
+        const region = findRegion(ptr) orelse return sys_host_free(buf.ptr);
+        const c = classOf(region, ptr);
+        @as(*usize, @ptrFromInt(ptr)).* = free_lists[c];
+        free_lists[c] = ptr;
+        __sandbox_heap.live_blocks -= 1;
+        __sandbox_heap.live_bytes -= class_sizes[c];
+        __sandbox_heap.deallocations += 1;
+    }
+};
+
 comptime {
     asm (
         \\.global sys_vcall;
@@ -47,6 +281,36 @@ comptime {
         \\  li a7, 501
         \\  ecall
         \\  ret
+        \\.global sys_array_ops;
+        \\.type sys_array_ops, @function;
+        \\sys_array_ops:
+        \\  li a7, 521
+        \\  ecall
+        \\  ret
+        \\.global sys_array_size;
+        \\.type sys_array_size, @function;
+        \\sys_array_size:
+        \\  li a7, 523
+        \\  ecall
+        \\  ret
+        \\.global sys_dict_ops;
+        \\.type sys_dict_ops, @function;
+        \\sys_dict_ops:
+        \\  li a7, 524
+        \\  ecall
+        \\  ret
+        \\.global sys_host_malloc;
+        \\.type sys_host_malloc, @function;
+        \\sys_host_malloc:
+        \\  li a7, 480
+        \\  ecall
+        \\  ret
+        \\.global sys_host_free;
+        \\.type sys_host_free, @function;
+        \\sys_host_free:
+        \\  li a7, 483
+        \\  ecall
+        \\  ret
         \\.global fast_exit;
         \\.type fast_exit, @function;
         \\fast_exit:
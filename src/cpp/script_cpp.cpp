@@ -136,7 +136,7 @@ bool CPPScript::_is_tool() const {
 	return true;
 }
 bool CPPScript::_is_valid() const {
-	return elf_script.is_valid() && !elf_script->get_content().is_empty();
+	return elf_script.is_valid() && !elf_script->get_program().empty();
 }
 bool CPPScript::_is_abstract() const {
 	return false;
@@ -318,8 +318,7 @@ void CPPScript::update_methods_info() const {
 			methods_info.push_back(method_info);
 		}
 	} else {
-		const PackedByteArray &elf_data = elf_script->get_content();
-		Sandbox::BinaryInfo info = Sandbox::get_program_info_from_binary(elf_data);
+		Sandbox::BinaryInfo info = Sandbox::get_program_info_from_binary(elf_script->get_program());
 		for (const String &func_name : info.functions) {
 			methods_info.push_back(MethodInfo(func_name));
 		}
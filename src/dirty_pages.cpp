@@ -0,0 +1,264 @@
+#include "dirty_pages.h"
+
+#include "page_memory.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#if defined(__linux__) || (defined(__APPLE__) && defined(__MACH__))
+# define DIRTY_PAGES_POSIX 1
+# include <signal.h>
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+size_t DirtyPageTracker::page_size() {
+#ifdef DIRTY_PAGES_POSIX
+	static const size_t page_size = sysconf(_SC_PAGESIZE);
+	return page_size;
+#else
+	return 4096;
+#endif
+}
+
+#ifdef DIRTY_PAGES_POSIX
+
+/**
+ * Every tracker in the process shares one signal handler, which looks the faulting
+ * address up in a fixed table of tracked blocks. Nothing in the handler allocates or
+ * locks. A block is published by writing its end before its beginning, and withdrawn
+ * the other way around, so the handler never takes a half-written entry for a match.
+ * Faults anywhere else are handed on to whichever handler was there before, which for
+ * the editor and exported games is Godot's crash handler.
+ **/
+static constexpr int MAX_TRACKERS = 1024;
+struct TrackerSlot {
+	std::atomic<uintptr_t> begin = 0;
+	std::atomic<uintptr_t> end = 0;
+	std::atomic<DirtyPageTracker *> tracker = nullptr;
+};
+static TrackerSlot slots[MAX_TRACKERS];
+static std::mutex slots_mutex;
+static struct sigaction previous_segv;
+static struct sigaction previous_bus;
+
+struct DirtyPageTracker::FaultHandler {
+	static void handler(int sig, siginfo_t *info, void *context) {
+		const uintptr_t address = uintptr_t(info->si_addr);
+		for (TrackerSlot &slot : slots) {
+			if (address >= slot.begin.load(std::memory_order_acquire) && address < slot.end.load(std::memory_order_acquire)) {
+				DirtyPageTracker *tracker = slot.tracker.load(std::memory_order_acquire);
+				if (tracker != nullptr && tracker->on_write(address)) {
+					return;
+				}
+			}
+		}
+		const struct sigaction &previous = (sig == SIGBUS) ? previous_bus : previous_segv;
+		if (previous.sa_flags & SA_SIGINFO) {
+			previous.sa_sigaction(sig, info, context);
+		} else if (previous.sa_handler == SIG_DFL || previous.sa_handler == SIG_IGN) {
+			// Returning faults again, this time with the default action.
+			signal(sig, SIG_DFL);
+		} else {
+			previous.sa_handler(sig);
+		}
+	}
+
+	static bool install() {
+		static const bool installed = []() {
+			struct sigaction action {};
+			action.sa_sigaction = handler;
+			action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+			sigemptyset(&action.sa_mask);
+			return sigaction(SIGSEGV, &action, &previous_segv) == 0 && sigaction(SIGBUS, &action, &previous_bus) == 0;
+		}();
+		return installed;
+	}
+
+	static int add(DirtyPageTracker *tracker) {
+		std::lock_guard<std::mutex> lock(slots_mutex);
+		for (int i = 0; i < MAX_TRACKERS; i++) {
+			TrackerSlot &slot = slots[i];
+			if (slot.tracker.load(std::memory_order_relaxed) == nullptr) {
+				slot.tracker.store(tracker, std::memory_order_release);
+				slot.end.store(uintptr_t(tracker->m_memory) + tracker->m_size, std::memory_order_release);
+				slot.begin.store(uintptr_t(tracker->m_memory), std::memory_order_release);
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	static void remove(int index) {
+		std::lock_guard<std::mutex> lock(slots_mutex);
+		TrackerSlot &slot = slots[index];
+		slot.begin.store(0, std::memory_order_release);
+		slot.end.store(0, std::memory_order_release);
+		slot.tracker.store(nullptr, std::memory_order_release);
+	}
+};
+
+std::unique_ptr<DirtyPageTracker> DirtyPageTracker::start(void *memory, size_t size, bool anonymous) {
+	const size_t page_mask = page_size() - 1;
+	if (memory == nullptr || size == 0 || (uintptr_t(memory) & page_mask) != 0 || (size & page_mask) != 0) {
+		return nullptr;
+	}
+	if (size / page_size() > UINT32_MAX || !FaultHandler::install()) {
+		return nullptr;
+	}
+	void *saved = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (saved == MAP_FAILED) {
+		return nullptr;
+	}
+	std::unique_ptr<DirtyPageTracker> tracker(new DirtyPageTracker);
+	tracker->m_memory = (uint8_t *)memory;
+	tracker->m_size = size;
+	tracker->m_saved = (uint8_t *)saved;
+	tracker->m_anonymous = anonymous;
+	tracker->m_dirty = std::make_unique<uint32_t[]>(size / page_size());
+	tracker->m_slot = FaultHandler::add(tracker.get());
+	if (tracker->m_slot < 0 || mprotect(memory, size, PROT_READ) != 0) {
+		return nullptr;
+	}
+	return tracker;
+}
+
+DirtyPageTracker::~DirtyPageTracker() {
+	if (m_slot >= 0) {
+		FaultHandler::remove(m_slot);
+		mprotect(m_memory, m_size, PROT_READ | PROT_WRITE);
+	}
+	if (m_saved != nullptr) {
+		munmap(m_saved, m_size);
+	}
+}
+
+bool DirtyPageTracker::on_write(uintptr_t address) {
+	if (address < uintptr_t(m_memory) || address >= uintptr_t(m_memory) + m_size) {
+		return false;
+	}
+	const size_t page = (address - uintptr_t(m_memory)) / page_size();
+	const size_t offset = page * page_size();
+	std::memcpy(m_saved + offset, m_memory + offset, page_size());
+	if (mprotect(m_memory + offset, page_size(), PROT_READ | PROT_WRITE) != 0) {
+		return false;
+	}
+	m_dirty[m_dirty_count.fetch_add(1, std::memory_order_relaxed)] = page;
+	return true;
+}
+
+std::span<const uint32_t> DirtyPageTracker::written_pages() {
+	const size_t count = m_dirty_count.load(std::memory_order_relaxed);
+	std::sort(&m_dirty[0], &m_dirty[count]);
+	return { &m_dirty[0], count };
+}
+
+void DirtyPageTracker::protect(size_t first_page, size_t pages) {
+	if (pages != 0) {
+		mprotect(m_memory + first_page * page_size(), pages * page_size(), PROT_READ);
+		// The next write saves the page again, so the copies are no longer needed.
+		release_pages(m_saved + first_page * page_size(), pages * page_size());
+	}
+}
+
+size_t DirtyPageTracker::restore(std::span<const uint32_t> keep) {
+	const std::span<const uint32_t> dirty = this->written_pages();
+	// Pages are written to all over the place, but mostly in runs, which are protected
+	// again with one call each. Kept pages move to the front, and stay writable.
+	// Pages that were zero are given back to the system instead of copied, so that memory
+	// only used since then does not stay with the block.
+	size_t kept = 0;
+	size_t run_begin = 0;
+	size_t run_length = 0;
+	size_t zero_begin = 0;
+	size_t zero_length = 0;
+	auto zero_run = [&]() {
+		if (zero_length != 0) {
+			zero_pages(m_memory + zero_begin * page_size(), zero_length * page_size());
+			zero_length = 0;
+		}
+	};
+	for (size_t i = 0, k = 0; i < dirty.size(); i++) {
+		const uint32_t page = dirty[i];
+		while (k < keep.size() && keep[k] < page) {
+			k++;
+		}
+		if (k < keep.size() && keep[k] == page) {
+			m_dirty[kept++] = page;
+			continue;
+		}
+		if (run_length != 0 && run_begin + run_length == page) {
+			run_length++;
+		} else {
+			zero_run();
+			this->protect(run_begin, run_length);
+			run_begin = page;
+			run_length = 1;
+		}
+		const size_t offset = size_t(page) * page_size();
+		const uint8_t *saved = m_saved + offset;
+		if (m_anonymous && saved[0] == 0 && std::memcmp(saved, saved + 1, page_size() - 1) == 0) {
+			zero_begin = (zero_length == 0) ? page : zero_begin;
+			zero_length++;
+		} else {
+			zero_run();
+			std::memcpy(m_memory + offset, saved, page_size());
+		}
+	}
+	zero_run();
+	this->protect(run_begin, run_length);
+	m_dirty_count.store(kept, std::memory_order_relaxed);
+	return dirty.size() - kept;
+}
+
+size_t DirtyPageTracker::forget() {
+	const std::span<const uint32_t> dirty = this->written_pages();
+	for (size_t i = 0; i < dirty.size();) {
+		size_t run = 1;
+		while (i + run < dirty.size() && dirty[i + run] == dirty[i] + run) {
+			run++;
+		}
+		this->protect(dirty[i], run);
+		i += run;
+	}
+	m_dirty_count.store(0, std::memory_order_relaxed);
+	return dirty.size();
+}
+
+#else // !DIRTY_PAGES_POSIX
+
+struct DirtyPageTracker::FaultHandler {};
+
+std::unique_ptr<DirtyPageTracker> DirtyPageTracker::start(void *memory, size_t size, bool anonymous) {
+	(void)memory;
+	(void)size;
+	(void)anonymous;
+	return nullptr;
+}
+
+DirtyPageTracker::~DirtyPageTracker() {}
+
+bool DirtyPageTracker::on_write(uintptr_t address) {
+	(void)address;
+	return false;
+}
+
+std::span<const uint32_t> DirtyPageTracker::written_pages() {
+	return {};
+}
+
+void DirtyPageTracker::protect(size_t first_page, size_t pages) {
+	(void)first_page;
+	(void)pages;
+}
+
+size_t DirtyPageTracker::restore(std::span<const uint32_t> keep) {
+	(void)keep;
+	return 0;
+}
+
+size_t DirtyPageTracker::forget() {
+	return 0;
+}
+
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+/// @brief Keeps track of the pages of a block of memory that are written to, so that the
+/// block can be put back the way it was by copying only those pages.
+///
+/// The block is write-protected, and the first write to each page is caught, the page
+/// saved and then made writable again. Every later write to the page runs at full speed.
+/// @note Only works where the platform has mprotect() and signals, and start() fails
+/// everywhere else. Writes that the kernel makes on behalf of a system call, such as
+/// read() into the block, fail with EFAULT instead of being caught.
+class DirtyPageTracker {
+public:
+	/// @brief Start tracking writes to a block of memory.
+	/// @param memory The block, aligned to the host page size.
+	/// @param size The size of the block, a multiple of the host page size.
+	/// @param anonymous False if pages of the block may be mapped from a file. Pages that
+	/// were zero are then copied back like any other, instead of given back to the system.
+	/// @return The tracker, or nullptr if the block cannot be tracked.
+	static std::unique_ptr<DirtyPageTracker> start(void *memory, size_t size, bool anonymous = true);
+	~DirtyPageTracker();
+
+	/// @brief Put every page that was written to since start() or the last call to
+	/// restore() or forget() back the way it was then.
+	/// @param keep Pages to leave as they are, in ascending order. They stay written to.
+	/// @return The number of pages that were restored.
+	size_t restore(std::span<const uint32_t> keep = {});
+
+	/// @brief Keep the memory as it is now, and track writes from here on.
+	/// @return The number of pages that had been written to.
+	size_t forget();
+
+	/// @brief The number of pages written to since start(), restore() or forget().
+	size_t dirty_pages() const noexcept { return m_dirty_count.load(std::memory_order_relaxed); }
+
+	/// @brief The pages written to since start(), restore() or forget(), in ascending order.
+	/// @note Must not be called while the memory may be written to.
+	std::span<const uint32_t> written_pages();
+
+	/// @brief A page as it was before it was first written to. Only valid for the pages
+	/// in written_pages().
+	const uint8_t *saved_page(size_t page) const noexcept { return m_saved + page * page_size(); }
+
+	/// @brief The size of the pages that are tracked, which is the host page size.
+	static size_t page_size();
+
+private:
+	DirtyPageTracker() {}
+	// The signal handler shared by every tracker, see dirty_pages.cpp.
+	struct FaultHandler;
+	friend struct FaultHandler;
+	bool on_write(uintptr_t address);
+	void protect(size_t first_page, size_t pages);
+
+	uint8_t *m_memory = nullptr;
+	size_t m_size = 0;
+	// The saved pages, at the same offsets as in the block. Only the pages that were
+	// written to are ever touched, and are given back once they are clean again, so the
+	// rest never take up any memory.
+	uint8_t *m_saved = nullptr;
+	// The pages written to, in the order of their first write until written_pages() sorts them.
+	std::unique_ptr<uint32_t[]> m_dirty;
+	std::atomic<size_t> m_dirty_count = 0;
+	int m_slot = -1;
+	bool m_anonymous = true;
+};
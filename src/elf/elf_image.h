@@ -0,0 +1,66 @@
+#pragma once
+
+#include "../mapped_file.h"
+#include "../sandbox.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/// @brief Everything about a loaded ELF program that does not change from one Sandbox
+/// instance to the next, shared by all instances running the same version of it.
+/// @note Owned by the ELFScript (see ELFScript::get_image()), which drops it when its
+/// last Sandbox unregisters. Instances hold a reference of their own while they run.
+struct ELFImage {
+	int source_version = 0;
+	/// The program file the image was built from. Held so that the file, and with it the
+	/// identity the image is matched by, stays alive as long as the image does. Machines
+	/// refer into it instead of copying the program.
+	std::shared_ptr<const MappedFile> program;
+
+	/// What get_program_info_from_binary() found in the program.
+	Sandbox::BinaryInfo info;
+
+	/// Symbol name hash -> guest address, filled in by whichever instance looks a symbol
+	/// up first. Only lookups from the ELF symbol table go here, never anything a guest
+	/// registered at run-time. Instances on worker threads use it too, see symbols_mutex.
+	std::unordered_map<int64_t, gaddr_t> symbols;
+	mutable std::mutex symbols_mutex;
+
+	/// The decoded main execute segment. Machines share execute segments with identical
+	/// contents, but only while one of them is alive: holding it here means a level that
+	/// frees and re-creates all of its sandboxes doesn't decode the program again.
+	/// Once the program has been JIT-compiled, this is the compiled segment, which the
+	/// instances that tier up after the first one switch to, see Sandbox::tier_up().
+	std::shared_ptr<riscv::DecodedExecuteSegment<RISCV_ARCH>> execute_segment;
+	/// Guards execute_segment and the JIT state, as instances may run on worker threads.
+	std::mutex execute_mutex;
+	/// Set while one instance JIT-compiles the program, so that it is only compiled once.
+	bool jit_compiling = false;
+	/// Set once execute_segment is the JIT-compiled segment.
+	bool jit_compiled = false;
+
+	/// Calls into the program by instances that run it interpreted, counted towards their
+	/// JIT tier-up threshold. Shared, so that a program that is hot across many instances
+	/// is compiled even if each of them is only called now and then.
+	std::atomic<uint32_t> jit_entries = 0;
+
+	bool find_symbol(int64_t hash, gaddr_t &r_address) const {
+		std::lock_guard<std::mutex> lock(symbols_mutex);
+		auto it = symbols.find(hash);
+		if (it == symbols.end()) {
+			return false;
+		}
+		r_address = it->second;
+		return true;
+	}
+
+	void add_symbol(int64_t hash, gaddr_t address) {
+		std::lock_guard<std::mutex> lock(symbols_mutex);
+		symbols.emplace(hash, address);
+	}
+
+	bool matches(int p_source_version, const std::shared_ptr<const MappedFile> &p_program) const noexcept {
+		return source_version == p_source_version && program == p_program;
+	}
+};
@@ -2,13 +2,16 @@
 
 #include "../cpp/script_cpp.h"
 #include "../docker.h"
+#include "../mapped_file.h"
 #include "../register_types.h"
 #include "../sandbox.h"
 #include "../sandbox_project_settings.h"
+#include "elf_image.h"
 #include "script_instance.h"
 #include "script_instance_helper.h"
 #include <godot_cpp/classes/file_access.hpp>
 #include <godot_cpp/classes/json.hpp>
+#include <godot_cpp/classes/os.hpp>
 #include <godot_cpp/classes/resource_loader.hpp>
 static constexpr bool VERBOSE_ELFSCRIPT = false;
 
@@ -84,7 +87,7 @@ bool ELFScript::_has_source_code() const {
 	return true;
 }
 String ELFScript::_get_source_code() const {
-	if (source_code.is_empty()) {
+	if (program_file == nullptr) {
 		return String();
 	}
 	if (functions.is_empty()) {
@@ -232,9 +235,16 @@ Variant ELFScript::_get_rpc_config() const {
 }
 
 const PackedByteArray &ELFScript::get_content() {
+	if (source_code.is_empty() && program_file != nullptr) {
+		source_code = program_file->to_bytes();
+	}
 	return source_code;
 }
 
+std::string_view ELFScript::get_program() const noexcept {
+	return program_file != nullptr ? program_file->view() : std::string_view();
+}
+
 String ELFScript::get_elf_programming_language() const {
 	return elf_programming_language;
 }
@@ -252,21 +262,27 @@ void ELFScript::set_file(const String &p_path) {
 	CharString resless_path = p_path.replace("res://", "").utf8();
 	this->std_path = std::string(resless_path.ptr(), resless_path.length());
 
-	PackedByteArray new_source_code = FileAccess::get_file_as_bytes(this->path);
-	if (new_source_code == source_code) {
+	// Exported games map the program and run it from the page cache. Elsewhere it may be
+	// rebuilt while it is running, which would change the mapping under the machines, so
+	// it is read. Programs inside a PCK are always read.
+	const bool allow_mapping = OS::get_singleton()->has_feature("template");
+	std::shared_ptr<const MappedFile> new_program_file = MappedFile::open(this->path, allow_mapping);
+	if (new_program_file == nullptr || new_program_file->size() == 0) {
+		ERR_FAIL_MSG("ELFScript::set_file: Failed to load file '" + this->path + "'. The file is empty or does not exist.");
+		return;
+	} else if (new_program_file->view() == this->get_program()) {
 		if constexpr (VERBOSE_ELFSCRIPT) {
 			printf("ELFScript::set_file: No changes in %s\n", path.utf8().ptr());
 		}
 		return;
-	} else if (new_source_code.is_empty()) {
-		ERR_FAIL_MSG("ELFScript::set_file: Failed to load file '" + this->path + "'. The file is empty or does not exist.");
-		return;
 	}
-	source_code = std::move(new_source_code);
+	program_file = std::move(new_program_file);
+	source_code = PackedByteArray();
 
 	global_name = "Sandbox_" + path.get_basename().replace("res://", "").replace("/", "_").replace("-", "_").capitalize().replace(" ", "");
-	Sandbox::BinaryInfo info = Sandbox::get_program_info_from_binary(source_code);
-	this->function_names = std::move(info.functions);
+	const std::shared_ptr<ELFImage> image = this->get_image();
+	const Sandbox::BinaryInfo &info = image->info;
+	this->function_names = info.functions;
 	this->rebuild_function_name_set();
 	this->functions.clear();
 
@@ -276,8 +292,16 @@ void ELFScript::set_file(const String &p_path) {
 	if constexpr (VERBOSE_ELFSCRIPT) {
 		printf("ELFScript::set_file: %s Sandbox instances: %u\n", std_path.c_str(), sandbox_map[path].size());
 	}
-	for (Sandbox *sandbox : sandbox_map[path]) {
-		sandbox->set_program(Ref<ELFScript>(this));
+	HashSet<Sandbox *> *sandboxes = sandbox_map.getptr(path);
+	if (sandboxes != nullptr) {
+		for (Sandbox *sandbox : *sandboxes) {
+			sandbox->set_program(Ref<ELFScript>(this));
+		}
+	}
+	// Only instances keep the image around, see unregister_instance(). A program that
+	// nothing runs yet would otherwise hold on to it, and its file, until it is reloaded.
+	if (sandboxes == nullptr || sandboxes->is_empty()) {
+		image_map.erase(path);
 	}
 
 	// Update the instance methods only if functions are still empty
@@ -288,6 +312,35 @@ void ELFScript::set_file(const String &p_path) {
 	}
 }
 
+std::shared_ptr<ELFImage> ELFScript::get_image() {
+	if (program_file == nullptr) {
+		return nullptr;
+	}
+	std::shared_ptr<ELFImage> *existing = image_map.getptr(path);
+	if (existing != nullptr && (*existing)->matches(source_version, program_file)) {
+		return *existing;
+	}
+	auto image = std::make_shared<ELFImage>();
+	image->source_version = source_version;
+	image->program = program_file;
+	image->info = Sandbox::get_program_info_from_binary(program_file->view());
+	image_map.insert(path, image);
+	return image;
+}
+
+void ELFScript::unregister_instance(Sandbox *p_sandbox) {
+	HashSet<Sandbox *> *sandboxes = sandbox_map.getptr(path);
+	if (sandboxes == nullptr) {
+		return;
+	}
+	sandboxes->erase(p_sandbox);
+	if (sandboxes->is_empty()) {
+		// Instances still running hold their own reference, so this only stops the
+		// image from outliving them.
+		image_map.erase(path);
+	}
+}
+
 void ELFScript::set_public_api_functions(Array &&p_functions) {
 	functions = std::move(p_functions);
 
@@ -3,13 +3,17 @@
 #include <godot_cpp/classes/script_extension.hpp>
 #include <godot_cpp/classes/script_language.hpp>
 #include <godot_cpp/templates/hash_set.hpp>
+#include <memory>
 #include <string>
+#include <string_view>
 
 #include "../stringname_id.hpp"
 
 using namespace godot;
 class ELFScriptInstance;
 class Sandbox;
+class MappedFile;
+struct ELFImage;
 namespace godot {
 	class ScriptInstanceExtension;
 }
@@ -19,6 +23,9 @@ class ELFScript : public ScriptExtension {
 
 protected:
 	static void _bind_methods();
+	// The program, mapped from disk in exported games and read everywhere else.
+	std::shared_ptr<const MappedFile> program_file;
+	// A copy of the program as a byte array, made the first time get_content() is asked.
 	PackedByteArray source_code;
 	String global_name;
 	String path;
@@ -32,6 +39,8 @@ protected:
 	friend class SafeGDScript;
 
 	static inline HashMap<String, HashSet<Sandbox *>> sandbox_map;
+	// Keyed by path, like sandbox_map, and dropped along with the last Sandbox there.
+	static inline HashMap<String, std::shared_ptr<ELFImage>> image_map;
 
 	StringNameSet function_name_set;
 	/// @brief Refresh function_name_set from function_names.
@@ -69,15 +78,27 @@ public:
 
 	/// @brief Retrieve the content of the ELF resource as a byte array.
 	/// @return An ELF program as a byte array.
+	/// @note Copies a mapped program the first time. Sandboxes use get_program() instead.
 	const PackedByteArray &get_content();
 
+	/// @brief The ELF program, without copying it.
+	/// @return The program, or an empty view if there is none. Valid for as long as
+	/// get_program_file() is held.
+	std::string_view get_program() const noexcept;
+	const std::shared_ptr<const MappedFile> &get_program_file() const noexcept { return program_file; }
+
 	/// @brief Get an ELFScript instance using a Node as the owner.
 	/// @param p_for_object The owner Node.
 	/// @return A reference to the ELFScript instance.
 	ELFScriptInstance *get_script_instance(Object *p_for_object) const;
 
+	/// @brief Get the image shared by every Sandbox running the current version of this
+	/// program, building it if nobody has yet.
+	/// @return The image, or nullptr if there is no program.
+	std::shared_ptr<ELFImage> get_image();
+
 	void register_instance(Sandbox *p_sandbox) { sandbox_map[path].insert(p_sandbox); }
-	void unregister_instance(Sandbox *p_sandbox) { sandbox_map[path].erase(p_sandbox); }
+	void unregister_instance(Sandbox *p_sandbox);
 
 	virtual bool _editor_can_reload_from_file() override;
 	virtual void _placeholder_erased(void *p_placeholder) override;
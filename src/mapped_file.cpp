@@ -0,0 +1,94 @@
+#include "mapped_file.h"
+
+#include <cstring>
+#include <godot_cpp/classes/file_access.hpp>
+
+#if defined(__linux__) || (defined(__APPLE__) && defined(__MACH__))
+# define MAPPED_FILE_POSIX 1
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+std::unique_ptr<MappedFile> MappedFile::open(const String &path, bool allow_mapping) {
+	Ref<FileAccess> fa = FileAccess::open(path, FileAccess::ModeFlags::READ);
+	if (fa == nullptr || !fa->is_open()) {
+		return nullptr;
+	}
+	std::unique_ptr<MappedFile> file(new MappedFile);
+	const uint64_t length = fa->get_length();
+
+#ifdef MAPPED_FILE_POSIX
+	// A file inside a PCK has no path of its own on disk, and opening it fails here.
+	const String absolute = fa->get_path_absolute();
+	const int fd = allow_mapping ? ::open(absolute.utf8().ptr(), O_RDONLY | O_CLOEXEC) : -1;
+	if (fd >= 0) {
+		struct stat st;
+		if (length > 0 && fstat(fd, &st) == 0 && uint64_t(st.st_size) == length) {
+			void *mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapping != MAP_FAILED) {
+				fa->close();
+				file->m_fd = fd;
+				file->m_mapping = mapping;
+				file->m_data = (const uint8_t *)mapping;
+				file->m_size = length;
+				return file;
+			}
+		}
+		::close(fd);
+	}
+#endif
+
+	file->m_buffer = fa->get_buffer(length);
+	file->m_data = file->m_buffer.ptr();
+	file->m_size = file->m_buffer.size();
+	return file;
+}
+
+MappedFile::~MappedFile() {
+#ifdef MAPPED_FILE_POSIX
+	if (m_mapping != nullptr) {
+		munmap(m_mapping, m_size);
+	}
+	if (m_fd >= 0) {
+		::close(m_fd);
+	}
+#endif
+}
+
+PackedByteArray MappedFile::to_bytes() const {
+	if (m_mapping == nullptr) {
+		return m_buffer;
+	}
+	PackedByteArray bytes;
+	bytes.resize(m_size);
+	std::memcpy(bytes.ptrw(), m_data, m_size);
+	return bytes;
+}
+
+size_t MappedFile::host_page_size() {
+#ifdef MAPPED_FILE_POSIX
+	static const size_t page_size = sysconf(_SC_PAGESIZE);
+	return page_size;
+#else
+	return 4096;
+#endif
+}
+
+bool MappedFile::map_private(void *dst, size_t length, size_t offset) const {
+#ifdef MAPPED_FILE_POSIX
+	const size_t page_mask = host_page_size() - 1;
+	if (m_fd < 0 || length == 0 || ((uintptr_t)dst & page_mask) != 0 || (length & page_mask) != 0 || (offset & page_mask) != 0 || offset + length > m_size) {
+		return false;
+	}
+	// Mappings outlive the descriptor, and are torn down with the memory they replaced.
+	void *mapping = mmap(dst, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, m_fd, offset);
+	return mapping == dst;
+#else
+	(void)dst;
+	(void)length;
+	(void)offset;
+	return false;
+#endif
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/string.hpp>
+#include <memory>
+#include <string_view>
+
+using namespace godot;
+
+/// @brief A read-only view of a whole file, mapped into memory where the platform and the
+/// file allow it, and otherwise read into a buffer.
+/// @note Files inside a PCK, and every file on platforms without mmap(), are read. Callers
+/// must work the same either way, and only use map_private() as an optimization.
+class MappedFile {
+public:
+	/// @brief Open a file from a Godot path (res://, user:// or absolute).
+	/// @param allow_mapping False to always read the file, for files that may be rewritten
+	/// while they are open, which would change or truncate a mapping under the reader.
+	/// @return The file, or nullptr if it could not be opened.
+	static std::unique_ptr<MappedFile> open(const String &path, bool allow_mapping = true);
+	~MappedFile();
+
+	const uint8_t *data() const noexcept { return m_data; }
+	size_t size() const noexcept { return m_size; }
+	std::string_view view() const noexcept { return { (const char *)m_data, m_size }; }
+	bool is_mapped() const noexcept { return m_mapping != nullptr; }
+
+	/// @brief The contents of the file as a byte array. Shares the buffer of a file that
+	/// was read, and copies a mapped one.
+	PackedByteArray to_bytes() const;
+
+	/// @brief Map a part of the file over existing memory, copy-on-write. Pages are read
+	/// from the file the first time they are touched, and copied the first time they are
+	/// written to.
+	/// @param dst Where to map the file. Must be aligned to the host page size.
+	/// @param length The number of bytes to map. Must be a multiple of the host page size.
+	/// @param offset Where in the file to start. Must be aligned to the host page size.
+	/// @return True if the memory was replaced, false if the caller must copy instead.
+	bool map_private(void *dst, size_t length, size_t offset) const;
+
+	/// @brief The host page size that map_private() requires alignment to.
+	static size_t host_page_size();
+
+private:
+	MappedFile() {}
+
+	const uint8_t *m_data = nullptr;
+	size_t m_size = 0;
+	int m_fd = -1;
+	void *m_mapping = nullptr;
+	PackedByteArray m_buffer;
+};
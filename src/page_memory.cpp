@@ -0,0 +1,123 @@
+#include "page_memory.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#if defined(__linux__) || (defined(__APPLE__) && defined(__MACH__))
+# define PAGE_MEMORY_POSIX 1
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+#if defined(__linux__)
+# include <fcntl.h>
+#endif
+
+size_t host_page_size() {
+#ifdef PAGE_MEMORY_POSIX
+	static const size_t page_size = sysconf(_SC_PAGESIZE);
+	return page_size;
+#else
+	return 4096;
+#endif
+}
+
+bool release_pages(void *memory, size_t size) {
+#if defined(__linux__)
+	return size != 0 && madvise(memory, size, MADV_DONTNEED) == 0;
+#elif defined(PAGE_MEMORY_POSIX)
+	return size != 0 && madvise(memory, size, MADV_FREE) == 0;
+#else
+	(void)memory;
+	(void)size;
+	return false;
+#endif
+}
+
+void zero_pages(void *memory, size_t size) {
+	uint8_t *begin = (uint8_t *)memory;
+	uint8_t *end = begin + size;
+#if defined(__linux__)
+	// Anonymous pages given back with MADV_DONTNEED read as zero. Elsewhere they may
+	// still read as they were, until the system gets around to taking them.
+	const size_t page_size = host_page_size();
+	uint8_t *first = (uint8_t *)((uintptr_t(begin) + page_size - 1) & ~uintptr_t(page_size - 1));
+	uint8_t *last = (uint8_t *)(uintptr_t(end) & ~uintptr_t(page_size - 1));
+	if (first < last && release_pages(first, last - first)) {
+		std::memset(begin, 0, first - begin);
+		std::memset(last, 0, end - last);
+		return;
+	}
+#endif
+	std::memset(begin, 0, end - begin);
+}
+
+bool resident_pages(const void *memory, size_t size, std::vector<bool> &resident) {
+	const size_t page_size = host_page_size();
+	const size_t pages = (size + page_size - 1) / page_size;
+	resident.assign(pages, false);
+#ifdef PAGE_MEMORY_POSIX
+# ifdef __APPLE__
+	char residency[1024];
+# else
+	unsigned char residency[1024];
+# endif
+	for (size_t page = 0; page < pages; page += sizeof(residency)) {
+		const size_t count = std::min(pages - page, sizeof(residency));
+		if (mincore((void *)((const uint8_t *)memory + page * page_size), count * page_size, residency) != 0) {
+			return false;
+		}
+		for (size_t i = 0; i < count; i++) {
+			resident[page + i] = (residency[i] & 1) != 0;
+		}
+	}
+	return true;
+#else
+	(void)memory;
+	return false;
+#endif
+}
+
+bool unbacked_pages(const void *memory, size_t size, std::vector<bool> &unbacked) {
+	const size_t page_size = host_page_size();
+	const size_t pages = (size + page_size - 1) / page_size;
+	unbacked.assign(pages, false);
+#if defined(__linux__)
+	// mincore() cannot tell a page that was never written to from one that was swapped
+	// out, but pagemap can: bit 63 is set for a page in memory, and bit 62 for one in swap.
+	static constexpr uint64_t PAGEMAP_PRESENT = uint64_t(1) << 63;
+	static constexpr uint64_t PAGEMAP_SWAPPED = uint64_t(1) << 62;
+	const int fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+	const size_t first_page = uintptr_t(memory) / page_size;
+	uint64_t entries[512];
+	for (size_t page = 0; page < pages; page += std::size(entries)) {
+		const size_t count = std::min(pages - page, std::size(entries));
+		const ssize_t bytes = pread(fd, entries, count * sizeof(uint64_t), off_t((first_page + page) * sizeof(uint64_t)));
+		if (bytes != ssize_t(count * sizeof(uint64_t))) {
+			close(fd);
+			return false;
+		}
+		for (size_t i = 0; i < count; i++) {
+			unbacked[page + i] = (entries[i] & (PAGEMAP_PRESENT | PAGEMAP_SWAPPED)) == 0;
+		}
+	}
+	close(fd);
+	return true;
+#else
+	(void)memory;
+	return false;
+#endif
+}
+
+size_t committed_bytes(const void *memory, size_t size) {
+	std::vector<bool> resident;
+	if (!resident_pages(memory, size, resident)) {
+		return size;
+	}
+	const size_t committed = std::count(resident.begin(), resident.end(), true) * host_page_size();
+	return std::min(committed, size);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Pages of guest memory are only backed by the system once they are written to. These
+// give them back when their contents no longer matter, and tell how many are backed.
+
+/// @brief Give pages back to the system, when their contents are no longer needed.
+/// @param memory The first page, aligned to the host page size.
+/// @param size A multiple of the host page size.
+/// @return True if the pages were given back. What they read afterwards is unspecified.
+bool release_pages(void *memory, size_t size);
+
+/// @brief Fill a block of memory with zeroes, giving the whole pages in it back to the
+/// system where the platform can promise that they read as zero afterwards.
+/// @note Only for anonymous memory. Pages of a private file mapping that are given back
+/// read what the file holds.
+void zero_pages(void *memory, size_t size);
+
+/// @brief The size of the pages that the system backs memory with.
+size_t host_page_size();
+
+/// @brief Which pages of a block of memory are in physical memory right now. A page that
+/// is not may still hold data that was swapped out, see unbacked_pages().
+/// @param memory The block, aligned to the host page size.
+/// @param resident Set to one entry per host page of the block.
+/// @return False where the platform cannot tell.
+bool resident_pages(const void *memory, size_t size, std::vector<bool> &resident);
+
+/// @brief Which pages of a block of memory are neither in physical memory nor in swap.
+/// An anonymous page that is not backed either way has never been written to, or was
+/// given back, and reads as zero.
+/// @param memory The block, aligned to the host page size.
+/// @param unbacked Set to one entry per host page of the block.
+/// @return False where the platform cannot tell, which is everywhere but Linux.
+bool unbacked_pages(const void *memory, size_t size, std::vector<bool> &unbacked);
+
+/// @brief The number of bytes in a block of memory that are backed by the system.
+/// @param memory The block, aligned to the host page size.
+/// @return The size of the block, where the platform cannot tell.
+size_t committed_bytes(const void *memory, size_t size);
@@ -13,6 +13,9 @@
 #include "elf/script_elf.h"
 #include "elf/script_language_elf.h"
 #include "sandbox.h"
+#include "sandbox_async.h"
+#include "sandbox_group.h"
+#include "sandbox_pool.h"
 #include "sandbox_project_settings.h"
 #include "cpp/resource_loader_cpp.h"
 #include "cpp/resource_saver_cpp.h"
@@ -49,6 +52,9 @@ static void initialize_riscv_module(ModuleInitializationLevel p_level) {
 		return;
 	}
 	ClassDB::register_class<Sandbox>();
+	ClassDB::register_class<SandboxPool>();
+	ClassDB::register_class<SandboxAsyncCall>();
+	ClassDB::register_class<SandboxGroup>();
 	ClassDB::register_class<ELFScript>();
 	ClassDB::register_class<ELFScriptLanguage>();
 	ClassDB::register_class<ResourceFormatLoaderELF>();
@@ -1,17 +1,25 @@
 #include "sandbox.h"
 
+#include "elf/elf_image.h"
 #include "fast_cast.hpp"
 #include "guest_datatypes.h"
+#include "page_memory.h"
+#include "sandbox_async.h"
+#include "sandbox_worker.h"
 #include "sandbox_project_settings.h"
+#include <godot_cpp/classes/class_db_singleton.hpp>
 #include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/time.hpp>
 #include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/templates/hash_map.hpp>
+#include <godot_cpp/templates/hashfuncs.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 #if defined(RISCV_BINARY_TRANSLATION) || defined(RISCV_ASMJIT)
+#include <chrono>
 #include <future>
+#endif
 #include <mutex>
 #include <thread>
-#endif
 
 using namespace godot;
 
@@ -23,8 +31,6 @@ static_assert(is_extension_class_v<Sandbox>, "GDCLASS() detection broke: fast_ca
 static_assert(!is_extension_class_v<godot::Node>, "GDCLASS() detection broke: fast_cast_to() would be needlessly slow for engine classes");
 
 static constexpr bool VERBOSE_PROPERTIES = false;
-static const int HEAP_SYSCALLS_BASE = 480;
-static const int MEMORY_SYSCALLS_BASE = 485;
 static const std::vector<std::string> program_arguments = { "program" };
 static riscv::Machine<RISCV_ARCH> dummy_machine;
 enum SandboxPropertyNameIndex : int {
@@ -36,6 +42,7 @@ enum SandboxPropertyNameIndex : int {
 	PROP_PRECISE_SIMULATION,
 	PROP_BINTR_NBIT_AS,
 	PROP_BINTR_REG_CACHE,
+	PROP_JIT_TIER_UP_THRESHOLD,
 	PROP_PROFILING,
 	PROP_RESTRICTIONS,
 	PROP_PROGRAM,
@@ -43,10 +50,14 @@ enum SandboxPropertyNameIndex : int {
 	PROP_MONITOR_HEAP_CHUNK_COUNT,
 	PROP_MONITOR_HEAP_ALLOCATION_COUNTER,
 	PROP_MONITOR_HEAP_DEALLOCATION_COUNTER,
+	PROP_MONITOR_MEMORY_RESERVED,
+	PROP_MONITOR_MEMORY_COMMITTED,
 	PROP_MONITOR_EXCEPTIONS,
 	PROP_MONITOR_EXECUTION_TIMEOUTS,
 	PROP_MONITOR_CALLS_MADE,
 	PROP_MONITOR_BINARY_TRANSLATED,
+	PROP_MONITOR_JIT_ENTRIES,
+	PROP_MONITOR_JIT_TIER_UPS,
 	PROP_GLOBAL_CALLS_MADE,
 	PROP_GLOBAL_EXCEPTIONS,
 	PROP_GLOBAL_TIMEOUTS,
@@ -55,64 +66,91 @@ enum SandboxPropertyNameIndex : int {
 };
 static std::vector<StringName> property_names;
 
-#if defined(RISCV_BINARY_TRANSLATION) || defined(RISCV_ASMJIT)
 namespace {
-// A background translation runs code that lives inside this extension. If Godot
-// unloads the extension while one is still running, the thread's own code is
-// unmapped underneath it and the process dies on the way out. So they are
-// tracked here and joined before the extension goes away.
-struct BackgroundTranslation {
+// A worker thread runs code that lives inside this extension. If Godot unloads
+// the extension while one is still running, the thread's own code is unmapped
+// underneath it and the process dies on the way out. So they are tracked here
+// and joined before the extension goes away.
+struct WorkerThread {
 	std::thread thread;
 	std::shared_ptr<std::atomic<bool>> done;
 };
-std::mutex background_translations_mutex;
-std::vector<BackgroundTranslation> background_translations;
+std::mutex worker_threads_mutex;
+std::vector<WorkerThread> worker_threads;
+// Seconds Deinitialize() waits for all worker threads together.
+static constexpr int WORKER_SHUTDOWN_TIMEOUT = 5;
 } // namespace
 
-static void start_background_translation(std::function<void()> &&step)
+void Sandbox::start_worker_thread(std::function<void()> &&work)
 {
 	auto done = std::make_shared<std::atomic<bool>>(false);
-	std::thread thread([step = std::move(step), done]() mutable {
-		try {
-			// This is a no-op if the step is empty.
-			if (step)
-				step();
-		} catch (const std::exception &e) {
-			String what = e.what();
-			ERR_PRINT(("Binary translation background compilation exception: " + what));
-		}
+	std::thread thread([work = std::move(work), done]() mutable {
+		// This is a no-op if the work is empty.
+		if (work)
+			work();
 		done->store(true);
 	});
 
-	std::lock_guard<std::mutex> lock(background_translations_mutex);
-	// Reap whatever finished since the last translation was started, so that a
+	std::lock_guard<std::mutex> lock(worker_threads_mutex);
+	// Reap whatever finished since the last thread was started, so that a
 	// long-running project doesn't accumulate joinable threads.
-	for (auto it = background_translations.begin(); it != background_translations.end();) {
+	for (auto it = worker_threads.begin(); it != worker_threads.end();) {
 		if (it->done->load()) {
 			it->thread.join();
-			it = background_translations.erase(it);
+			it = worker_threads.erase(it);
 		} else {
 			++it;
 		}
 	}
-	background_translations.push_back({ std::move(thread), std::move(done) });
+	worker_threads.push_back({ std::move(thread), std::move(done) });
+}
+
+#if defined(RISCV_BINARY_TRANSLATION) || defined(RISCV_ASMJIT)
+static void start_background_translation(std::function<void()> &&step)
+{
+	Sandbox::start_worker_thread([step = std::move(step)]() mutable {
+		try {
+			// This is a no-op if the step is empty.
+			if (step)
+				step();
+		} catch (const std::exception &e) {
+			String what = e.what();
+			ERR_PRINT(("Binary translation background compilation exception: " + what));
+		}
+	});
 }
+#endif
 
 void Sandbox::Deinitialize()
 {
-	std::vector<BackgroundTranslation> pending;
+	// Calls on worker threads may be waiting for the main thread, which will never come
+	// back to them now. They are cancelled first, so that joining them cannot block forever.
+	MainThreadQueue::cancel_all();
+	// Calls without an instruction limit may never return by themselves.
+	SandboxAsyncCall::stop_all();
+
+	std::vector<WorkerThread> pending;
 	{
-		std::lock_guard<std::mutex> lock(background_translations_mutex);
-		pending.swap(background_translations);
-	}
-	for (auto &bt : pending) {
-		if (bt.thread.joinable())
-			bt.thread.join();
+		std::lock_guard<std::mutex> lock(worker_threads_mutex);
+		pending.swap(worker_threads);
+	}
+	// A thread that is still running by then is stuck, and is left behind rather than
+	// keeping the editor or the game from exiting.
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(WORKER_SHUTDOWN_TIMEOUT);
+	for (auto &wt : pending) {
+		while (!wt.done->load() && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (!wt.thread.joinable()) {
+			continue;
+		} else if (wt.done->load()) {
+			wt.thread.join();
+		} else {
+			ERR_PRINT("Sandbox: A worker thread did not finish in time, and was left running.");
+			wt.thread.detach();
+		}
 	}
 }
-#else
-void Sandbox::Deinitialize() {}
-#endif
 
 void Sandbox::Initialize()
 {
@@ -127,6 +165,7 @@ void Sandbox::Initialize()
 		"precise_simulation",
 		"binary_translation_nbit_as",
 		"binary_translation_register_caching",
+		"jit_tier_up_threshold",
 		"profiling",
 		"restrictions",
 		"program",
@@ -134,10 +173,14 @@ void Sandbox::Initialize()
 		"monitor_heap_chunk_count",
 		"monitor_heap_allocation_counter",
 		"monitor_heap_deallocation_counter",
+		"monitor_memory_reserved",
+		"monitor_memory_committed",
 		"monitor_exceptions",
 		"monitor_execution_timeouts",
 		"monitor_calls_made",
 		"monitor_binary_translated",
+		"monitor_jit_entries",
+		"monitor_jit_tier_ups",
 		"global_calls_made",
 		"global_exceptions",
 		"global_timeouts",
@@ -157,6 +200,13 @@ void Sandbox::_bind_methods() {
 	// Methods.
 	ClassDB::bind_method(D_METHOD("load_buffer", "buffer"), &Sandbox::load_buffer);
 	ClassDB::bind_method(D_METHOD("reset", "unload"), &Sandbox::reset, DEFVAL(false));
+	ClassDB::bind_method(D_METHOD("fork_from", "template"), &Sandbox::fork_from);
+	ClassDB::bind_method(D_METHOD("save_snapshot", "path"), &Sandbox::save_snapshot);
+	ClassDB::bind_method(D_METHOD("load_snapshot", "path"), &Sandbox::load_snapshot);
+	ClassDB::bind_method(D_METHOD("checkpoint"), &Sandbox::checkpoint);
+	ClassDB::bind_method(D_METHOD("rollback"), &Sandbox::rollback);
+	ClassDB::bind_method(D_METHOD("save_state"), &Sandbox::save_state);
+	ClassDB::bind_method(D_METHOD("restore_state", "state"), &Sandbox::restore_state);
 	{
 		MethodInfo mi;
 		//mi.arguments.push_back(PropertyInfo(Variant::STRING, "function"));
@@ -165,6 +215,8 @@ void Sandbox::_bind_methods() {
 		ClassDB::bind_vararg_method(METHOD_FLAGS_DEFAULT, "vmcall", &Sandbox::vmcall, mi, DEFVAL(LocalVector<Variant>{}));
 		ClassDB::bind_vararg_method(METHOD_FLAGS_DEFAULT, "vmcallv", &Sandbox::vmcallv, mi, DEFVAL(LocalVector<Variant>{}));
 	}
+	ClassDB::bind_method(D_METHOD("vmcall_batch", "function", "arguments"), &Sandbox::vmcall_batch);
+	ClassDB::bind_method(D_METHOD("vmcall_async", "function", "args"), &Sandbox::vmcall_async, DEFVAL(Array()));
 	ClassDB::bind_method(D_METHOD("vmcallable", "function", "args"), &Sandbox::vmcallable, DEFVAL(Array{}));
 	ClassDB::bind_method(D_METHOD("vmcallable_address", "address", "args"), &Sandbox::vmcallable_address, DEFVAL(Array{}));
 
@@ -198,6 +250,11 @@ void Sandbox::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("make_resumable"), &Sandbox::make_resumable);
 	ClassDB::bind_method(D_METHOD("resume", "max_instructions"), &Sandbox::resume);
 
+	ClassDB::bind_method(D_METHOD("set_name_cache_size", "entries"), &Sandbox::set_name_cache_size, DEFVAL(NAME_CACHE_SIZE));
+	ClassDB::bind_method(D_METHOD("get_name_cache_size"), &Sandbox::get_name_cache_size);
+	ClassDB::bind_method(D_METHOD("set_function_cache_size", "entries"), &Sandbox::set_function_cache_size, DEFVAL(FUNCTION_CACHE_SIZE));
+	ClassDB::bind_method(D_METHOD("get_function_cache_size"), &Sandbox::get_function_cache_size);
+	ClassDB::bind_method(D_METHOD("get_name_cache_stats"), &Sandbox::get_name_cache_stats);
 	ClassDB::bind_method(D_METHOD("assault", "test", "iterations"), &Sandbox::assault);
 	ClassDB::bind_method(D_METHOD("has_function", "function"), &Sandbox::has_function);
 	ClassDB::bind_method(D_METHOD("get_functions"), &Sandbox::get_functions);
@@ -262,6 +319,10 @@ void Sandbox::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_binary_translation_bg_compilation", "bg_compilation"), &Sandbox::set_binary_translation_bg_compilation);
 	ClassDB::bind_method(D_METHOD("get_binary_translation_bg_compilation"), &Sandbox::get_binary_translation_bg_compilation);
 
+	ClassDB::bind_method(D_METHOD("set_jit_tier_up_threshold", "threshold"), &Sandbox::set_jit_tier_up_threshold);
+	ClassDB::bind_method(D_METHOD("get_jit_tier_up_threshold"), &Sandbox::get_jit_tier_up_threshold);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "jit_tier_up_threshold", PROPERTY_HINT_RANGE, "0,1000000,1,or_greater"), "set_jit_tier_up_threshold", "get_jit_tier_up_threshold");
+
 	ClassDB::bind_method(D_METHOD("set_profiling", "enable"), &Sandbox::set_profiling, DEFVAL(false));
 	ClassDB::bind_method(D_METHOD("get_profiling"), &Sandbox::get_profiling);
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "profiling", PROPERTY_HINT_NONE, "Enable profiling of VM calls"), "set_profiling", "get_profiling");
@@ -288,6 +349,12 @@ void Sandbox::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_heap_deallocation_counter"), &Sandbox::get_heap_deallocation_counter);
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "monitor_heap_deallocation_counter", PROPERTY_HINT_NONE, "Number of heap deallocations", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_heap_deallocation_counter");
 
+	ClassDB::bind_method(D_METHOD("get_memory_reserved"), &Sandbox::get_memory_reserved);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "monitor_memory_reserved", PROPERTY_HINT_NONE, "Bytes of address space reserved for guest memory", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_memory_reserved");
+
+	ClassDB::bind_method(D_METHOD("get_memory_committed"), &Sandbox::get_memory_committed);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "monitor_memory_committed", PROPERTY_HINT_NONE, "Bytes of guest memory backed by the system", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_memory_committed");
+
 	ClassDB::bind_method(D_METHOD("get_exceptions"), &Sandbox::get_exceptions);
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "monitor_exceptions", PROPERTY_HINT_NONE, "Number of exceptions thrown", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_exceptions");
 
@@ -299,6 +366,12 @@ void Sandbox::_bind_methods() {
 
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "monitor_binary_translated", PROPERTY_HINT_NONE, "Number of calls made", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "is_binary_translated");
 
+	ClassDB::bind_method(D_METHOD("get_jit_entries"), &Sandbox::get_jit_entries);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "monitor_jit_entries", PROPERTY_HINT_NONE, "Calls counted towards the JIT tier-up threshold", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_jit_entries");
+
+	ClassDB::bind_method(D_METHOD("get_jit_tier_ups"), &Sandbox::get_jit_tier_ups);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "monitor_jit_tier_ups", PROPERTY_HINT_NONE, "Number of times the program was moved to JIT-compiled code", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_jit_tier_ups");
+
 	ClassDB::bind_static_method("Sandbox", D_METHOD("get_global_calls_made"), &Sandbox::get_global_calls_made);
 	ClassDB::bind_static_method("Sandbox", D_METHOD("get_global_exceptions"), &Sandbox::get_global_exceptions);
 	ClassDB::bind_static_method("Sandbox", D_METHOD("get_global_timeouts"), &Sandbox::get_global_timeouts);
@@ -329,6 +402,7 @@ std::vector<PropertyInfo> Sandbox::create_sandbox_property_list() {
 	list.push_back(PropertyInfo(Variant::BOOL, "precise_simulation", PROPERTY_HINT_NONE));
 	list.push_back(PropertyInfo(Variant::BOOL, "binary_translation_nbit_as", PROPERTY_HINT_NONE));
 	list.push_back(PropertyInfo(Variant::BOOL, "binary_translation_register_caching", PROPERTY_HINT_NONE));
+	list.push_back(PropertyInfo(Variant::INT, "jit_tier_up_threshold", PROPERTY_HINT_NONE));
 	list.push_back(PropertyInfo(Variant::BOOL, "profiling", PROPERTY_HINT_NONE));
 	list.push_back(PropertyInfo(Variant::BOOL, "restrictions", PROPERTY_HINT_NONE));
 
@@ -342,10 +416,14 @@ std::vector<PropertyInfo> Sandbox::create_sandbox_property_list() {
 	list.push_back(PropertyInfo(Variant::INT, "monitor_heap_chunk_count", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY));
 	list.push_back(PropertyInfo(Variant::INT, "monitor_heap_allocation_counter", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY));
 	list.push_back(PropertyInfo(Variant::INT, "monitor_heap_deallocation_counter", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY));
+	list.push_back(PropertyInfo(Variant::INT, "monitor_memory_reserved", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY));
+	list.push_back(PropertyInfo(Variant::INT, "monitor_memory_committed", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY));
 	list.push_back(PropertyInfo(Variant::INT, "monitor_exceptions", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY));
 	list.push_back(PropertyInfo(Variant::INT, "monitor_execution_timeouts", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY));
 	list.push_back(PropertyInfo(Variant::INT, "monitor_calls_made", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY));
 	list.push_back(PropertyInfo(Variant::BOOL, "monitor_binary_translated", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY));
+	list.push_back(PropertyInfo(Variant::INT, "monitor_jit_entries", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY));
+	list.push_back(PropertyInfo(Variant::INT, "monitor_jit_tier_ups", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY));
 
 	return list;
 }
@@ -360,10 +438,28 @@ void Sandbox::constructor_initialize() {
 }
 void Sandbox::reset_machine() {
 	try {
+		// Stop tracking writes to the arena before it goes away.
+		this->m_checkpoint = nullptr;
 		if (this->m_machine != &dummy_machine) {
 			delete this->m_machine;
 			this->m_machine = &dummy_machine;
 		}
+		// The views were pages of the machine, and only hold on to their arrays now.
+		this->m_mapped_arrays.clear();
+		// Only now that the fork is gone may the machine it borrowed pages from go.
+		this->m_fork_source = nullptr;
+		if (this->m_jit_publish_pending && this->m_image != nullptr) {
+			// Gone before the compiled program could be shared, so the next instance to
+			// tier up compiles it instead.
+			std::lock_guard<std::mutex> lock(this->m_image->execute_mutex);
+			this->m_image->jit_compiling = false;
+		}
+		this->m_image = nullptr;
+		this->m_guest_heap = 0;
+		this->m_arena_from_file = false;
+		this->m_jit_tier_pending = false;
+		this->m_jit_publish_pending = false;
+		this->m_jit_entries = 0;
 	} catch (const std::exception &e) {
 		ERR_PRINT(("Sandbox exception: " + std::string(e.what())).c_str());
 	}
@@ -377,9 +473,14 @@ void Sandbox::full_reset() {
 	this->m_properties.clear();
 	this->m_public_api_functions.clear();
 	this->m_lookup.clear();
+	this->m_call_stubs.clear();
+	this->m_command_buffer = 0;
 	this->m_sname_lookup.clear();
 	this->m_name_addresses.clear();
 	this->m_guest_names.clear();
+	this->m_method_call_sites.clear();
+	this->m_node_paths.clear();
+	this->m_interned_names.clear();
 	// The allowed-objects list deliberately survives: it describes what the host is
 	// willing to expose to this Sandbox, not anything about the program in it. Loading a
 	// program used to silently drop it, leaving the sandbox unrestricted. Use
@@ -408,8 +509,10 @@ Sandbox::~Sandbox() {
 	this->m_global_instances_current -= 1;
 	this->set_program_data_internal(nullptr);
 	try {
+		this->m_checkpoint = nullptr;
 		if (this->m_machine != &dummy_machine)
 			delete this->m_machine;
+		this->m_fork_source = nullptr;
 	} catch (const std::exception &e) {
 		ERR_PRINT(("Sandbox exception: " + std::string(e.what())).c_str());
 	}
@@ -467,7 +570,7 @@ void Sandbox::set_program(Ref<ELFScript> program) {
 	if (this->m_program_data.is_null())
 		return;
 
-	if (this->load(&m_program_data->get_content())) {
+	if (this->load(m_program_data->get_program())) {
 		this->m_source_version = m_program_data->get_source_version();
 	}
 
@@ -515,7 +618,7 @@ void Sandbox::load_buffer(const PackedByteArray &buffer) {
 	// Reset the machine
 	this->full_reset();
 
-	this->load(&this->m_program_bytes);
+	this->load(this->program_view());
 }
 void Sandbox::reset(bool unload) {
 	// Check if a call is being made from the VM already,
@@ -543,16 +646,107 @@ void Sandbox::reset(bool unload) {
 bool Sandbox::has_program_loaded() const {
 	return !machine().memory.binary().empty();
 }
-bool Sandbox::load(const PackedByteArray *buffer, const std::vector<std::string> *argv_ptr) {
-	if (buffer == nullptr || buffer->is_empty()) {
+void Sandbox::create_machine(std::string_view binary_view) {
+	this->load_cached_translation(binary_view);
+	// With a tier-up threshold the program starts out interpreted, and is JIT-compiled
+	// once it has been called often enough, see Sandbox::tier_up().
+	const bool jit_at_load = m_bintr_jit && m_jit_tier_up_threshold <= 0;
+	this->m_jit_tier_pending = m_bintr_jit && !jit_at_load;
+	auto options = std::make_shared<riscv::MachineOptions<RISCV_ARCH>>(riscv::MachineOptions<RISCV_ARCH>{
+			.memory_max = uint64_t(get_memory_max()) << 20, // in MiB
+			//.verbose_loader = true,
+#ifdef RISCV_BINARY_TRANSLATION
+			.translate_enabled = riscv::libtcc_enabled && m_bintr_jit,
+			.translate_enable_embedded = true,
+			.translate_future_segments = false,
+			.translate_invoke_compiler = riscv::libtcc_enabled && jit_at_load,
+			//.translate_trace = true,
+			//.translate_timing = true,
+#  ifdef RISCV_LIBTCC
+			.translate_ignore_instruction_limit = get_instructions_max() <= 0,
+			.translate_use_register_caching = this->m_bintr_register_caching,
+			.translate_automatic_nbit_address_space = this->m_bintr_automatic_nbit_as,
+			.translate_live_patching = false, // Don't meddle with instruction stream
+#  endif // RISCV_LIBTCC
+#endif
+#ifdef RISCV_ASMJIT
+			.asmjit_enabled = jit_at_load,
+#endif
+	});
+#if defined(RISCV_BINARY_TRANSLATION) || defined(RISCV_ASMJIT)
+	// Background compilation, if enabled, will run the compilation in a separate thread
+	// and live-patch the results into the decoder cache after the compilation is done.
+	if (this->m_bintr_bg_compilation) {
+		// This is called from inside the translator in the main thread, and the
+		// goal is to run the callback in a separate thread, to avoid blocking
+		// the main thread while the compilation step is running.
+		auto background_callback = [](std::function<void()>& callback) {
+			// Run the callback in a separate thread. This is useful for
+			// long-running compilation tasks that should not block the main
+			// thread. The thread is tracked so that it can be joined before
+			// the extension is unloaded, see Sandbox::Deinitialize().
+			start_background_translation(std::move(callback));
+		};
+#  if defined(RISCV_BINARY_TRANSLATION) && defined(RISCV_LIBTCC)
+		options->translate_background_callback = background_callback;
+#  endif
+#  ifdef RISCV_ASMJIT
+		// NOTE: libriscv disables asmjit entirely when binary translation is
+		// compiling in the background, as only one backend can own the patched
+		// decoder cache. Setting both is still correct, just redundant.
+		options->asmjit_background_callback = background_callback;
+#  endif
+	}
+#endif
+
+	// Instances of the same program decode it once between them, see ELFImage.
+	options->use_shared_execute_segments = true;
+
+	this->m_machine = new machine_t{ binary_view, *options };
+	this->m_machine->set_options(std::move(options));
+
+	if (this->m_program_data.is_valid()) {
+		this->m_image = this->m_program_data->get_image();
+		if (this->m_image != nullptr) {
+			std::lock_guard<std::mutex> lock(this->m_image->execute_mutex);
+			if (this->m_image->execute_segment == nullptr) {
+				this->m_image->execute_segment = this->m_machine->memory.exec_segment_for(this->m_machine->memory.start_address());
+			}
+		}
+	}
+	// A program that tiers up is only compiled once it turns out to be called often,
+	// see Sandbox::tier_up().
+	if (!this->m_jit_tier_pending) {
+		this->cache_translation(binary_view);
+	}
+}
+void Sandbox::install_machine_callbacks() {
+	machine_t &m = machine();
+	m.set_userdata(this);
+	m.set_printer([](const machine_t &m, const char *str, size_t len) {
+		Sandbox *sandbox = m.get_userdata<Sandbox>();
+		sandbox->print(String::utf8(str, len));
+	});
+
+	this->initialize_syscalls_runtime();
+}
+std::string_view Sandbox::program_view() const noexcept {
+	if (this->m_program_data.is_valid()) {
+		return this->m_program_data->get_program();
+	}
+	return std::string_view{ (const char *)this->m_program_bytes.ptr(), static_cast<size_t>(this->m_program_bytes.size()) };
+}
+bool Sandbox::load(std::string_view binary_view, const std::vector<std::string> *argv_ptr) {
+	if (binary_view.empty()) {
 		ERR_PRINT("Empty binary, cannot load program.");
 		this->reset_machine();
 		return false;
 	}
-	const std::string_view binary_view = std::string_view{ (const char *)buffer->ptr(), static_cast<size_t>(buffer->size()) };
 
 	// Guest addresses are about to change, so names cached against them are no longer valid.
 	this->m_guest_names.clear();
+	this->m_method_call_sites.clear();
+	this->m_node_paths.clear();
 
 	// Get t0 for the startup time
 	const uint64_t startup_t0 = Time::get_singleton()->get_ticks_usec();
@@ -560,58 +754,13 @@ bool Sandbox::load(const PackedByteArray *buffer, const std::vector<std::string>
 	/** We can't handle exceptions until the Machine is fully constructed. Two steps.  */
 	try {
 		// Reset the machine
+		this->m_checkpoint = nullptr;
 		if (this->m_machine != &dummy_machine)
 			delete this->m_machine;
+		this->m_machine = &dummy_machine;
+		this->m_fork_source = nullptr;
 
-		auto options = std::make_shared<riscv::MachineOptions<RISCV_ARCH>>(riscv::MachineOptions<RISCV_ARCH>{
-				.memory_max = uint64_t(get_memory_max()) << 20, // in MiB
-				//.verbose_loader = true,
-#ifdef RISCV_BINARY_TRANSLATION
-				.translate_enabled = riscv::libtcc_enabled && m_bintr_jit,
-				.translate_enable_embedded = true,
-				.translate_future_segments = false,
-				.translate_invoke_compiler = riscv::libtcc_enabled && m_bintr_jit,
-				//.translate_trace = true,
-				//.translate_timing = true,
-#  ifdef RISCV_LIBTCC
-				.translate_ignore_instruction_limit = get_instructions_max() <= 0,
-				.translate_use_register_caching = this->m_bintr_register_caching,
-				.translate_automatic_nbit_address_space = this->m_bintr_automatic_nbit_as,
-				.translate_live_patching = false, // Don't meddle with instruction stream
-#  endif // RISCV_LIBTCC
-#endif
-#ifdef RISCV_ASMJIT
-				.asmjit_enabled = m_bintr_jit,
-#endif
-		});
-#if defined(RISCV_BINARY_TRANSLATION) || defined(RISCV_ASMJIT)
-		// Background compilation, if enabled, will run the compilation in a separate thread
-		// and live-patch the results into the decoder cache after the compilation is done.
-		if (this->m_bintr_bg_compilation) {
-			// This is called from inside the translator in the main thread, and the
-			// goal is to run the callback in a separate thread, to avoid blocking
-			// the main thread while the compilation step is running.
-			auto background_callback = [](std::function<void()>& callback) {
-				// Run the callback in a separate thread. This is useful for
-				// long-running compilation tasks that should not block the main
-				// thread. The thread is tracked so that it can be joined before
-				// the extension is unloaded, see Sandbox::Deinitialize().
-				start_background_translation(std::move(callback));
-			};
-#  if defined(RISCV_BINARY_TRANSLATION) && defined(RISCV_LIBTCC)
-			options->translate_background_callback = background_callback;
-#  endif
-#  ifdef RISCV_ASMJIT
-			// NOTE: libriscv disables asmjit entirely when binary translation is
-			// compiling in the background, as only one backend can own the patched
-			// decoder cache. Setting both is still correct, just redundant.
-			options->asmjit_background_callback = background_callback;
-#  endif
-		}
-#endif
-
-		this->m_machine = new machine_t{ binary_view, *options };
-		this->m_machine->set_options(std::move(options));
+		this->create_machine(binary_view);
 	} catch (const std::exception &e) {
 		ERR_PRINT(("Sandbox construction exception: " + std::string(e.what())).c_str());
 		this->m_machine = &dummy_machine;
@@ -623,21 +772,18 @@ bool Sandbox::load(const PackedByteArray *buffer, const std::vector<std::string>
 		this->m_is_initialization = true;
 		machine_t &m = machine();
 
-		m.set_userdata(this);
-		m.set_printer([](const machine_t &m, const char *str, size_t len) {
-			Sandbox *sandbox = m.get_userdata<Sandbox>();
-			sandbox->print(String::utf8(str, len));
-		});
-
-		this->initialize_syscalls_runtime();
+		this->install_machine_callbacks();
 
 		const gaddr_t heap_size = gaddr_t(machine().memory.memory_arena_size() * 0.8) & ~0xFFFLL;
 		const gaddr_t heap_area = machine().memory.mmap_allocate(heap_size);
 
 		// Add native system call interfaces
 		machine().setup_native_heap(HEAP_SYSCALLS_BASE, heap_area, heap_size);
+		this->m_heap_area = heap_area;
+		this->m_heap_size = heap_size;
 		machine().setup_native_memory(MEMORY_SYSCALLS_BASE);
 		machine().arena().set_max_chunks(get_allocations_max());
+		this->find_guest_heap();
 
 		// Set up a Linux environment for the program
 		const std::vector<std::string> *argv = argv_ptr ? argv_ptr : &program_arguments;
@@ -685,6 +831,7 @@ bool Sandbox::load(const PackedByteArray *buffer, const std::vector<std::string>
 				String name = func["name"];
 				const gaddr_t address = func.get("address", 0x0);
 				this->m_lookup.insert_or_assign(name.hash(), LookupEntry{ std::move(name), address });
+				this->add_call_stub(func);
 			}
 			this->m_program_data->update_public_api_functions();
 		}
@@ -888,6 +1035,147 @@ void Sandbox::setup_arguments_native(gaddr_t arrayDataPtr, GuestVariant *v, cons
 		throw std::runtime_error("Sandbox: Too many arguments for VM function call (register overflow)");
 	}
 }
+void Sandbox::add_call_stub(const Dictionary &func) {
+	const gaddr_t address = func.get("address", 0x0);
+	const Array args = func.get("args", Array());
+	if (address == 0x0) {
+		return;
+	}
+	m_call_stubs.erase(address);
+
+	// The same register assignment setup_arguments_native() makes, minus the switch.
+	CallStub stub;
+	if (args.size() > int64_t(stub.args.size())) {
+		return;
+	}
+	uint8_t index = 11;
+	uint8_t flindex = 10;
+	for (int i = 0; i < args.size(); i++) {
+		const Dictionary arg = args[i];
+		CallStub::Arg &sarg = stub.args[i];
+		sarg.type = Variant::Type(int(arg.get("type", Variant::NIL)));
+		switch (sarg.type) {
+			case Variant::BOOL:
+			case Variant::INT:
+			case Variant::VECTOR2I:
+				sarg.kind = CallStub::INT;
+				sarg.reg = index++;
+				break;
+			case Variant::FLOAT:
+				sarg.kind = CallStub::DOUBLE;
+				sarg.reg = flindex++;
+				break;
+			case Variant::VECTOR2:
+				sarg.kind = CallStub::FLOAT_PAIR;
+				sarg.reg = flindex;
+				flindex += 2;
+				break;
+			case Variant::VECTOR3:
+			case Variant::VECTOR4:
+			case Variant::VECTOR4I:
+			case Variant::COLOR:
+			case Variant::PLANE:
+				sarg.kind = CallStub::WORD_PAIR;
+				sarg.reg = index;
+				index += 2;
+				break;
+			case Variant::VECTOR3I:
+				sarg.kind = CallStub::IVEC3;
+				sarg.reg = index;
+				index += 2;
+				break;
+			case Variant::OBJECT:
+				sarg.kind = CallStub::OBJECT;
+				sarg.reg = index++;
+				break;
+			case Variant::ARRAY:
+			case Variant::DICTIONARY:
+			case Variant::STRING:
+			case Variant::STRING_NAME:
+			case Variant::NODE_PATH:
+			case Variant::RID:
+			case Variant::CALLABLE:
+			case Variant::TRANSFORM2D:
+			case Variant::BASIS:
+			case Variant::TRANSFORM3D:
+			case Variant::QUATERNION:
+			case Variant::PACKED_BYTE_ARRAY:
+			case Variant::PACKED_FLOAT32_ARRAY:
+			case Variant::PACKED_FLOAT64_ARRAY:
+			case Variant::PACKED_INT32_ARRAY:
+			case Variant::PACKED_INT64_ARRAY:
+			case Variant::PACKED_VECTOR2_ARRAY:
+			case Variant::PACKED_VECTOR3_ARRAY:
+			case Variant::PACKED_VECTOR4_ARRAY:
+			case Variant::PACKED_COLOR_ARRAY:
+			case Variant::PACKED_STRING_ARRAY:
+				sarg.kind = CallStub::SCOPED;
+				sarg.reg = index++;
+				break;
+			default:
+				// Passed by reference in guest memory: leave it to setup_arguments().
+				return;
+		}
+	}
+	if (index > 18 || flindex > 18) {
+		return;
+	}
+	stub.argc = args.size();
+	m_call_stubs.emplace(address, stub);
+}
+
+const Sandbox::CallStub *Sandbox::find_call_stub(gaddr_t address, const Variant **args, int argc) const {
+	if (!this->get_unboxed_arguments()) {
+		// Boxed arguments are Variants in guest memory, whatever the signature says.
+		return nullptr;
+	}
+	auto it = m_call_stubs.find(address);
+	if (it == m_call_stubs.end() || !it->second.matches(args, argc)) {
+		return nullptr;
+	}
+	return &it->second;
+}
+
+GuestVariant *Sandbox::setup_arguments_typed(const CallStub &stub, gaddr_t &sp, const Variant **args) {
+	// Every argument goes in a register, leaving only the return value on the stack.
+	sp -= sizeof(GuestVariant);
+	sp &= ~gaddr_t(0xF); // re-align stack pointer
+	GuestVariant *retvar = m_machine->memory.memarray<GuestVariant>(sp, 1);
+	riscv::CPU<RISCV_ARCH> &cpu = m_machine->cpu;
+	cpu.reg(10) = sp;
+
+	for (int i = 0; i < stub.argc; i++) {
+		const CallStub::Arg &arg = stub.args[i];
+		const GDNativeVariant *inner = (const GDNativeVariant *)args[i]->_native_ptr();
+		switch (arg.kind) {
+			case CallStub::INT:
+				cpu.reg(arg.reg) = inner->value;
+				break;
+			case CallStub::DOUBLE:
+				cpu.registers().getfl(arg.reg).set_double(inner->flt);
+				break;
+			case CallStub::FLOAT_PAIR:
+				cpu.registers().getfl(arg.reg).set_float(inner->vec2_flt[0]);
+				cpu.registers().getfl(arg.reg + 1).set_float(inner->vec2_flt[1]);
+				break;
+			case CallStub::WORD_PAIR:
+				cpu.reg(arg.reg) = inner->value;
+				cpu.reg(arg.reg + 1) = inner->i64_padding;
+				break;
+			case CallStub::IVEC3:
+				cpu.reg(arg.reg) = inner->value;
+				cpu.reg(arg.reg + 1) = inner->ivec3_int[2];
+				break;
+			case CallStub::SCOPED:
+				cpu.reg(arg.reg) = this->add_scoped_variant(args[i]);
+				break;
+			case CallStub::OBJECT:
+				cpu.reg(arg.reg) = this->add_scoped_engine_object(uintptr_t(inner->object_ptr));
+				break;
+		}
+	}
+	return retvar;
+}
 GuestVariant *Sandbox::setup_arguments(gaddr_t &sp, const Variant **args, int argc) {
 	if (this->get_unboxed_arguments()) {
 		sp -= sizeof(GuestVariant) * (argc + 1);
@@ -974,6 +1262,10 @@ GuestVariant *Sandbox::setup_arguments(gaddr_t &sp, const Variant **args, int ar
 	return &v[overflow_args];
 }
 Variant Sandbox::vmcall_internal(gaddr_t address, const Variant **args, int argc) {
+	if (UNLIKELY(this->is_async_worker() && this->is_busy_on_worker_thread())) {
+		ERR_PRINT("Sandbox: Cannot call into a sandbox while a worker thread is running it.");
+		return Variant();
+	}
 	this->m_current_state += 1;
 	const auto *beginptr = this->m_states.data();
 	const auto *endptr = this->m_states.data() + this->m_states.size();
@@ -992,6 +1284,7 @@ Variant Sandbox::vmcall_internal(gaddr_t address, const Variant **args, int argc
 	// Call statistics
 	this->m_calls_made++;
 	Sandbox::m_global_calls_made++;
+	this->m_state_generation++;
 
 	try {
 		GuestVariant *retvar = nullptr;
@@ -1003,7 +1296,8 @@ Variant Sandbox::vmcall_internal(gaddr_t address, const Variant **args, int argc
 			// reset the stack pointer to its initial location
 			sp = m_machine->memory.stack_initial();
 			// set up each argument, and return value
-			retvar = this->setup_arguments(sp, args, argc);
+			const CallStub *stub = this->find_call_stub(address, args, argc);
+			retvar = stub ? this->setup_arguments_typed(*stub, sp, args) : this->setup_arguments(sp, args, argc);
 			// execute!
 			if (UNLIKELY(this->m_precise_simulation)) {
 				m_machine->set_instruction_counter(0);
@@ -1063,6 +1357,9 @@ Variant Sandbox::vmcall_internal(gaddr_t address, const Variant **args, int argc
 			} else {
 				m_machine->simulate_with(get_instructions_max() << 20, 0u, address);
 			}
+			if (UNLIKELY(this->m_jit_tier_pending)) {
+				this->count_jit_entry();
+			}
 		} else {
 			riscv::Registers<RISCV_ARCH> regs;
 			regs = cpu.registers();
@@ -1071,7 +1368,8 @@ Variant Sandbox::vmcall_internal(gaddr_t address, const Variant **args, int argc
 			// we need to make some stack room
 			sp -= 16u;
 			// set up each argument, and return value
-			retvar = this->setup_arguments(sp, args, argc);
+			const CallStub *stub = this->find_call_stub(address, args, argc);
+			retvar = stub ? this->setup_arguments_typed(*stub, sp, args) : this->setup_arguments(sp, args, argc);
 			// execute preemption! (precise simulation not supported)
 			uint64_t max_instr = get_instructions_max() << 20;
 			cpu.preempt_internal(regs, true, true, address, max_instr ? max_instr : ~0ULL);
@@ -1079,6 +1377,14 @@ Variant Sandbox::vmcall_internal(gaddr_t address, const Variant **args, int argc
 
 		// Treat return value as pointer to Variant
 		Variant result = retvar->toVariant(*this);
+		if (UNLIKELY(!this->m_mapped_arrays.empty())) {
+			this->unmap_packed_arrays(state);
+		}
+		// Apply the writes the guest deferred, while the Variants scoped to this call are
+		// still around. Also for nested calls, as their Variants are gone once they return.
+		if (UNLIKELY(this->m_command_buffer != 0)) {
+			this->flush_command_buffer();
+		}
 		// Restore the previous state
 		this->m_current_state -= 1;
 		return result;
@@ -1090,6 +1396,12 @@ Variant Sandbox::vmcall_internal(gaddr_t address, const Variant **args, int argc
 		}
 		this->handle_exception(address);
 		// TODO: Free the function arguments and return value? Will help keep guest memory clean
+		if (UNLIKELY(!this->m_mapped_arrays.empty())) {
+			this->unmap_packed_arrays(state);
+		}
+		if (UNLIKELY(this->m_command_buffer != 0)) {
+			this->discard_command_buffer();
+		}
 
 		this->m_current_state -= 1;
 		return Variant();
@@ -1111,6 +1423,105 @@ Variant Sandbox::vmcallable_address(gaddr_t address, Array args) {
 	call->init(this, address, std::move(args));
 	return Callable(call);
 }
+Array Sandbox::vmcall_batch(const Variant &function, const Variant &arguments) {
+	const gaddr_t address = cached_address_of_variant(function);
+	if (address == 0) {
+		ERR_PRINT("Function not found: " + function.operator String() + " (Added to the public API?)");
+		return Array();
+	}
+	if (!Variant::can_convert(arguments.get_type(), Variant::ARRAY)) {
+		ERR_PRINT("vmcall_batch: Arguments must be an Array or a packed array.");
+		return Array();
+	}
+	if (this->is_busy_on_worker_thread()) {
+		ERR_PRINT("Sandbox: Cannot call into a sandbox while a worker thread is running it.");
+		return Array();
+	}
+	// Packed arrays convert element-wise, each element becoming a single argument.
+	const Array batch = arguments;
+	Array results;
+	results.resize(batch.size());
+
+	std::array<const Variant *, 16> argptrs;
+	auto call_arguments = [&](const Variant &entry, Array &tuple) -> int {
+		if (entry.get_type() != Variant::ARRAY) {
+			argptrs[0] = &entry;
+			return 1;
+		}
+		tuple = entry;
+		if (tuple.size() > int64_t(argptrs.size())) {
+			throw std::runtime_error("Sandbox: Too many arguments for VM function call");
+		}
+		for (int i = 0; i < tuple.size(); i++) {
+			argptrs[i] = &tuple[i];
+		}
+		return tuple.size();
+	};
+
+	// Calls made from inside the guest, and calls that have to be precise or profiled,
+	// need everything vmcall_internal() does for each call.
+	if (this->is_in_vmcall() || this->m_precise_simulation || this->m_local_profiling_data != nullptr) {
+		for (int i = 0; i < batch.size(); i++) {
+			Array tuple;
+			try {
+				const int argc = call_arguments(batch[i], tuple);
+				results[i] = this->vmcall_internal(address, argptrs.data(), argc);
+			} catch (const std::exception &e) {
+				ERR_PRINT(("Sandbox exception: " + std::string(e.what())).c_str());
+			}
+		}
+		return results;
+	}
+
+	// Otherwise the call state is entered once for the whole batch, and each call only
+	// resets the stack and its own scoped Variants before running. A call that fails
+	// returns null, and the batch carries on with the next one, as vmcall() would.
+	this->m_current_state += 1;
+	CurrentState &state = *this->m_current_state;
+	riscv::CPU<RISCV_ARCH> &cpu = m_machine->cpu;
+	auto &sp = cpu.reg(riscv::REG_SP);
+	const int64_t max_instructions = get_instructions_max() << 20;
+	for (int i = 0; i < batch.size(); i++) {
+		try {
+			Array tuple;
+			const int argc = call_arguments(batch[i], tuple);
+			state.reset();
+			this->m_calls_made++;
+			Sandbox::m_global_calls_made++;
+			this->m_state_generation++;
+
+			cpu.reg(riscv::REG_RA) = m_machine->memory.exit_address();
+			sp = m_machine->memory.stack_initial();
+			const CallStub *stub = this->find_call_stub(address, argptrs.data(), argc);
+			GuestVariant *retvar = stub ? this->setup_arguments_typed(*stub, sp, argptrs.data()) : this->setup_arguments(sp, argptrs.data(), argc);
+			if (max_instructions <= 0) {
+				cpu.simulate_inaccurate(address);
+			} else {
+				m_machine->simulate_with(max_instructions, 0u, address);
+			}
+			if (UNLIKELY(this->m_jit_tier_pending)) {
+				this->count_jit_entry();
+			}
+			results[i] = retvar->toVariant(*this);
+			if (UNLIKELY(this->m_command_buffer != 0)) {
+				this->flush_command_buffer();
+			}
+		} catch (const std::exception &e) {
+			if (Engine::get_singleton()->is_editor_hint()) {
+				this->m_throttled += EDITOR_THROTTLE;
+			}
+			this->handle_exception(address);
+			if (UNLIKELY(this->m_command_buffer != 0)) {
+				this->discard_command_buffer();
+			}
+		}
+		if (UNLIKELY(!this->m_mapped_arrays.empty())) {
+			this->unmap_packed_arrays(state);
+		}
+	}
+	this->m_current_state -= 1;
+	return results;
+}
 void RiscvCallable::call(const Variant **p_arguments, int p_argcount, Variant &r_return_value, GDExtensionCallError &r_call_error) const {
 	if (m_varargs_base_count > 0) {
 		// We may be receiving extra arguments, so we will fill at the end of m_varargs_ptrs array
@@ -1138,9 +1549,16 @@ gaddr_t Sandbox::cached_address_of(int64_t hash, const String &function) const {
 	if (it != m_lookup.end()) {
 		return it->second.address;
 	} else if (m_machine != &dummy_machine) {
-		const CharString ascii = function.ascii();
-		const std::string_view str{ ascii.get_data(), (size_t)ascii.length() };
-		address = machine().address_of(str);
+		// Every instance of a program has the same symbol table, so only the first one to
+		// look for a symbol has to search it.
+		if (m_image == nullptr || !m_image->find_symbol(hash, address)) {
+			const CharString ascii = function.ascii();
+			const std::string_view str{ ascii.get_data(), (size_t)ascii.length() };
+			address = machine().address_of(str);
+			if (m_image != nullptr) {
+				m_image->add_symbol(hash, address);
+			}
+		}
 		// Cache the address and symbol name
 		LookupEntry entry{ function, address };
 		m_lookup.insert_or_assign(hash, std::move(entry));
@@ -1174,16 +1592,15 @@ gaddr_t Sandbox::cached_address_of_variant(const Variant &name) const {
 	// Read the String in place: copying it out of the Variant is two calls into the engine
 	// and two atomic refcount updates, all to look at a pointer.
 	const String &str = *(const String *)&inner->value;
-	const uintptr_t id = string_cache_key(str);
-	NameAddressCache::Entry &entry = m_name_addresses.entries[(id * 0x9E3779B97F4A7C15ull >> 32) & (NameAddressCache::SIZE - 1)];
-	if (entry.valid && string_cache_hit(entry.name, str)) {
-		return entry.address;
+	const uint64_t hash = uint64_t(string_cache_key(str)) * 0x9E3779B97F4A7C15ull >> 32;
+	if (const NameAddressEntry *entry = m_name_addresses.find(hash, [&](const NameAddressEntry &e) { return string_cache_hit(e.name, str); })) {
+		return entry->address;
 	}
 
 	const gaddr_t address = cached_address_of(str.hash(), str);
+	NameAddressEntry &entry = m_name_addresses.replace(hash);
 	entry.name = str;
 	entry.address = address;
-	entry.valid = true;
 	return address;
 }
 
@@ -1229,6 +1646,7 @@ void Sandbox::add_public_api_function(Dictionary &&func) {
 		throw std::runtime_error("Too many public functions in the Sandbox program");
 	}
 	const gaddr_t address = func.get("address", 0x0);
+	this->add_call_stub(func);
 	m_public_api_functions.push_back(std::move(func));
 	// Populate address cache.
 	this->add_cached_address(name, address);
@@ -1245,16 +1663,18 @@ void Sandbox::add_cached_address(const String &name, gaddr_t address) const {
 
 const Sandbox::CachedName &Sandbox::cached_guest_name(gaddr_t address, std::string_view name, bool terminated) const {
 	// Guest names sit at byte-aligned addresses in .rodata, so neighbouring literals would
-	// all land in adjacent slots. Mix the address before folding it into an index.
-	const unsigned index = ((address * 2654435761u) >> 8) & (GuestNameCache::SIZE - 1);
-	GuestNameCache::Entry &entry = m_guest_names.entries[index];
-
-	if (entry.address == address && entry.terminated == terminated && entry.text.size() == name.size() && guest_memcmp(entry.text.data(), name.data(), name.size()) == 0) {
-		return entry.name;
+	// all land in adjacent sets. Mix the address before folding it into an index.
+	const uint64_t hash = (address * 2654435761u) >> 8;
+	const GuestNameEntry *found = m_guest_names.find(hash, [&](const GuestNameEntry &entry) {
+		return entry.address == address && entry.terminated == terminated && entry.text.size() == name.size() && guest_memcmp(entry.text.data(), name.data(), name.size()) == 0;
+	});
+	if (found != nullptr) {
+		return found->name;
 	}
 
 	// Miss: build the name once and keep it. The two branches mirror how guests pass names:
 	// a pointer to a NUL-terminated literal, or a view into a longer string.
+	GuestNameEntry &entry = m_guest_names.replace(hash);
 	entry.address = address;
 	entry.terminated = terminated;
 	entry.text.assign(name.data(), name.size());
@@ -1267,6 +1687,257 @@ const Sandbox::CachedName &Sandbox::cached_guest_name(gaddr_t address, std::stri
 	return entry.name;
 }
 
+void Sandbox::set_name_cache_size(int entries) {
+	m_guest_names.resize(std::clamp(entries, 1, 65536));
+}
+
+void Sandbox::set_function_cache_size(int entries) {
+	m_name_addresses.resize(std::clamp(entries, 1, 65536));
+}
+
+static Dictionary cache_stats(const Sandbox::CacheCounters &counters, unsigned size) {
+	Dictionary stats;
+	stats["size"] = size;
+	stats["hits"] = counters.hits;
+	stats["misses"] = counters.misses;
+	stats["evictions"] = counters.evictions;
+	return stats;
+}
+
+Dictionary Sandbox::get_name_cache_stats() const {
+	Dictionary stats;
+	stats["names"] = cache_stats(m_guest_names.counters, m_guest_names.size());
+	stats["functions"] = cache_stats(m_name_addresses.counters, m_name_addresses.size());
+	return stats;
+}
+
+// Default arguments are looked up by argument index in MethodBind::get_hash(), so all but
+// the trailing ones hash as null there, and have to here too.
+uint32_t Sandbox::get_method_bind_hash(const Dictionary &method_info) {
+	const Dictionary return_info = method_info["return"];
+	const Array arguments = method_info["args"];
+	const Array default_args = method_info["default_args"];
+	const int flags = method_info["flags"];
+	const bool has_return = int(return_info["type"]) != Variant::NIL || (int(return_info["usage"]) & PROPERTY_USAGE_NIL_IS_VARIANT) != 0;
+
+	uint32_t hash = hash_murmur3_one_32(has_return ? 1 : 0);
+	hash = hash_murmur3_one_32(arguments.size(), hash);
+	for (int i = has_return ? -1 : 0; i < arguments.size(); i++) {
+		const Dictionary info = (i == -1) ? return_info : Dictionary(arguments[i]);
+		hash = hash_murmur3_one_32(int(info["type"]), hash);
+		const String class_name = info["class_name"];
+		if (!class_name.is_empty()) {
+			hash = hash_murmur3_one_32(uint32_t(class_name.hash()), hash);
+		}
+	}
+	hash = hash_murmur3_one_32(default_args.size(), hash);
+	const int first_default = arguments.size() - default_args.size();
+	for (int i = 0; i < default_args.size(); i++) {
+		const int idx = i - first_default;
+		const Variant value = (idx >= 0 && idx < default_args.size()) ? default_args[idx] : Variant();
+		hash = hash_murmur3_one_32(value.hash(), hash);
+	}
+	hash = hash_murmur3_one_32((flags & METHOD_FLAG_CONST) != 0, hash);
+	hash = hash_murmur3_one_32((flags & METHOD_FLAG_VARARG) != 0, hash);
+	return hash_fmix32(hash);
+}
+
+// The types that are passed to and from ptrcall in the same form as in a PtrCallSlot,
+// except for bool, which is a single byte there. The guest has 32-bit real_t, so types
+// made of real_t only match it when the engine does too, and are otherwise called by name.
+static_assert(sizeof(int64_t) <= sizeof(PtrCallSlot) && sizeof(double) <= sizeof(PtrCallSlot));
+static_assert(sizeof(Vector2i) <= sizeof(PtrCallSlot) && sizeof(Rect2i) <= sizeof(PtrCallSlot));
+static_assert(sizeof(Vector3i) <= sizeof(PtrCallSlot) && sizeof(Vector4i) <= sizeof(PtrCallSlot));
+static_assert(sizeof(Color) <= sizeof(PtrCallSlot));
+#ifndef REAL_T_IS_DOUBLE
+static_assert(sizeof(Vector2) <= sizeof(PtrCallSlot) && sizeof(Rect2) <= sizeof(PtrCallSlot));
+static_assert(sizeof(Vector3) <= sizeof(PtrCallSlot) && sizeof(Vector4) <= sizeof(PtrCallSlot));
+static_assert(sizeof(Plane) <= sizeof(PtrCallSlot) && sizeof(Quaternion) <= sizeof(PtrCallSlot));
+#endif
+static bool is_ptrcall_type(int type) {
+	switch (type) {
+		case Variant::BOOL:
+		case Variant::INT:
+		case Variant::FLOAT:
+		case Variant::VECTOR2I:
+		case Variant::RECT2I:
+		case Variant::VECTOR3I:
+		case Variant::VECTOR4I:
+		case Variant::COLOR:
+			return true;
+#ifndef REAL_T_IS_DOUBLE
+		case Variant::VECTOR2:
+		case Variant::RECT2:
+		case Variant::VECTOR3:
+		case Variant::VECTOR4:
+		case Variant::PLANE:
+		case Variant::QUATERNION:
+			return true;
+#endif
+		default:
+			return false;
+	}
+}
+
+bool Sandbox::is_ptrcall_method(const Dictionary &method_info) {
+	const int flags = method_info["flags"];
+	if (flags & (METHOD_FLAG_VARARG | METHOD_FLAG_STATIC)) {
+		return false;
+	}
+	const Array arguments = method_info["args"];
+	if (arguments.size() > 8) {
+		return false;
+	}
+	// Objects may be passed in, as their address. Returning one would mean taking a reference.
+	for (int i = 0; i < arguments.size(); i++) {
+		const int type = Dictionary(arguments[i])["type"];
+		if (type != Variant::OBJECT && !is_ptrcall_type(type)) {
+			return false;
+		}
+	}
+	const Dictionary return_info = method_info["return"];
+	const int return_type = return_info["type"];
+	if (return_type == Variant::NIL) {
+		return (int(return_info["usage"]) & PROPERTY_USAGE_NIL_IS_VARIANT) == 0;
+	}
+	return is_ptrcall_type(return_type);
+}
+
+// Methods by class and method name, shared by every sandbox. Object calls run on the main
+// thread, which is the only one to touch this.
+static const Sandbox::ResolvedMethod &resolve_method(const StringName &class_name, const StringName &method) {
+	static HashMap<StringName, HashMap<StringName, Sandbox::ResolvedMethod>> resolved_classes;
+	HashMap<StringName, Sandbox::ResolvedMethod> &resolved_methods = resolved_classes[class_name];
+	if (const Sandbox::ResolvedMethod *resolved = resolved_methods.getptr(method)) {
+		return *resolved;
+	}
+	Sandbox::ResolvedMethod resolved;
+	const TypedArray<Dictionary> methods = ClassDBSingleton::get_singleton()->class_get_method_list(class_name, false);
+	for (int i = 0; i < methods.size(); i++) {
+		const Dictionary info = methods[i];
+		if (StringName(info["name"]) != method) {
+			continue;
+		}
+		resolved.hash = Sandbox::get_method_bind_hash(info);
+		resolved.bind = internal::gdextension_interface_classdb_get_method_bind(
+				class_name._native_ptr(), method._native_ptr(), resolved.hash);
+		if (resolved.bind != nullptr && Sandbox::is_ptrcall_method(info)) {
+			const Array arguments = info["args"];
+			resolved.ptrcall = true;
+			resolved.argc = arguments.size();
+			for (int j = 0; j < arguments.size(); j++) {
+				const Dictionary argument = arguments[j];
+				resolved.arg_types[j] = Variant::Type(int(argument["type"]));
+				if (resolved.arg_types[j] == Variant::OBJECT) {
+					resolved.arg_classes[j] = argument["class_name"];
+				}
+			}
+			resolved.return_type = Variant::Type(int(Dictionary(info["return"])["type"]));
+		}
+		break;
+	}
+	// HashMap elements stay where they are, so call sites can point at them.
+	return resolved_methods.insert(method, resolved)->value;
+}
+
+Sandbox::MethodCallSiteCache::Entry &Sandbox::method_call_site(gaddr_t site, godot::Object *obj, const StringName &method) const {
+	StringName class_name;
+	internal::gdextension_interface_object_get_class_name(obj->_owner, internal::library, class_name._native_ptr());
+
+	const uint32_t key = uint32_t(site * 2654435761u) ^ method.hash();
+	MethodCallSiteCache::Entry &entry = m_method_call_sites.entries[(key >> 8) & (MethodCallSiteCache::SIZE - 1)];
+	if (entry.site != site || entry.method != method || entry.class_name != class_name) {
+		// Miss: a new call site, or one that is called with another method or class.
+		entry.site = site;
+		entry.method = method;
+		entry.class_name = class_name;
+		entry.resolved = &resolve_method(class_name, method);
+	}
+	return entry;
+}
+
+GDExtensionMethodBindPtr Sandbox::cached_method_bind(gaddr_t site, godot::Object *obj, const StringName &method) const {
+	MethodCallSiteCache::Entry &entry = this->method_call_site(site, obj, method);
+	if (entry.resolved->bind == nullptr) {
+		return nullptr;
+	}
+	// A script is called first when calling by name, and may have a method of the same name.
+	// Scripts can be attached at any time, so this is checked on every call.
+	if (obj->get_script().get_type() != Variant::NIL) {
+		return nullptr;
+	}
+	return entry.resolved->bind;
+}
+
+const Sandbox::ResolvedMethod *Sandbox::cached_ptrcall_method(gaddr_t site, godot::Object *obj, const StringName &method, uint32_t hash) const {
+	const ResolvedMethod &resolved = *this->method_call_site(site, obj, method).resolved;
+	if (!resolved.ptrcall || resolved.hash != hash) {
+		return nullptr;
+	}
+	return &resolved;
+}
+
+static inline unsigned node_path_index(uint64_t base_id, gaddr_t address) {
+	return (((address ^ base_id) * 2654435761u) >> 8) & (Sandbox::NodePathCache::SIZE - 1);
+}
+
+Node *Sandbox::cached_node_path(Node *base, gaddr_t address, std::string_view path, const NodePath *interned) const {
+	const uint64_t base_id = base->get_instance_id();
+	const NodePathCache::Entry &entry = m_node_paths.entries[node_path_index(base_id, address)];
+	if (entry.base_id != base_id || entry.address != address || entry.is_interned != (interned != nullptr)) {
+		return nullptr;
+	}
+	if (interned != nullptr) {
+		if (entry.interned != *interned) {
+			return nullptr;
+		}
+	} else if (entry.path.size() != path.size() || guest_memcmp(entry.path.data(), path.data(), path.size()) != 0) {
+		return nullptr;
+	}
+	Node *node = Object::cast_to<Node>(ObjectDB::get_instance(entry.node_id));
+	if (node == nullptr) {
+		return nullptr;
+	}
+	// The path still leads to the node as long as every node on the way has the same name,
+	// and the same parent.
+	Node *current = node;
+	for (size_t i = entry.names.size(); i > 0; i--) {
+		if (current == nullptr || current == base || current->get_name() != entry.names[i - 1]) {
+			return nullptr;
+		}
+		current = current->get_parent();
+	}
+	return current == base ? node : nullptr;
+}
+
+void Sandbox::cache_node_path(Node *base, gaddr_t address, std::string_view path, const NodePath &node_path, Node *node, bool interned) const {
+	if (node_path.is_absolute() || node_path.get_subname_count() != 0) {
+		return;
+	}
+	std::vector<StringName> names;
+	names.reserve(node_path.get_name_count());
+	for (int i = 0; i < node_path.get_name_count(); i++) {
+		const StringName name = node_path.get_name(i);
+		const String text = name;
+		if (text == ".") {
+			continue;
+		}
+		if (text == ".." || text.begins_with("%")) {
+			return;
+		}
+		names.push_back(name);
+	}
+	const uint64_t base_id = base->get_instance_id();
+	NodePathCache::Entry &entry = m_node_paths.entries[node_path_index(base_id, address)];
+	entry.base_id = base_id;
+	entry.address = address;
+	entry.path.assign(path.data(), path.size());
+	entry.interned = interned ? node_path : NodePath();
+	entry.is_interned = interned;
+	entry.node_id = node->get_instance_id();
+	entry.names = std::move(names);
+}
+
 //-- Scoped objects and variants --//
 
 unsigned Sandbox::add_scoped_variant(const Variant *value) const {
@@ -1297,16 +1968,11 @@ std::optional<const Variant *> Sandbox::get_scoped_variant(int32_t index) const
 	if (index >= 0 && index < state().scoped_variants.size()) {
 		return state().scoped_variants[index];
 	} else if (index < 0) {
-		// Negative index is access into initialization state. INT32_MIN has no positive
-		// counterpart, so negating it is undefined behaviour rather than an invalid index.
-		if (UNLIKELY(index == INT32_MIN)) {
-			ERR_PRINT("Invalid permanent variant index: " + itos(index));
-			return std::nullopt;
-		}
-		index = -index - 1;
+		// Negative index is access into initialization state.
 		auto &init_state = this->m_states[0];
-		if (index < init_state.scoped_variants.size()) {
-			return init_state.scoped_variants[index];
+		const int64_t slot = init_state.find_permanent_slot(index);
+		if (slot >= 0) {
+			return init_state.scoped_variants[slot];
 		}
 		ERR_PRINT("Invalid permanent variant index: " + itos(index));
 		return std::nullopt;
@@ -1317,10 +1983,10 @@ std::optional<const Variant *> Sandbox::get_scoped_variant(int32_t index) const
 Variant &Sandbox::get_mutable_scoped_variant(int32_t index) {
 	// Resolve permanent indices in the permanent state.
 	CurrentState *st = &this->state();
-	int32_t slot = index;
+	int64_t slot = index;
 	if (is_permanent_variant(index)) {
 		st = &this->m_states[0];
-		slot = -index - 1;
+		slot = st->find_permanent_slot(index);
 	}
 	if (slot < 0 || size_t(slot) >= st->scoped_variants.size()) {
 		ERR_PRINT("Invalid scoped variant index: " + itos(index));
@@ -1350,37 +2016,99 @@ unsigned Sandbox::create_permanent_variant(unsigned idx) {
 		throw std::runtime_error("Could not make permanent: Invalid scoped variant index " + std::to_string(idx));
 	}
 	const Variant *var = var_opt.value();
-	// Find the variant in the variants list
-	auto it = std::find_if(state().variants.begin(), state().variants.end(), [var](const Variant &v) {
-		return &v == var;
-	});
-
+	if (state().is_mutable_variant(*var)) {
+		// Move the variant to the permanent list, leave the old one in the scoped list
+		return this->add_permanent_variant(std::move(const_cast<Variant &>(*var)));
+	}
+	// Not ours (eg. a caller argument), so it is duplicated instead
+	return this->add_permanent_variant(var->duplicate());
+}
+int32_t Sandbox::add_permanent_variant(Variant &&var) {
 	CurrentState &perm_state = this->m_states[0];
-	if (perm_state.variants.size() >= perm_state.variants.capacity()) {
+	if (!perm_state.free_slots.empty()) {
+		const uint32_t slot = perm_state.free_slots.back();
+		const Variant *old = perm_state.scoped_variants[slot];
+		if (perm_state.is_mutable_variant(*old)) {
+			const_cast<Variant &>(*old) = std::move(var);
+		} else if (perm_state.variants.size() < perm_state.variants.capacity()) {
+			// The slot pointed to a Variant that was never ours, and needs one of its own.
+			perm_state.variants.push_back(std::move(var));
+			perm_state.scoped_variants[slot] = &perm_state.variants.back();
+		} else {
+			ERR_PRINT("Maximum number of scoped variants in permanent state reached.");
+			throw std::runtime_error("Maximum number of scoped variants in permanent state reached.");
+		}
+		perm_state.free_slots.pop_back();
+		uint16_t &generation = perm_state.generations[slot];
+		generation &= PERMANENT_GENERATION_MASK;
+		return permanent_handle(slot, generation);
+	}
+	if (perm_state.variants.size() >= perm_state.variants.capacity() || perm_state.scoped_variants.size() >= PERMANENT_SLOTS_MAX) {
 		ERR_PRINT("Maximum number of scoped variants in permanent state reached.");
-		// Just return the old scoped variant
-		return idx;
+		throw std::runtime_error("Maximum number of scoped variants in permanent state reached.");
+	}
+	perm_state.append(std::move(var));
+	return permanent_handle(perm_state.scoped_variants.size() - 1, 0);
+}
+void Sandbox::release_permanent_variant(int32_t idx) {
+	CurrentState &perm_state = this->m_states[0];
+	const int64_t slot = perm_state.find_permanent_slot(idx);
+	if (slot < 0) {
+		ERR_PRINT("Invalid permanent variant index: " + itos(idx));
+		throw std::runtime_error("Invalid permanent variant index: " + std::to_string(idx));
+	}
+	if (size_t(slot) >= perm_state.generations.size()) {
+		perm_state.generations.resize(slot + 1, 0);
+	}
+	uint16_t &generation = perm_state.generations[slot];
+	generation = ((generation + 1) & PERMANENT_GENERATION_MASK) | PERMANENT_SLOT_RELEASED;
+	// Whatever the Variant holds goes now, and the storage stays for the next one.
+	const Variant *var = perm_state.scoped_variants[slot];
+	if (perm_state.is_mutable_variant(*var)) {
+		const_cast<Variant &>(*var) = Variant();
+	}
+	perm_state.free_slots.push_back(slot);
+}
+unsigned Sandbox::intern_name(std::string_view name, Variant::Type type) {
+	const String text = String::utf8(name.data(), name.size());
+	std::string key(name);
+	key.push_back(char(type));
+	// A permanent Variant may have been replaced since, by a reset, a restored state or the
+	// guest assigning to it or releasing it, so it is checked before handing out the same
+	// handle again.
+	const CurrentState &perm_state = this->m_states[0];
+	auto it = this->m_interned_names.find(key);
+	if (it != this->m_interned_names.end()) {
+		const int64_t slot = perm_state.find_permanent_slot(it->second);
+		if (slot >= 0) {
+			const Variant *var = perm_state.scoped_variants[slot];
+			if (var->get_type() == type && String(*var) == text) {
+				return it->second;
+			}
+		}
 	}
 
-	if (it == state().variants.end()) {
-		// Create a new variant in the permanent list
-		perm_state.append(var->duplicate());
-	} else {
-		// Move the variant to the permanent list, leave the old one in the scoped list
-		perm_state.append(std::move(*it));
+	const int32_t handle = (type == Variant::NODE_PATH) ? this->add_permanent_variant(NodePath(text)) : this->add_permanent_variant(StringName(text));
+	this->m_interned_names[std::move(key)] = handle;
+	return handle;
+}
+
+const Variant &Sandbox::get_interned_name(unsigned handle, Variant::Type type) const {
+	const int32_t idx = handle;
+	const CurrentState &perm_state = this->m_states[0];
+	const int64_t slot = perm_state.find_permanent_slot(idx);
+	if (LIKELY(slot >= 0 && perm_state.scoped_variants[slot]->get_type() == type)) {
+		return *perm_state.scoped_variants[slot];
 	}
-	unsigned perm_idx = perm_state.variants.size() - 1;
-	// Return the index of the new permanent variant converted to negative
-	return -int32_t(perm_idx) - 1;
+	ERR_PRINT("Invalid name handle: " + itos(idx));
+	throw std::runtime_error("Invalid name handle: " + std::to_string(idx));
 }
+
 void Sandbox::assign_permanent_variant(int32_t idx, Variant &&val) {
-	if (idx < 0) {
-		// It's a permanent variant, verify the index
-		idx = -idx - 1;
-		if (idx < this->m_states[0].variants.size()) {
-			this->m_states[0].variants[idx] = std::move(val);
-			return;
-		}
+	if (this->m_states[0].find_permanent_slot(idx) >= 0) {
+		// It's a permanent variant, assigned through its slot
+		this->get_mutable_scoped_variant(idx) = std::move(val);
+		return;
 	}
 	// It's either a scoped (temporary) variant, or invalid
 	ERR_PRINT("Invalid permanent variant index.");
@@ -1425,6 +2153,7 @@ void Sandbox::rem_scoped_object(const godot::Object *obj) {
 	objects.erase(std::remove_if(objects.begin(), objects.end(),
 						  [engine_object](const CurrentState::ScopedObject &so) { return so.engine_object == engine_object; }),
 			objects.end());
+	state().reindex_scoped_objects();
 }
 
 godot::Object *Sandbox::resolve_scoped_object(CurrentState::ScopedObject &so) {
@@ -1445,7 +2174,7 @@ bool Sandbox::add_scoped_entry(uintptr_t engine_object, godot::Object *binding)
 		ERR_PRINT("Maximum number of scoped objects reached.");
 		throw std::runtime_error("Maximum number of scoped objects reached.");
 	}
-	state().scoped_objects.push_back(CurrentState::ScopedObject{ engine_object, binding });
+	state().add_scoped_object(engine_object, binding);
 	return true;
 }
 
@@ -1597,6 +2326,9 @@ bool Sandbox::set_property(const StringName &name, const Variant &value) {
 	} else if (stringname_equals(name, property_names[PROP_BINTR_REG_CACHE])) {
 		set_binary_translation_register_caching(value);
 		return true;
+	} else if (stringname_equals(name, property_names[PROP_JIT_TIER_UP_THRESHOLD])) {
+		set_jit_tier_up_threshold(value);
+		return true;
 	} else if (stringname_equals(name, property_names[PROP_PROFILING])) {
 		set_profiling(value);
 		return true;
@@ -1646,6 +2378,9 @@ bool Sandbox::get_property(const StringName &name, Variant &r_ret) {
 	} else if (stringname_equals(name, property_names[PROP_BINTR_REG_CACHE])) {
 		r_ret = this->m_bintr_register_caching;
 		return true;
+	} else if (stringname_equals(name, property_names[PROP_JIT_TIER_UP_THRESHOLD])) {
+		r_ret = get_jit_tier_up_threshold();
+		return true;
 	} else if (stringname_equals(name, property_names[PROP_PROFILING])) {
 		r_ret = get_profiling();
 		return true;
@@ -1667,6 +2402,12 @@ bool Sandbox::get_property(const StringName &name, Variant &r_ret) {
 	} else if (stringname_equals(name, property_names[PROP_MONITOR_HEAP_DEALLOCATION_COUNTER])) {
 		r_ret = get_heap_deallocation_counter();
 		return true;
+	} else if (stringname_equals(name, property_names[PROP_MONITOR_MEMORY_RESERVED])) {
+		r_ret = get_memory_reserved();
+		return true;
+	} else if (stringname_equals(name, property_names[PROP_MONITOR_MEMORY_COMMITTED])) {
+		r_ret = get_memory_committed();
+		return true;
 	} else if (stringname_equals(name, property_names[PROP_MONITOR_EXCEPTIONS])) {
 		r_ret = get_exceptions();
 		return true;
@@ -1679,6 +2420,12 @@ bool Sandbox::get_property(const StringName &name, Variant &r_ret) {
 	} else if (stringname_equals(name, property_names[PROP_MONITOR_BINARY_TRANSLATED])) {
 		r_ret = is_binary_translated();
 		return true;
+	} else if (stringname_equals(name, property_names[PROP_MONITOR_JIT_ENTRIES])) {
+		r_ret = get_jit_entries();
+		return true;
+	} else if (stringname_equals(name, property_names[PROP_MONITOR_JIT_TIER_UPS])) {
+		r_ret = get_jit_tier_ups();
+		return true;
 	} else if (stringname_equals(name, property_names[PROP_GLOBAL_CALLS_MADE])) {
 		r_ret = get_global_calls_made();
 		return true;
@@ -1782,17 +2529,95 @@ Variant SandboxProperty::get(const Sandbox &sandbox) const {
 	return const_cast<Sandbox &>(sandbox).vmcall_internal(m_getter_address, nullptr, 0);
 }
 
+void Sandbox::CurrentState::copy_from(const CurrentState &other) {
+	this->reset();
+	this->variants.reserve(other.variants.capacity());
+	for (const Variant &var : other.variants) {
+		this->variants.push_back(var.duplicate());
+	}
+	for (const Variant *var : other.scoped_variants) {
+		if (other.is_mutable_variant(*var)) {
+			this->scoped_variants.push_back(&this->variants[var - other.variants.data()]);
+		} else {
+			this->scoped_variants.push_back(var);
+		}
+	}
+	this->generations = other.generations;
+	this->free_slots = other.free_slots;
+	this->scoped_objects = other.scoped_objects;
+	this->scoped_refs = other.scoped_refs;
+	this->reindex_scoped_objects();
+}
 void Sandbox::CurrentState::initialize(unsigned level, unsigned max_refs) {
 	(void)level;
-	this->variants.reserve(max_refs);
+	// Every call level gets room for max_refs of everything up front, so that calls never
+	// grow these, and reset() between calls never has to give memory back.
+	if (max_refs > this->variants.capacity()) {
+		// Slots point into variants, and have to follow them when reserving moves them.
+		std::vector<ptrdiff_t> owned(this->scoped_variants.size(), -1);
+		for (size_t i = 0; i < this->scoped_variants.size(); i++) {
+			if (this->is_mutable_variant(*this->scoped_variants[i]))
+				owned[i] = this->scoped_variants[i] - this->variants.data();
+		}
+		this->variants.reserve(max_refs);
+		for (size_t i = 0; i < owned.size(); i++) {
+			if (owned[i] >= 0)
+				this->scoped_variants[i] = &this->variants[owned[i]];
+		}
+	}
+	this->scoped_variants.reserve(max_refs);
+	this->scoped_objects.reserve(max_refs);
+	this->scoped_refs.reserve(max_refs);
+	this->object_index.reserve(max_refs);
+	this->reindex_scoped_objects();
 }
 void Sandbox::CurrentState::reinitialize(unsigned level, unsigned max_refs) {
-	(void)level;
-	this->variants.reserve(max_refs);
-	this->variants.clear();
-	this->scoped_objects.clear();
-	this->scoped_variants.clear();
-	this->scoped_refs.clear();
+	this->reset();
+	this->initialize(level, max_refs);
+}
+void Sandbox::CurrentState::reindex_scoped_objects() {
+	this->object_index.clear();
+	for (size_t i = 0; i < this->scoped_objects.size(); i++) {
+		this->object_index.insert(this->scoped_objects[i].engine_object, i);
+	}
+}
+void Sandbox::CurrentState::ScopedObjectIndex::reserve(unsigned max_objects) {
+	// At most half full, which keeps probe sequences short.
+	size_t size = 16;
+	while (size < size_t(max_objects) * 2)
+		size *= 2;
+	if (size > this->slots.size()) {
+		this->slots.assign(size, Slot{});
+		this->generation = 1;
+		this->count = 0;
+	}
+}
+void Sandbox::CurrentState::ScopedObjectIndex::insert(uintptr_t engine_object, uint32_t index) {
+	if (UNLIKELY((this->count + 1) * 2 > this->slots.size())) {
+		// Only reached when objects are scoped past max_refs, eg. in the permanent state.
+		std::vector<Slot> old_slots = std::move(this->slots);
+		const uint32_t old_generation = this->generation;
+		this->slots.assign(std::max<size_t>(16, old_slots.size() * 2), Slot{});
+		this->generation = 1;
+		this->count = 0;
+		for (const Slot &slot : old_slots) {
+			if (slot.generation == old_generation)
+				this->insert(slot.engine_object, slot.index);
+		}
+	}
+	const size_t mask = this->slots.size() - 1;
+	for (size_t i = hash(engine_object) & mask;; i = (i + 1) & mask) {
+		Slot &slot = this->slots[i];
+		if (slot.generation != this->generation) {
+			slot = Slot{ engine_object, index, this->generation };
+			this->count++;
+			return;
+		}
+		if (slot.engine_object == engine_object) {
+			slot.index = index;
+			return;
+		}
+	}
 }
 bool Sandbox::CurrentState::is_mutable_variant(const Variant &var) const {
 	// Check if the address of the variant is within the range of the current state std::vector.
@@ -1817,39 +2642,86 @@ void Sandbox::set_max_refs(uint32_t max) {
 
 void Sandbox::set_allocations_max(int64_t max) {
 	this->m_allocations_max = max;
+	this->m_state_generation++;
 	if (machine().has_arena()) {
 		machine().arena().set_max_chunks(max);
 	}
+	if (GuestHeapStats *heap = guest_heap_stats()) {
+		heap->max_blocks = max;
+	}
 }
 
+void Sandbox::find_guest_heap() {
+	this->m_guest_heap = machine().address_of(GUEST_HEAP_SYMBOL);
+	// Small blocks never reach the arena, so the guest enforces the limit on them itself.
+	if (GuestHeapStats *heap = guest_heap_stats()) {
+		heap->max_blocks = get_allocations_max();
+	}
+}
+
+GuestHeapStats *Sandbox::guest_heap_stats() const {
+	if (this->m_guest_heap == 0) {
+		return nullptr;
+	}
+	try {
+		return m_machine->memory.memarray<GuestHeapStats>(this->m_guest_heap, 1);
+	} catch (const std::exception &e) {
+		return nullptr;
+	}
+}
+
+// The regions the guest hands its small blocks out from are arena chunks too. The
+// monitors count the small blocks in their place.
 int64_t Sandbox::get_heap_usage() const {
 	if (machine().has_arena()) {
-		return machine().arena().bytes_used();
+		const GuestHeapStats *heap = guest_heap_stats();
+		const int64_t used = machine().arena().bytes_used();
+		return heap ? used - heap->region_bytes + heap->live_bytes : used;
 	}
 	return 0;
 }
 
 int64_t Sandbox::get_heap_chunk_count() const {
 	if (machine().has_arena()) {
-		return machine().arena().chunks_used();
+		const GuestHeapStats *heap = guest_heap_stats();
+		const int64_t chunks = machine().arena().chunks_used();
+		return heap ? chunks - heap->regions + heap->live_blocks : chunks;
 	}
 	return 0;
 }
 
 int64_t Sandbox::get_heap_allocation_counter() const {
 	if (machine().has_arena()) {
-		return machine().arena().allocation_counter();
+		const GuestHeapStats *heap = guest_heap_stats();
+		const int64_t count = machine().arena().allocation_counter();
+		return heap ? count - heap->regions + heap->allocations : count;
 	}
 	return 0;
 }
 
 int64_t Sandbox::get_heap_deallocation_counter() const {
 	if (machine().has_arena()) {
-		return machine().arena().deallocation_counter();
+		const GuestHeapStats *heap = guest_heap_stats();
+		const int64_t count = machine().arena().deallocation_counter();
+		return heap ? count + heap->deallocations : count;
 	}
 	return 0;
 }
 
+int64_t Sandbox::get_memory_reserved() const {
+	if (!this->has_program_loaded()) {
+		return 0;
+	}
+	return machine().memory.memory_arena_size();
+}
+
+int64_t Sandbox::get_memory_committed() const {
+	if (!this->has_program_loaded()) {
+		return 0;
+	}
+	return committed_bytes(machine().memory.memory_arena_ptr(), machine().memory.memory_arena_size());
+}
+
 // One print() call holds the text of every one of its arguments at once, which
 // is the one place in the guest print path where host memory scales with the
 // argument count rather than with a single argument. Past this the line is cut
@@ -1858,6 +2730,13 @@ int64_t Sandbox::get_heap_deallocation_counter() const {
 static constexpr int PRINT_LINE_MAX_CHARS = 1 << 18;
 
 void Sandbox::print(const Variant *const *args, unsigned count, Print_Channel channel) {
+	// Guest output from an asynchronous call is printed by the main thread, in order.
+	if (UNLIKELY(this->is_on_worker_thread())) {
+		m_worker->run_on_main_thread([&]() {
+			this->print(args, count, channel);
+		});
+		return;
+	}
 	// The latch covers the conversion, not just the output. Stringifying an
 	// argument runs Variant::operator String(), which for an Object reaches
 	// Object::to_string() and from there a script's _to_string() - and when that
@@ -1941,8 +2820,17 @@ bool Sandbox::is_sandbox_function(const StringName &p_function) const {
 	static const HashSet<StringName> sandbox_functions = {
 		"vmcall",
 		"vmcall_address",
+		"vmcall_batch",
+		"vmcall_async",
 		"vmcallable",
 		"vmcallable_address",
+		"fork_from",
+		"save_snapshot",
+		"load_snapshot",
+		"checkpoint",
+		"rollback",
+		"save_state",
+		"restore_state",
 		"get_program",
 		"set_program",
 		"has_function",
@@ -1952,6 +2840,8 @@ bool Sandbox::is_sandbox_function(const StringName &p_function) const {
 		"set_max_refs",
 		"get_memory_max",
 		"set_memory_max",
+		"get_memory_reserved",
+		"get_memory_committed",
 		"get_instructions_max",
 		"set_instructions_max",
 		"get_allocations_max",
@@ -1968,11 +2858,20 @@ bool Sandbox::is_sandbox_function(const StringName &p_function) const {
 		"get_timeouts",
 		"get_calls_made",
 		"is_binary_translated",
+		"get_jit_entries",
+		"get_jit_tier_ups",
+		"get_jit_tier_up_threshold",
+		"set_jit_tier_up_threshold",
 		"get_global_calls_made",
 		"get_global_exceptions",
 		"get_global_timeouts",
 		"get_accumulated_startup_time",
 		"get_global_instance_count",
+		"get_name_cache_size",
+		"set_name_cache_size",
+		"get_function_cache_size",
+		"set_function_cache_size",
+		"get_name_cache_stats",
 
 		"set_object_allowed_callback",
 		"is_allowed_object",
@@ -1,5 +1,7 @@
 #pragma once
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <godot_cpp/classes/node.hpp>
 #include <godot_cpp/classes/ref_counted.hpp>
 #include <godot_cpp/core/binder_common.hpp>
@@ -15,6 +17,8 @@ using machine_t = riscv::Machine<RISCV_ARCH>;
 #include "stringname_id.hpp"
 #include "vmcallable.h"
 #include "vmproperty.h"
+class SandboxAsyncCall;
+class SandboxWorkerContext;
 
 /**
  * @brief The Sandbox class is a Godot node that provides a safe environment for running untrusted code.
@@ -48,6 +52,20 @@ public:
 	static constexpr unsigned EDITOR_THROTTLE = 8; // Throttle VM calls from the editor
 	static constexpr unsigned MAX_PROPERTIES = 32; // Maximum number of sandboxed properties
 	static constexpr unsigned MAX_PUBLIC_FUNCTIONS = 128; // Maximum number of public functions
+	static constexpr int HEAP_SYSCALLS_BASE = 480; // First of the native heap system calls
+	static constexpr int MEMORY_SYSCALLS_BASE = 485; // First of the native memory system calls
+
+	// A permanent Variant is known to the guest as -(1 + slot + (generation << PERMANENT_SLOT_BITS)).
+	// The generation changes every time the slot is released, so that handles to whatever it
+	// held before stop working instead of reaching whatever it holds now.
+	static constexpr unsigned PERMANENT_SLOT_BITS = 20;
+	// One short of what the bits hold, which would make the last slot at the last generation INT32_MIN.
+	static constexpr uint32_t PERMANENT_SLOTS_MAX = (1u << PERMANENT_SLOT_BITS) - 1;
+	static constexpr uint16_t PERMANENT_GENERATION_MASK = 0x7FF;
+	static constexpr uint16_t PERMANENT_SLOT_RELEASED = 0x8000;
+	static int32_t permanent_handle(uint32_t slot, uint16_t generation) noexcept {
+		return -int32_t(slot + (uint32_t(generation) << PERMANENT_SLOT_BITS)) - 1;
+	}
 
 	struct CurrentState {
 		std::vector<Variant> variants;
@@ -64,13 +82,53 @@ public:
 			/// otherwise the first time the guest actually uses the handle.
 			godot::Object *binding;
 		};
+		/// @brief Permanent state only: the generation of every slot that was ever released,
+		/// with PERMANENT_SLOT_RELEASED set while it is free, and the free slots. Slots past
+		/// the end of generations were never released, and are at generation 0.
+		std::vector<uint16_t> generations;
+		std::vector<uint32_t> free_slots;
 		std::vector<ScopedObject> scoped_objects;
 		/// @brief Holds a reference to every RefCounted handed to the guest during this
 		/// call. Without it a Ref returned by value dies with the temporary Variant it
 		/// arrived in, and the guest is left with a pointer to freed memory.
 		std::vector<Ref<RefCounted>> scoped_refs;
+		/// @brief Open-addressed index from engine object to its entry in scoped_objects,
+		/// so that looking up an object doesn't scan every object scoped by the call.
+		/// @note A slot is only in use when it carries the current generation. That makes
+		/// emptying the index between calls a single increment, whatever its size.
+		struct ScopedObjectIndex {
+			struct Slot {
+				uintptr_t engine_object = 0;
+				uint32_t index = 0;
+				uint32_t generation = 0;
+			};
+			std::vector<Slot> slots;
+			uint32_t generation = 1;
+			uint32_t count = 0;
+
+			void reserve(unsigned max_objects);
+			void clear() noexcept;
+			int find(uintptr_t engine_object) const noexcept;
+			void insert(uintptr_t engine_object, uint32_t index);
+
+		private:
+			static size_t hash(uintptr_t engine_object) noexcept { return size_t((uint64_t(engine_object) * 0x9E3779B97F4A7C15ull) >> 32); }
+		} object_index;
 
 		void append(Variant &&value);
+		/// @brief Permanent state only: the slot that a handle from permanent_handle() refers to.
+		/// @return The slot, or -1 if the handle is invalid, or to a slot that was released since.
+		int64_t find_permanent_slot(int32_t idx) const noexcept;
+		ScopedObject *find_scoped_object(uintptr_t engine_object) noexcept {
+			const int index = object_index.find(engine_object);
+			return index >= 0 ? &scoped_objects[index] : nullptr;
+		}
+		void add_scoped_object(uintptr_t engine_object, godot::Object *binding);
+		/// @brief Index every scoped object again, after scoped_objects was changed wholesale.
+		void reindex_scoped_objects();
+		/// @brief Become a copy of another state, with Variants of its own that its slots
+		/// point to the same way the other state's slots point to the other's Variants.
+		void copy_from(const CurrentState &other);
 		void initialize(unsigned level, unsigned max_refs);
 		void reinitialize(unsigned level, unsigned max_refs);
 		void reset();
@@ -80,6 +138,38 @@ public:
 		String name;
 		gaddr_t address;
 	};
+	/// @brief Where each argument of a public API function goes when it is called with
+	/// unboxed arguments, worked out once from the signature the guest published.
+	/// @note Only used when a call's arguments have exactly the published types. Anything
+	/// else goes through setup_arguments(), which decides the same thing for each call.
+	struct CallStub {
+		enum Kind : uint8_t {
+			INT, // One integer register
+			DOUBLE, // One float register
+			FLOAT_PAIR, // Two float registers, as floats
+			WORD_PAIR, // Two integer registers
+			IVEC3, // Two integer registers, the last one holding a single int32
+			SCOPED, // Index of a scoped Variant in one integer register
+			OBJECT, // Scoped object handle in one integer register
+		};
+		struct Arg {
+			Variant::Type type;
+			Kind kind;
+			uint8_t reg;
+		};
+		std::array<Arg, 8> args;
+		uint8_t argc = 0;
+
+		bool matches(const Variant **p_args, int p_argc) const noexcept {
+			if (p_argc != argc)
+				return false;
+			for (int i = 0; i < p_argc; i++) {
+				if (p_args[i]->get_type() != args[i].type)
+					return false;
+			}
+			return true;
+		}
+	};
 	/// @brief A restriction callback, paired with a cached copy of its validity.
 	/// @note Callable::is_valid() crosses into Godot and looks the target up in the object
 	/// database, which is far more work than a check guarding every single API call can
@@ -104,14 +194,124 @@ public:
 		StringName sname;
 		Variant variant; // Holds sname
 	};
-	// Direct-mapped cache of guest method and property names, see cached_guest_name().
-	struct GuestNameCache {
-		static constexpr unsigned SIZE = 32; // Must be a power of two
+	/// @brief Hits, misses and evictions of a cache, see get_name_cache_stats().
+	struct CacheCounters {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+	};
+	/// @brief A set-associative cache, with room for a configurable number of entries.
+	/// @note A key picks a set of WAYS entries, and a miss replaces the entry in the set
+	/// that was used least recently. Unlike a direct-mapped cache, a few hot keys that
+	/// happen to land in the same place do not keep evicting each other.
+	template <typename Entry>
+	struct AssociativeCache {
+		static constexpr unsigned WAYS = 4;
+		struct Slot {
+			Entry entry;
+			uint32_t last_used = 0;
+			bool used = false;
+		};
+		std::vector<Slot> slots;
+		uint32_t clock = 0;
+		CacheCounters counters;
+
+		AssociativeCache(unsigned size) { this->resize(size); }
+		/// @brief Make room for at least size entries, rounded up to a power of two sets.
+		/// Every entry is dropped.
+		void resize(unsigned size) {
+			unsigned sets = 1;
+			while (sets * WAYS < size)
+				sets <<= 1;
+			slots.assign(sets * WAYS, Slot{});
+		}
+		unsigned size() const noexcept { return slots.size(); }
+		/// @brief Find an entry in the set of a hash, that the match function accepts.
+		/// @return The entry, or nullptr on a miss.
+		template <typename Match>
+		Entry *find(uint64_t hash, Match &&match) {
+			Slot *set = this->set_of(hash);
+			for (unsigned i = 0; i < WAYS; i++) {
+				if (set[i].used && match(set[i].entry)) {
+					set[i].last_used = ++clock;
+					counters.hits++;
+					return &set[i].entry;
+				}
+			}
+			counters.misses++;
+			return nullptr;
+		}
+		/// @brief Take over the least recently used entry in the set of a hash, after a miss.
+		/// @return The entry, reset to its defaults.
+		Entry &replace(uint64_t hash) {
+			Slot *set = this->set_of(hash);
+			Slot *victim = &set[0];
+			for (unsigned i = 0; i < WAYS; i++) {
+				if (!set[i].used) {
+					victim = &set[i];
+					break;
+				}
+				if (set[i].last_used < victim->last_used)
+					victim = &set[i];
+			}
+			if (victim->used)
+				counters.evictions++;
+			victim->entry = Entry{};
+			victim->used = true;
+			victim->last_used = ++clock;
+			return victim->entry;
+		}
+		void clear() {
+			for (Slot &slot : slots)
+				slot = Slot{};
+		}
+
+	private:
+		Slot *set_of(uint64_t hash) { return &slots[(hash & (slots.size() / WAYS - 1)) * WAYS]; }
+	};
+	/// @brief A guest method or property name, see cached_guest_name().
+	struct GuestNameEntry {
+		gaddr_t address = 0;
+		bool terminated = false;
+		std::string text;
+		CachedName name;
+	};
+	/// @brief A function-name String and its guest address, see cached_address_of_variant().
+	/// @note Keyed by the string's own buffer, which a GDScript call site reuses for its
+	/// constant argument every time, so a hit costs no engine calls at all. Names built
+	/// fresh per call simply miss and fall back to the hash lookup.
+	struct NameAddressEntry {
+		// Holding on to the String keeps its buffer alive, so no later string can be
+		// handed the address this entry is keyed by.
+		String name;
+		gaddr_t address = 0;
+	};
+	static constexpr unsigned NAME_CACHE_SIZE = 128;
+	static constexpr unsigned FUNCTION_CACHE_SIZE = 16;
+	/// @brief An engine method, resolved from its class and name through ClassDB.
+	struct ResolvedMethod {
+		GDExtensionMethodBindPtr bind = nullptr; // Or nullptr to call by name
+		uint32_t hash = 0;
+		// Set when the method can be called with native arguments, see ECALL_OBJ_PTRCALL.
+		bool ptrcall = false;
+		uint8_t argc = 0;
+		Variant::Type return_type = Variant::NIL;
+		Variant::Type arg_types[8];
+		// The class an object argument must be, or empty for any object.
+		StringName arg_classes[8];
+	};
+	/// @brief Direct-mapped inline cache of object method calls, keyed by guest call site
+	/// and method name.
+	/// @note A call site almost always calls the same method on objects of the same class,
+	/// so remembering the method bind it resolved to skips the by-name lookup entirely.
+	/// The method name is part of the key, as a guest API may make every call from one site.
+	struct MethodCallSiteCache {
+		static constexpr unsigned SIZE = 64; // Must be a power of two
 		struct Entry {
-			gaddr_t address = 0;
-			bool terminated = false;
-			std::string text;
-			CachedName name;
+			gaddr_t site = 0;
+			StringName method;
+			StringName class_name;
+			const ResolvedMethod *resolved = nullptr;
 		};
 		Entry entries[SIZE];
 
@@ -120,18 +320,19 @@ public:
 				entry = Entry{};
 		}
 	};
-	/// @brief Direct-mapped cache of a function-name String to its guest address.
-	/// @note Keyed by the string's own buffer, which a GDScript call site reuses for its
-	/// constant argument every time, so a hit costs no engine calls at all. Names built
-	/// fresh per call simply miss and fall back to the hash lookup.
-	struct NameAddressCache {
-		static constexpr unsigned SIZE = 8; // Must be a power of two
+	/// @brief Direct-mapped cache of get_node() lookups, see cached_node_path().
+	struct NodePathCache {
+		static constexpr unsigned SIZE = 32; // Must be a power of two
 		struct Entry {
-			// Holding on to the String keeps its buffer alive, so no later string can be
-			// handed the address this entry is keyed by.
-			String name;
+			uint64_t base_id = 0;
 			gaddr_t address = 0;
-			bool valid = false;
+			std::string path;
+			// The path the guest interned, when the address is a handle to it.
+			NodePath interned;
+			bool is_interned = false;
+			uint64_t node_id = 0;
+			// The name of each node on the way from the base down to the node.
+			std::vector<StringName> names;
 		};
 		Entry entries[SIZE];
 
@@ -150,10 +351,12 @@ public:
 	Sandbox(Ref<ELFScript> program);
 	~Sandbox();
 	static void Initialize();
-	/// @brief Join every background translation thread.
-	/// @note Background translations run code that lives inside this extension,
+	/// @brief Cancel every asynchronous call, and join every worker thread.
+	/// @note Worker threads run code that lives inside this extension,
 	/// so they must all be finished before the extension can be unloaded.
 	static void Deinitialize();
+	/// @brief Run work on a new thread that is joined by Deinitialize().
+	static void start_worker_thread(std::function<void()> &&work);
 
 	static Sandbox *FromBuffer(const PackedByteArray &buffer) { return memnew(Sandbox(buffer)); }
 	static Sandbox *FromProgram(Ref<ELFScript> program) { return memnew(Sandbox(std::move(program))); }
@@ -186,6 +389,55 @@ public:
 	/// @return The return value of the function call.
 	Variant vmcall_address(gaddr_t address, const Variant **args, GDExtensionInt arg_count, GDExtensionCallError &error);
 
+	/// @brief Call a function in the guest once for each set of arguments.
+	/// @param function The name or address of the function to call.
+	/// @param arguments An Array with one entry per call. An entry that is an Array is
+	/// spread into the call's arguments, anything else is passed as the only argument.
+	/// Packed arrays work the same way, one element per call.
+	/// @return The return value of each call, in order. A call that fails returns null, and
+	/// may end the batch early, leaving the remaining results null.
+	/// @note The call state and the exception handler are set up once for the whole batch,
+	/// leaving only the argument setup and the guest function itself per call.
+	Array vmcall_batch(const Variant &function, const Variant &arguments);
+
+	/// @brief Call a function in the guest on a worker thread, without blocking the caller.
+	/// @param function The name or address of the function to call.
+	/// @param args The arguments to pass to the function.
+	/// @return A handle that emits completed(result) on the main thread when the call
+	/// returns, or null if the call could not be started.
+	/// @note The call runs in a private fork of this sandbox, so it sees the guest as it was
+	/// when the call was made, and its changes to guest memory are not kept. Game API system
+	/// calls touch the engine, and are handed to the main thread while the worker waits.
+	Ref<SandboxAsyncCall> vmcall_async(const Variant &function, const Array &args);
+	/// @brief True when this sandbox runs a call on a worker thread, see vmcall_async() and
+	/// SandboxGroup. Cheap enough to check on every system call.
+	bool is_async_worker() const noexcept { return m_worker != nullptr; }
+	/// @brief True when called from the worker thread running this sandbox.
+	bool is_on_worker_thread() const;
+	/// @brief True when a worker thread is running this sandbox, and it may not be called
+	/// into from here. While the worker waits for a system call that the main thread runs
+	/// for it, calls from the main thread are nested in that system call, and allowed.
+	bool is_busy_on_worker_thread() const;
+	/// @brief Run a system call handler on the main thread, if called from the worker thread
+	/// running this sandbox. Otherwise the handler runs right away.
+	void run_syscall_on_main_thread(machine_t &machine, void (*handler)(machine_t &));
+	/// @brief Queue work for the main thread that the guest does not wait for. Only called
+	/// from the worker thread running this sandbox. See SandboxWorkerContext.
+	void defer_to_main_thread(std::function<void()> &&function);
+
+	/// @brief Set the guest command buffer that deferred scene writes are appended to, see
+	/// Command in syscalls.h. Zero turns deferred writes off.
+	void set_command_buffer(gaddr_t address) { m_command_buffer = address; }
+	gaddr_t get_command_buffer() const noexcept { return m_command_buffer; }
+	/// @brief Apply and empty the guest command buffer. Called when a VM call returns, and
+	/// when the guest asks for it. Commands are applied grouped by object,
+	/// in the order they were written for each object.
+	/// @return The number of commands in the buffer.
+	unsigned flush_command_buffer();
+	/// @brief Empty the guest command buffer without applying it. Used when a VM call
+	/// throws, so that a half-written batch is not applied by the next call.
+	void discard_command_buffer();
+
 	/// @brief Make a function call to a function in the guest by its name.
 	/// @param function The name of the function to call.
 	/// @param args The arguments to pass to the function.
@@ -239,6 +491,11 @@ public:
 	int64_t get_heap_chunk_count() const;
 	int64_t get_heap_allocation_counter() const;
 	int64_t get_heap_deallocation_counter() const;
+	/// @brief The size of the guest's address space, set aside but only backed by the
+	/// system page by page, as the guest writes to it.
+	int64_t get_memory_reserved() const;
+	/// @brief The part of the guest's address space that the system backs right now.
+	int64_t get_memory_committed() const;
 	void set_exceptions(unsigned exceptions) {} // Do nothing (it's a read-only property)
 	unsigned get_exceptions() const { return m_exceptions; }
 	void set_timeouts(unsigned budget) {} // Do nothing (it's a read-only property)
@@ -307,7 +564,7 @@ public:
 	/// @param name The name as it currently reads in guest memory, without any terminator.
 	/// @param terminated True if the byte following the name in guest memory is a NUL.
 	/// @return The name, owned by the cache and valid only until the next lookup that
-	/// lands in the same cache slot. Callers that can re-enter the sandbox in between
+	/// misses in the same cache set. Callers that can re-enter the sandbox in between
 	/// (an allowed-method callback, a call that reaches a script) must take a copy.
 	/// @note Building a StringName means hashing the text and taking a global lock in
 	/// Godot's string-name table, which is far too expensive to repeat on every single
@@ -316,6 +573,59 @@ public:
 	/// stay correct for guests that build names at run-time in a reused buffer.
 	const CachedName &cached_guest_name(gaddr_t address, std::string_view name, bool terminated) const;
 
+	/// @brief Set the number of entries in the guest name cache, see cached_guest_name().
+	/// @param entries The number of entries, rounded up to a whole number of sets.
+	void set_name_cache_size(int entries);
+	int get_name_cache_size() const { return m_guest_names.size(); }
+
+	/// @brief Set the number of entries in the cache of function names passed to vmcall().
+	/// @param entries The number of entries, rounded up to a whole number of sets.
+	void set_function_cache_size(int entries);
+	int get_function_cache_size() const { return m_name_addresses.size(); }
+
+	/// @brief Get the hits, misses and evictions of the guest name cache and the function
+	/// name cache, counted since the sandbox was created.
+	/// @return A Dictionary with "names" and "functions", each a Dictionary with "size",
+	/// "hits", "misses" and "evictions".
+	Dictionary get_name_cache_stats() const;
+
+	/// @brief Look up the method bind that a guest call site calls on an object.
+	/// @param site The guest address the call is made from.
+	/// @param obj The object being called.
+	/// @param method The name of the method.
+	/// @return The method bind, or nullptr when the method has to be called by name: it is
+	/// not a method of the object's class, or the object has a script that may override it.
+	GDExtensionMethodBindPtr cached_method_bind(gaddr_t site, godot::Object *obj, const StringName &method) const;
+
+	/// @brief Look up the method that a guest call site calls with native arguments.
+	/// @param hash The hash of the method bind, as the guest was generated with.
+	/// @return The method, or nullptr when the method cannot be called with native
+	/// arguments, or has changed since the guest was generated.
+	const ResolvedMethod *cached_ptrcall_method(gaddr_t site, godot::Object *obj, const StringName &method, uint32_t hash) const;
+
+	/// @brief Look up a node path that the guest has resolved before.
+	/// @param base The node the path is relative to.
+	/// @param address The guest address the path was read from, used as the cache key.
+	/// @param path The path as it currently reads in guest memory.
+	/// @param interned The path, when the guest passed a handle to an interned path as the
+	/// address, see intern_name().
+	/// @return The node, or nullptr when the path has to be resolved again.
+	/// @note A hit is checked against the tree by walking up from the node and comparing
+	/// names, so a node that was freed, renamed or moved since is never returned. This is
+	/// much cheaper than building a NodePath, which interns every name in it.
+	godot::Node *cached_node_path(godot::Node *base, gaddr_t address, std::string_view path, const NodePath *interned = nullptr) const;
+	/// @brief Remember the node that a path resolved to, see cached_node_path().
+	/// @note Paths that go up the tree, are absolute or refer to unique names are not cached.
+	void cache_node_path(godot::Node *base, gaddr_t address, std::string_view path, const NodePath &node_path, godot::Node *node, bool interned = false) const;
+
+	/// @brief Calculate the hash that Godot checks a method bind against.
+	/// @param method_info A method, as listed by ClassDB.class_get_method_list().
+	static uint32_t get_method_bind_hash(const Dictionary &method_info);
+
+	/// @brief Check if a method can be called with native arguments, see ECALL_OBJ_PTRCALL.
+	/// @param method_info A method, as listed by ClassDB.class_get_method_list().
+	static bool is_ptrcall_method(const Dictionary &method_info);
+
 	// -= Call State Management =-
 
 	/// @brief Get the current call state.
@@ -356,8 +666,14 @@ public:
 	/// @brief Create a new permanent variant, storing it in the current state.
 	/// @param idx The index of the variant to duplicate or move.
 	/// @return The index of the new permanent variant, passed to and used by the guest.
+	/// @note Reuses a slot released by release_permanent_variant() when there is one.
 	unsigned create_permanent_variant(unsigned idx);
 
+	/// @brief Release a permanent variant, so that its slot can hold another one.
+	/// @param idx The index of the permanent variant to release.
+	/// @note Every copy of the index stops working, and using one is an error.
+	void release_permanent_variant(int32_t idx);
+
 	/// @brief Check if a variant index is a permanent variant.
 	/// @param idx The index of the variant to check.
 	/// @return True if the variant is permanent, false otherwise.
@@ -368,6 +684,19 @@ public:
 	/// @param var The new variant to move-assign.
 	void assign_permanent_variant(int32_t idx, Variant &&var);
 
+	/// @brief Intern a name as a permanent Variant, see ECALL_INTERN_NAME.
+	/// @param name The name, or the node path.
+	/// @param type Variant::STRING_NAME or Variant::NODE_PATH.
+	/// @return The index of the permanent Variant, which is the handle the guest passes.
+	/// @note Interning the same name again returns the same handle.
+	unsigned intern_name(std::string_view name, Variant::Type type);
+
+	/// @brief Get a name that the guest interned, see intern_name().
+	/// @param handle The handle the guest passed in place of the name.
+	/// @param type The type the name must have.
+	/// @return The permanent Variant holding the name.
+	const Variant &get_interned_name(unsigned handle, Variant::Type type) const;
+
 	/// @brief Assign a value to the guest's Variant slot, reusing it when owned,
 	/// allocating a new scoped Variant otherwise. Owned = permanent state or
 	/// current state's vector. Non-owned slots (eg. caller arguments) are never
@@ -380,6 +709,23 @@ public:
 	/// @return The index the guest uses from here on.
 	unsigned try_reuse_assign_variant(int32_t src_idx, const Variant &src_var, int32_t assign_to_idx, const Variant &var);
 
+	/// @brief Map the storage of a scoped Packed*Array into guest memory, so that the guest
+	/// can work on it in place instead of fetching a copy and storing it back.
+	/// @param idx The index of the scoped Variant holding the array.
+	/// @param writable If true, the guest may write to the array. The Variant then gets
+	/// storage of its own, so that the writes do not show up in copies of the array.
+	/// @param r_elements The number of elements in the array.
+	/// @return The guest address of the first element, or 0 when the array is empty.
+	/// @note Unmapped when the call that mapped it returns. Changing the array by other means
+	/// while it is mapped leaves the view with the storage the array had before.
+	gaddr_t map_packed_array(int32_t idx, bool writable, size_t &r_elements);
+	/// @brief Make the writes through a writable view of a Packed*Array visible to the host.
+	/// Writes to the whole pages of the array are visible right away, those to its first
+	/// and last page only once committed.
+	void commit_packed_array(gaddr_t address);
+	/// @brief Remove a view of a Packed*Array from guest memory, committing it if writable.
+	void unmap_packed_array(gaddr_t address);
+
 	/// @brief The engine-side pointer that identifies an object, which is also the
 	/// handle the guest is given for it. Nothing else is stable: the godot-cpp binding
 	/// wrapper is created on demand and destroyed with the object.
@@ -410,10 +756,7 @@ public:
 	/// @param engine_object The guest-visible handle (an engine object pointer).
 	/// @return The entry, or nullptr if the object is not scoped by this call.
 	CurrentState::ScopedObject *find_scoped_object(uintptr_t engine_object) const noexcept {
-		for (CurrentState::ScopedObject &so : state().scoped_objects)
-			if (so.engine_object == engine_object)
-				return &so;
-		return nullptr;
+		return state().find_scoped_object(engine_object);
 	}
 
 	/// @brief Check if an object is scoped in the current state.
@@ -473,6 +816,13 @@ public:
 	/// @return The object, or nullptr if it is not allowed or no longer exists.
 	godot::Object *get_explicitly_allowed_object(uintptr_t engine_object) const;
 
+	/// @brief The ObjectID of a guest-supplied engine object pointer, looked up in this
+	/// call's scoped objects and the allowed-objects list only. Neither the object nor its
+	/// binding is touched, so a worker thread may ask. Whether the object still exists, and
+	/// may be used, is for the main thread to find out.
+	/// @return The ObjectID, or 0 if the guest was never given the object.
+	uint64_t get_object_id_from_handle(uintptr_t engine_object) const;
+
 	/// @brief Set a callback to check if an object is allowed in the sandbox.
 	/// @param callback The callable to check if an object is allowed.
 	void set_object_allowed_callback(const Callable &callback);
@@ -615,6 +965,16 @@ public:
 	/// @brief Reset the sandbox, clearing all state and reloads the program.
 	void reset(bool unload = false);
 
+	/// @brief Turn this sandbox into a copy of an already initialized one.
+	/// @param p_template The sandbox to copy. It must have a program loaded and have
+	/// finished initialization, and neither sandbox may be in a VM call.
+	/// @return True if the sandbox is now a fork of the template.
+	/// @note Loading a program parses the ELF, builds the decoder cache and runs the
+	/// program through main(). A fork skips all of that: guest memory is shared
+	/// copy-on-write with the template, and registers, the heap arena, permanent
+	/// Variants, properties and the public API are copied as they are right now.
+	bool fork_from(Sandbox *p_template);
+
 	struct BinaryInfo {
 		String language;
 		PackedStringArray functions;
@@ -623,7 +983,10 @@ public:
 	/// @brief Get information about the program from the binary.
 	/// @param binary The binary data.
 	/// @return An array of public callable functions and programming language.
-	static BinaryInfo get_program_info_from_binary(const PackedByteArray &binary);
+	static BinaryInfo get_program_info_from_binary(std::string_view binary);
+	static BinaryInfo get_program_info_from_binary(const PackedByteArray &binary) {
+		return get_program_info_from_binary(std::string_view{ (const char *)binary.ptr(), static_cast<size_t>(binary.size()) });
+	}
 
 	/// @brief Check if a function is Sandbox-specific (and public API).
 	/// @param p_function The name of the function to check.
@@ -654,6 +1017,69 @@ public:
 	// True when the loaded program exports its own profiling data area.
 	bool has_self_instrumentation() const;
 
+	// -= Snapshots =-
+
+	/// @brief The state of the guest at one point in time: guest memory, registers, the
+	/// native heap and the permanent Variants. See sandbox_snapshot.cpp.
+	struct Snapshot;
+
+	/// @brief Capture the current state of the guest.
+	/// @return The snapshot, or nullptr if there is no program or a VM call is in progress.
+	std::shared_ptr<const Snapshot> create_snapshot() const;
+
+	/// @brief Put the guest back into the state of a snapshot, copying only the pages of
+	/// guest memory that differ from it.
+	/// @param snapshot A snapshot of this sandbox, or of any sandbox forked from the same
+	/// template as this one.
+	/// @return The number of pages that had to be restored, or -1 if the snapshot could not
+	/// be applied.
+	int64_t restore_snapshot(const Snapshot &snapshot);
+
+	/// @brief Save the state of the guest to a file, to start other sandboxes from later
+	/// without running the program through main() again.
+	/// @param path Where to save the snapshot, typically during export.
+	/// @return True if the snapshot was saved.
+	/// @note Along with guest memory, registers and the native heap, the snapshot holds the
+	/// permanent Variants, the properties and the public API. Objects cannot be saved.
+	bool save_snapshot(const String &path) const;
+
+	/// @brief Start the program in this sandbox from a snapshot file made by save_snapshot().
+	/// @param path The snapshot file. Where possible it is mapped copy-on-write, so that
+	/// guest pages are only read from disk once they are used.
+	/// @return True if the sandbox now runs from the snapshot.
+	/// @note Uses the program already set on this sandbox, and otherwise the one the snapshot
+	/// was made from. Either way the program must be the exact one that was snapshotted.
+	bool load_snapshot(const String &path);
+
+	/// @brief Remember the current state of the guest, to go back to with rollback().
+	/// @return True if the checkpoint was made, replacing any earlier one.
+	/// @note From here on, the pages of guest memory that are written to are tracked, so
+	/// that checkpoint() and rollback() only cost as much as the guest changed in between.
+	/// Where the host cannot track writes, all of guest memory is compared instead.
+	bool checkpoint();
+
+	/// @brief Put the guest back into the state of the last checkpoint(): the pages of guest
+	/// memory written to since then, registers, the native heap and the permanent Variants.
+	/// The checkpoint is kept, and can be rolled back to again.
+	/// @return The number of pages that were restored, or -1 if there is no checkpoint.
+	/// @note Resetting the sandbox or loading a program drops the checkpoint, and so may
+	/// forking another sandbox from it.
+	int64_t rollback();
+
+	/// @brief Save the state of the guest as a compact blob, for rollback netcode that
+	/// keeps one per frame. Makes a checkpoint first if there is none.
+	/// @return The state, or an empty array if there is no program or a VM call is in progress.
+	/// @note The blob only holds what differs from the checkpoint: the pages of guest memory
+	/// written to since then, each encoded as its difference from the checkpoint, along with
+	/// registers, the native heap and the permanent Variants. Objects cannot be saved.
+	PackedByteArray save_state();
+
+	/// @brief Put the guest back into a state from save_state(), restoring only the pages that
+	/// were written to since the checkpoint.
+	/// @param state A state saved by this sandbox since its last checkpoint().
+	/// @return True if the state was restored.
+	bool restore_state(const PackedByteArray &state);
+
 	// -= Self-testing, inspection and internal functions =-
 
 	/// @brief Get the current Callable set for redirecting stdout.
@@ -753,6 +1179,25 @@ public:
 		return this->m_bintr_bg_compilation;
 	}
 
+	/// @brief Set how many calls into the program it takes before it is JIT-compiled.
+	/// @param threshold The number of calls, counted across every Sandbox running the same
+	/// program. Until then the program is interpreted. 0 JIT-compiles it when it is loaded.
+	/// @note Takes effect the next time a program is loaded. Ignored when JIT-compilation
+	/// is disabled, and when the program has a binary translation of its own.
+	void set_jit_tier_up_threshold(int threshold) {
+		this->m_jit_tier_up_threshold = std::max(0, threshold);
+	}
+	int get_jit_tier_up_threshold() const {
+		return this->m_jit_tier_up_threshold;
+	}
+
+	/// @brief Get the number of calls counted towards the tier-up threshold so far.
+	int64_t get_jit_entries() const;
+
+	/// @brief Get the number of times this Sandbox moved a program from the interpreter
+	/// to JIT-compiled code.
+	unsigned get_jit_tier_ups() const { return this->m_jit_tier_ups; }
+
 	/// @brief Enable or disable the use of JIT-compilation.
 	/// @param enable If true, enable JIT-compilation, false to disable it.
 	/// @note Ignored when no JIT backend is compiled in. See has_feature_jit().
@@ -818,12 +1263,34 @@ public:
 private:
 	static void generate_runtime_cpp_api(bool use_argument_names = false);
 	bool is_in_vmcall() const noexcept { return m_current_state != &m_states[0]; }
+	friend class SandboxAsyncCall;
+	friend class SandboxGroup;
 	void constructor_initialize();
 	void full_reset();
 	void reset_machine();
 	void set_program_data_internal(Ref<ELFScript> program);
-	bool load(const PackedByteArray *vbuf, const std::vector<std::string> *argv = nullptr);
+	// The persistent translation cache, see sandbox_bintr.cpp. The first is called before
+	// the machine is made, and the second after.
+	void load_cached_translation(std::string_view binary);
+	void cache_translation(std::string_view binary);
+	// Tiered execution, see sandbox_bintr.cpp.
+	void count_jit_entry();
+	void tier_up();
+	void publish_jit_segment();
+	int32_t add_permanent_variant(Variant &&var);
+	GuestHeapStats *guest_heap_stats() const;
+	void find_guest_heap();
+	struct ForkSource;
+	std::shared_ptr<const ForkSource> freeze_for_forking();
+	machine_t *copy_machine() const;
+	void capture_state(Snapshot &snapshot) const;
+	void apply_state(const Snapshot &snapshot);
+	bool load(std::string_view binary, const std::vector<std::string> *argv = nullptr);
+	std::string_view program_view() const noexcept;
+	void create_machine(std::string_view binary);
+	void install_machine_callbacks();
 	static PackedStringArray get_public_functions(const machine_t &);
+	MethodCallSiteCache::Entry &method_call_site(gaddr_t site, godot::Object *obj, const StringName &method) const;
 	void read_program_properties(bool editor) const;
 	void handle_exception(gaddr_t);
 	void handle_timeout(gaddr_t);
@@ -834,13 +1301,34 @@ private:
 	static void initialize_syscalls_3d();
 	GuestVariant *setup_arguments(gaddr_t &sp, const Variant **args, int argc);
 	void setup_arguments_native(gaddr_t arrayDataPtr, GuestVariant *v, const Variant **args, int argc);
+	const CallStub *find_call_stub(gaddr_t address, const Variant **args, int argc) const;
+	GuestVariant *setup_arguments_typed(const CallStub &stub, gaddr_t &sp, const Variant **args);
+	void add_call_stub(const Dictionary &func);
 
 	machine_t *m_machine = nullptr;
+	// The frozen machine m_machine was forked from, if any, see fork_from(). A fork
+	// borrows pages from it, so it must only be released after m_machine is deleted.
+	std::shared_ptr<const ForkSource> m_fork_source;
+	// Bumped by everything that changes the guest, so that the machine frozen for forking
+	// is only reused while it still matches, see freeze_for_forking().
+	uint64_t m_state_generation = 0;
+	// See checkpoint(). Tracks writes to the arena of m_machine, and must be released
+	// before the machine is.
+	struct Checkpoint;
+	std::shared_ptr<Checkpoint> m_checkpoint;
 	godot::Node *m_tree_base = nullptr;
 	uint32_t m_max_refs = MAX_REFS;
 	uint32_t m_memory_max = MAX_VMEM;
 	int64_t m_insn_max = MAX_INSTRUCTIONS;
 	uint32_t m_allocations_max = MAX_HEAP_ALLOCS;
+	// Where load() put the native heap, needed to rebuild its arena from a snapshot.
+	gaddr_t m_heap_area = 0;
+	gaddr_t m_heap_size = 0;
+	// The guest's own count of the small blocks it hands out, or 0 when it has none.
+	gaddr_t m_guest_heap = 0;
+	// Pages of the arena are mapped from a snapshot file. Those cannot be given back to
+	// the system to read as zero, as they would read what the file holds instead.
+	bool m_arena_from_file = false;
 
 	uint8_t m_throttled = 0;
 	bool m_use_unboxed_arguments = false;
@@ -853,6 +1341,10 @@ private:
 	bool m_bintr_automatic_nbit_as = false; // Automatic n-bit address space for binary translation
 	bool m_bintr_register_caching = true; // Use register caching for binary translation
 	bool m_bintr_bg_compilation = true; // Perform binary translation in the background
+	int m_jit_tier_up_threshold = 0; // Calls into the program before it is JIT-compiled, 0 = when loaded
+	bool m_jit_tier_pending = false; // Interpreting, and counting calls towards the threshold
+	bool m_jit_publish_pending = false; // Compiling the program for every instance of it
+	uint32_t m_jit_entries = 0; // Calls counted, for programs that are not shared (see ELFImage)
 
 	/// @brief Scope an object, unless it already is.
 	/// @return True if the object was not scoped by this call before.
@@ -864,14 +1356,43 @@ private:
 	// so that they can be accessed by future VM calls, and not lost when a call ends.
 	std::array<CurrentState, MAX_LEVEL> m_states;
 
+	// Packed arrays mapped into guest memory, see map_packed_array().
+	struct MappedPackedArray {
+		gaddr_t address; // Guest address of the first element.
+		gaddr_t window; // The pages the view occupies, from window to window + window_size.
+		gaddr_t window_size;
+		uint8_t *data; // The host storage of the array.
+		size_t bytes;
+		// Holds on to the storage, whatever happens to the Variant it was mapped from.
+		Variant array;
+		const CurrentState *state;
+		bool writable;
+	};
+	std::vector<MappedPackedArray> m_mapped_arrays;
+	gaddr_t m_mapped_arrays_end = 0;
+	MappedPackedArray &find_packed_array_view(gaddr_t address);
+	void remove_packed_array_view(MappedPackedArray &view);
+	/// @brief Unmap the packed arrays mapped by the call that owns a state.
+	void unmap_packed_arrays(const CurrentState &state);
+
 	// Properties
 	mutable std::vector<SandboxProperty> m_properties;
 	// Guest-published API; authoritative even without an ELFScript resource.
 	Array m_public_api_functions;
 	mutable std::unordered_map<int64_t, LookupEntry> m_lookup;
+	// Public API function address -> how to pass its arguments, see CallStub.
+	std::unordered_map<gaddr_t, CallStub> m_call_stubs;
+	// Set while a call runs on a worker thread, see vmcall_async() and SandboxGroup.
+	SandboxWorkerContext *m_worker = nullptr;
+	// Guest CommandBuffer with the scene writes of the current call, or zero.
+	gaddr_t m_command_buffer = 0;
 	mutable StringNameMap<gaddr_t> m_sname_lookup;
-	mutable NameAddressCache m_name_addresses;
-	mutable GuestNameCache m_guest_names;
+	mutable AssociativeCache<NameAddressEntry> m_name_addresses{ FUNCTION_CACHE_SIZE };
+	mutable AssociativeCache<GuestNameEntry> m_guest_names{ NAME_CACHE_SIZE };
+	mutable MethodCallSiteCache m_method_call_sites;
+	mutable NodePathCache m_node_paths;
+	// Names the guest has interned, by type and text, see intern_name().
+	std::unordered_map<std::string, int32_t> m_interned_names;
 
 	// Restrictions
 	// Keyed by ObjectID -> engine object pointer. An ObjectID is never reused, while the
@@ -903,11 +1424,14 @@ private:
 	Ref<ELFScript> m_program_data;
 	PackedByteArray m_program_bytes;
 	int m_source_version = -1;
+	// Shared with every other instance running the same program, see ELFScript::get_image().
+	std::shared_ptr<ELFImage> m_image;
 
 	// Stats
 	unsigned m_timeouts = 0;
 	unsigned m_exceptions = 0;
 	unsigned m_calls_made = 0;
+	unsigned m_jit_tier_ups = 0;
 
 	struct ProfilingData {
 		// ELF path -> Address -> Count
@@ -928,9 +1452,10 @@ private:
 	static inline std::mutex generate_hotspots_mutex;
 
 	// Global statistics
-	static inline uint64_t m_global_timeouts = 0;
-	static inline uint64_t m_global_exceptions = 0;
-	static inline uint64_t m_global_calls_made = 0;
+	// Counted from worker threads too, see SandboxGroup.
+	static inline std::atomic<uint64_t> m_global_timeouts = 0;
+	static inline std::atomic<uint64_t> m_global_exceptions = 0;
+	static inline std::atomic<uint64_t> m_global_calls_made = 0;
 	static inline uint32_t m_global_instances_current = 0; // Counts the number of current instances
 	static inline uint32_t m_global_instances_seen = 0; // Incremented for each instance created
 	static inline double m_accumulated_startup_time = 0.0;
@@ -942,11 +1467,56 @@ inline void Sandbox::CurrentState::append(Variant &&value) {
 	scoped_variants.push_back(&variants.back());
 }
 
+inline int64_t Sandbox::CurrentState::find_permanent_slot(int32_t idx) const noexcept {
+	if (idx >= 0 || idx == INT32_MIN) {
+		return -1;
+	}
+	const uint32_t bits = uint32_t(-idx - 1);
+	const uint32_t slot = bits & ((1u << PERMANENT_SLOT_BITS) - 1);
+	if (slot >= scoped_variants.size()) {
+		return -1;
+	}
+	const uint16_t generation = slot < generations.size() ? generations[slot] : 0;
+	return (bits >> PERMANENT_SLOT_BITS) == generation ? int64_t(slot) : -1;
+}
+
 inline void Sandbox::CurrentState::reset() {
+	// Capacity is kept (see initialize()), so this only destroys what the call used.
 	variants.clear();
 	scoped_variants.clear();
+	generations.clear();
+	free_slots.clear();
 	scoped_objects.clear();
 	scoped_refs.clear();
+	object_index.clear();
+}
+
+inline void Sandbox::CurrentState::add_scoped_object(uintptr_t engine_object, godot::Object *binding) {
+	scoped_objects.push_back(ScopedObject{ engine_object, binding });
+	object_index.insert(engine_object, scoped_objects.size() - 1);
+}
+
+inline void Sandbox::CurrentState::ScopedObjectIndex::clear() noexcept {
+	count = 0;
+	if (UNLIKELY(++generation == 0)) {
+		// Wrapped around: slots from 4 billion calls ago would look current again.
+		for (Slot &slot : slots)
+			slot.generation = 0;
+		generation = 1;
+	}
+}
+
+inline int Sandbox::CurrentState::ScopedObjectIndex::find(uintptr_t engine_object) const noexcept {
+	if (slots.empty())
+		return -1;
+	const size_t mask = slots.size() - 1;
+	for (size_t i = hash(engine_object) & mask;; i = (i + 1) & mask) {
+		const Slot &slot = slots[i];
+		if (slot.generation != generation)
+			return -1;
+		if (slot.engine_object == engine_object)
+			return int(slot.index);
+	}
 }
 
 inline bool Sandbox::is_explicitly_allowed_object(godot::Object *obj) const {
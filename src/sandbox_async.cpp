@@ -0,0 +1,152 @@
+#include "sandbox_async.h"
+
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/core/object.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+#include <mutex>
+#include <unordered_set>
+
+namespace {
+// The calls that are running in the guest right now, see SandboxAsyncCall::stop_all().
+std::mutex running_mutex;
+std::unordered_set<SandboxAsyncCall *> running;
+} // namespace
+
+void SandboxAsyncCall::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("is_completed"), &SandboxAsyncCall::is_completed);
+	ClassDB::bind_method(D_METHOD("get_result"), &SandboxAsyncCall::get_result);
+	ClassDB::bind_method(D_METHOD("wait"), &SandboxAsyncCall::wait);
+
+	ADD_SIGNAL(MethodInfo("completed", PropertyInfo(Variant::NIL, "result", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NIL_IS_VARIANT)));
+}
+
+SandboxAsyncCall::~SandboxAsyncCall() {
+	// Only when the call never completed, eg. when the extension is unloaded.
+	if (m_sandbox != nullptr) {
+		memdelete(m_sandbox);
+	}
+}
+
+Ref<SandboxAsyncCall> SandboxAsyncCall::start(Sandbox *origin, gaddr_t address, const Array &args) {
+	Sandbox *sandbox = memnew(Sandbox);
+	if (!sandbox->fork_from(origin)) {
+		memdelete(sandbox);
+		return Ref<SandboxAsyncCall>();
+	}
+	// Node paths are resolved from where the original sandbox resolves them.
+	Node *tree_base = origin->get_tree_base();
+	sandbox->set_tree_base(tree_base);
+
+	Ref<SandboxAsyncCall> call;
+	call.instantiate();
+	call->m_sandbox = sandbox;
+	call->m_tree_base_id = tree_base != nullptr ? tree_base->get_instance_id() : 0;
+	call->m_address = address;
+	// The caller keeps using its arguments on the main thread.
+	call->m_args = args.duplicate(true);
+	call->m_self = call;
+	sandbox->m_worker = &call->m_context;
+
+	SandboxAsyncCall *ptr = call.ptr();
+	// The worker only queues, and the main thread runs the queue when it next gets around
+	// to deferred calls. A call that is waited on runs its queue from wait() instead.
+	call->m_queue.on_queued = [ptr]() {
+		callable_mp(ptr, &SandboxAsyncCall::run_pending).call_deferred();
+	};
+	// The worker is waiting, so the fork can be touched here.
+	call->m_queue.before_each = [ptr]() {
+		if (ptr->m_tree_base_id != 0 && ObjectDB::get_instance(ptr->m_tree_base_id) == nullptr) {
+			ptr->m_tree_base_id = 0;
+			ptr->m_sandbox->set_tree_base(ptr->m_sandbox);
+		}
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(running_mutex);
+		running.insert(ptr);
+	}
+	Sandbox::start_worker_thread([call]() {
+		call->run();
+	});
+	return call;
+}
+
+void SandboxAsyncCall::stop_all() {
+	std::lock_guard<std::mutex> lock(running_mutex);
+	for (SandboxAsyncCall *call : running) {
+		call->m_sandbox->machine().stop();
+	}
+}
+
+void SandboxAsyncCall::run() {
+	std::vector<Variant> args(m_args.size());
+	std::vector<const Variant *> argptrs(args.size());
+	for (size_t i = 0; i < args.size(); i++) {
+		args[i] = m_args[i];
+		argptrs[i] = &args[i];
+	}
+
+	m_context.enter();
+	Variant result;
+	try {
+		result = m_sandbox->vmcall_internal(m_address, argptrs.data(), int(argptrs.size()));
+	} catch (const std::exception &e) {
+		ERR_PRINT(("Sandbox exception: " + std::string(e.what())).c_str());
+	}
+	m_context.leave();
+	{
+		std::lock_guard<std::mutex> lock(running_mutex);
+		running.erase(this);
+	}
+
+	m_queue.update([&]() {
+		m_return_value = std::move(result);
+		m_returned = true;
+	});
+	callable_mp(this, &SandboxAsyncCall::finish).call_deferred();
+}
+
+void SandboxAsyncCall::run_pending() {
+	m_queue.run_pending();
+}
+
+void SandboxAsyncCall::finish() {
+	if (!m_returned || m_completed) {
+		return;
+	}
+	// Commands the guest left behind are applied before anyone hears of the result.
+	m_queue.run_pending();
+	m_result = std::move(m_return_value);
+	m_completed = true;
+	memdelete(m_sandbox);
+	m_sandbox = nullptr;
+	// Hold on to the call for the length of the signal, which may drop the last reference.
+	Ref<SandboxAsyncCall> self = std::move(m_self);
+	emit_signal("completed", m_result);
+}
+
+Variant SandboxAsyncCall::wait() {
+	if (m_context.is_worker_thread()) {
+		ERR_PRINT("SandboxAsyncCall: Cannot wait for a call from inside itself.");
+		return Variant();
+	}
+	m_queue.wait_for([this]() {
+		return m_returned.load();
+	});
+	this->finish();
+	return m_result;
+}
+
+Ref<SandboxAsyncCall> Sandbox::vmcall_async(const Variant &function, const Array &args) {
+	const gaddr_t address = cached_address_of_variant(function);
+	if (address == 0) {
+		ERR_PRINT("Function not found: " + function.operator String() + " (Added to the public API?)");
+		return Ref<SandboxAsyncCall>();
+	}
+	// The fork is taken from here, and would miss whatever the calls in progress are doing.
+	if (this->is_in_vmcall()) {
+		ERR_PRINT("vmcall_async: Cannot start an asynchronous call from inside a VM call.");
+		return Ref<SandboxAsyncCall>();
+	}
+	return SandboxAsyncCall::start(this, address, args);
+}
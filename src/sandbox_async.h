@@ -0,0 +1,66 @@
+#pragma once
+
+#include "sandbox.h"
+#include "sandbox_worker.h"
+#include <atomic>
+
+/**
+ * @brief A function call running in the guest on a worker thread, see Sandbox::vmcall_async().
+ *
+ * The call runs in a private fork of the sandbox it was made on, which no one else can reach,
+ * so the machine needs no locking. Everything the guest does to the engine goes through the
+ * game API system calls, and those are queued up and run on the main thread while the worker
+ * waits for their results. When the guest function returns, completed(result) is emitted on
+ * the main thread and the fork is freed.
+ **/
+class SandboxAsyncCall : public RefCounted {
+	GDCLASS(SandboxAsyncCall, RefCounted);
+
+protected:
+	static void _bind_methods();
+
+public:
+	SandboxAsyncCall() {}
+	~SandboxAsyncCall();
+
+	/// @brief Fork a sandbox and start calling a function in the fork on a worker thread.
+	/// @param origin The sandbox to fork. Must not be in a VM call.
+	/// @param address The address of the function to call.
+	/// @param args The arguments to pass to the function.
+	/// @return The running call, or null if the sandbox could not be forked.
+	static Ref<SandboxAsyncCall> start(Sandbox *origin, gaddr_t address, const Array &args);
+
+	/// @brief Ask every call that is still running in the guest to stop, see Sandbox::Deinitialize().
+	static void stop_all();
+
+	/// @brief True once the call has returned and completed has been emitted.
+	bool is_completed() const { return m_completed; }
+	/// @brief The return value of the guest function, or null until the call has completed.
+	Variant get_result() const { return m_result; }
+	/// @brief Block until the call has completed, running its system calls in the meantime.
+	/// @return The return value of the guest function.
+	Variant wait();
+
+private:
+	void run();
+	void run_pending();
+	void finish();
+
+	// The private fork the call runs in, freed on the main thread when the call completes.
+	Sandbox *m_sandbox = nullptr;
+	// The node the fork resolves node paths from. It belongs to the original sandbox, and
+	// is checked for before every system call, as it may be freed while the call runs.
+	uint64_t m_tree_base_id = 0;
+	gaddr_t m_address = 0;
+	Array m_args;
+
+	// Keeps the call alive until completed has been emitted, even when no one else holds it.
+	Ref<SandboxAsyncCall> m_self;
+	Variant m_result;
+	bool m_completed = false;
+
+	MainThreadQueue m_queue;
+	SandboxWorkerContext m_context{ &m_queue };
+	Variant m_return_value;
+	std::atomic<bool> m_returned = false;
+};
@@ -1,10 +1,15 @@
 #include "sandbox.h"
 
+#include "elf/elf_image.h"
+#include "sandbox_project_settings.h"
 #include <godot_cpp/classes/dir_access.hpp>
 #include <godot_cpp/classes/file_access.hpp>
 #include <godot_cpp/classes/os.hpp>
 #include <godot_cpp/classes/project_settings.hpp>
+#include <godot_cpp/templates/hashfuncs.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
+#include <mutex>
+#include <unordered_map>
 
 #if defined(__linux__)
 # include <dlfcn.h>
@@ -29,16 +34,26 @@ extern "C" int unlink(const char* path);
 #endif
 extern "C" void libriscv_register_translation8(...);
 
-String Sandbox::emit_binary_translation(bool ignore_instruction_limit, bool automatic_nbit_as) const {
-	const std::string_view &binary = machine().memory.binary();
-	if (binary.empty()) {
-		ERR_PRINT("Sandbox: No binary loaded.");
-		return String();
-	}
+// The build system defines SANDBOX_COMMIT and SANDBOX_LIBRISCV_COMMIT when it can tell
+// them, and the cache is left out of builds that do not know what they were built from.
+#if defined(RISCV_BINARY_TRANSLATION) && !defined(__ANDROID__) && (defined(__linux__) || defined(YEP_IS_WINDOWS) || defined(YEP_IS_OSX)) \
+		&& defined(SANDBOX_COMMIT) && defined(SANDBOX_LIBRISCV_COMMIT)
+# define TRANSLATION_CACHE 1
+# if defined(__linux__)
+#  define TRANSLATION_SUFFIX ".so"
+# elif defined(YEP_IS_WINDOWS)
+#  define TRANSLATION_SUFFIX ".dll"
+# else
+#  define TRANSLATION_SUFFIX ".dylib"
+# endif
+#endif
+
 #ifdef RISCV_BINARY_TRANSLATION
+// Emit the translation of a program as C99, from a machine made only for that purpose.
+static std::string emit_translation(std::string_view binary, const riscv::MachineOptions<RISCV_ARCH> &base, bool ignore_instruction_limit, bool automatic_nbit_as) {
 	std::string code_output;
 	// 1. Re-create the same options
-	auto options = std::make_shared<riscv::MachineOptions<RISCV_ARCH>>(machine().options());
+	auto options = std::make_shared<riscv::MachineOptions<RISCV_ARCH>>(base);
 	options->use_shared_execute_segments = false;
 	options->translate_enabled = false;
 	options->translate_enable_embedded = false;
@@ -68,13 +83,24 @@ String Sandbox::emit_binary_translation(bool ignore_instruction_limit, bool auto
 	if constexpr (riscv::libtcc_enabled) {
 		m.cpu.current_execute_segment().wait_for_compilation_complete();
 	}
+	return code_output;
+}
+#endif
 
-	// 4. Verify that the translation was successful
+String Sandbox::emit_binary_translation(bool ignore_instruction_limit, bool automatic_nbit_as) const {
+	const std::string_view &binary = machine().memory.binary();
+	if (binary.empty()) {
+		ERR_PRINT("Sandbox: No binary loaded.");
+		return String();
+	}
+#ifdef RISCV_BINARY_TRANSLATION
+	const std::string code_output = emit_translation(binary, machine().options(), ignore_instruction_limit, automatic_nbit_as);
+	// Verify that the translation was successful
 	if (code_output.empty()) {
 		ERR_PRINT("Sandbox: Binary translation failed.");
 		return String();
 	}
-	// 5. Return the translated code
+	// Return the translated code
 	return String::utf8(code_output.c_str(), code_output.size());
 #else
 	ERR_PRINT("Sandbox: Binary translation is not enabled.");
@@ -120,55 +146,10 @@ bool Sandbox::load_binary_translation(const String &shared_library_path, bool al
 	return false;
 }
 
-bool Sandbox::try_compile_binary_translation(String shared_library_path, const String &cc, const String &extra_cflags, bool ignore_instruction_limit, bool automatic_nbit_as) {
-	if (this->is_binary_translated() && !this->is_jit()) {
-		return true;
-	}
-	if (this->is_in_vmcall()) {
-		ERR_PRINT("Sandbox: Cannot produce binary translation while in a VM call. This is a security risk.");
-		return false;
-	}
-	if (this->get_restrictions()) {
-		ERR_PRINT("Sandbox: Cannot produce binary translation while restrictions are enabled.");
-		return false;
-	}
-	if (shared_library_path.is_empty()) {
-		ERR_PRINT("Sandbox: No shared library path specified.");
-		return false;
-	}
-	if (!shared_library_path.begins_with("res://")) {
-		ERR_PRINT("Sandbox: Shared library path must begin with 'res://'.");
-		return false;
-	}
-	// Android, WebAssembly, Nintendo Switch, and iOS do not support direct
-	// compilation of binary translations into shared libraries (on that platform).
-#if defined(__ANDROID__) || defined(__wasm__) || defined(__SWITCH__) || defined(__EMSCRIPTEN__)
-	ERR_PRINT("Sandbox: Directly compiling binary translation is not supported on this platform.");
-	return false;
-#elif defined(__APPLE__) && !defined(__MACH__) // iOS?
-	// TODO: Check for iOS?
-	ERR_PRINT("Sandbox: Directly compiling binary translation is not supported on this platform.");
-	return false;
-#endif
-
-#ifdef __linux__
-	shared_library_path += ".so";
-#elif defined(YEP_IS_WINDOWS)
-	shared_library_path += ".dll";
-#elif defined(YEP_IS_OSX)
-	shared_library_path += ".dylib";
-#else
-	WARN_PRINT_ONCE("Sandbox: Compiling binary translations has not been implemented on this platform.");
-	return false;
-#endif
-	const String code = this->emit_binary_translation(ignore_instruction_limit, automatic_nbit_as);
-	if (code.is_empty()) {
-		ERR_PRINT("Sandbox: Failed to emit binary translation.");
-		return false;
-	}
-	static const String c99_path = "user://temp_sandbox_generated.c";
+// Compile C99 emitted by emit_translation() into a shared library that self-registers.
+static bool compile_translation(const String &code, const String &cc, const String &extra_cflags, const String &c99_path, const String &library_path) {
 	Ref<FileAccess> fa = FileAccess::open(c99_path, FileAccess::ModeFlags::WRITE);
-	if (!fa->is_open()) {
+	if (fa.is_null() || !fa->is_open()) {
 		ERR_PRINT("Sandbox: Failed to open file for writing: " + c99_path);
 		return false;
 	}
@@ -206,7 +187,7 @@ bool Sandbox::try_compile_binary_translation(String shared_library_path, const S
 		args.push_back("/Fe");
 	}
 #endif
-	args.push_back(shared_library_path.replace("res://", ""));
+	args.push_back(library_path);
 	if (!extra_cflags.is_empty())
 		args.append_array(extra_cflags.split(" "));
 	args.push_back(ProjectSettings::get_singleton()->globalize_path(c99_path));
@@ -217,13 +198,286 @@ bool Sandbox::try_compile_binary_translation(String shared_library_path, const S
 	Ref<DirAccess> dir = DirAccess::open("user://");
 	dir->remove(c99_path);
 	if (ret != 0) {
-		ERR_PRINT("Sandbox: Failed to compile generated code: " + shared_library_path);
+		ERR_PRINT("Sandbox: Failed to compile generated code: " + library_path);
 		UtilityFunctions::print(output);
 		return false;
 	}
 	return true;
 }
 
+bool Sandbox::try_compile_binary_translation(String shared_library_path, const String &cc, const String &extra_cflags, bool ignore_instruction_limit, bool automatic_nbit_as) {
+	if (this->is_binary_translated() && !this->is_jit()) {
+		return true;
+	}
+	if (this->is_in_vmcall()) {
+		ERR_PRINT("Sandbox: Cannot produce binary translation while in a VM call. This is a security risk.");
+		return false;
+	}
+	if (this->get_restrictions()) {
+		ERR_PRINT("Sandbox: Cannot produce binary translation while restrictions are enabled.");
+		return false;
+	}
+	if (shared_library_path.is_empty()) {
+		ERR_PRINT("Sandbox: No shared library path specified.");
+		return false;
+	}
+	if (!shared_library_path.begins_with("res://")) {
+		ERR_PRINT("Sandbox: Shared library path must begin with 'res://'.");
+		return false;
+	}
+	// Android, WebAssembly, Nintendo Switch, and iOS do not support direct
+	// compilation of binary translations into shared libraries (on that platform).
+#if defined(__ANDROID__) || defined(__wasm__) || defined(__SWITCH__) || defined(__EMSCRIPTEN__)
+	ERR_PRINT("Sandbox: Directly compiling binary translation is not supported on this platform.");
+	return false;
+#elif defined(__APPLE__) && !defined(__MACH__) // iOS?
+	// TODO: Check for iOS?
+	ERR_PRINT("Sandbox: Directly compiling binary translation is not supported on this platform.");
+	return false;
+#endif
+
+#ifdef __linux__
+	shared_library_path += ".so";
+#elif defined(YEP_IS_WINDOWS)
+	shared_library_path += ".dll";
+#elif defined(YEP_IS_OSX)
+	shared_library_path += ".dylib";
+#else
+	WARN_PRINT_ONCE("Sandbox: Compiling binary translations has not been implemented on this platform.");
+	return false;
+#endif
+	const String code = this->emit_binary_translation(ignore_instruction_limit, automatic_nbit_as);
+	if (code.is_empty()) {
+		ERR_PRINT("Sandbox: Failed to emit binary translation.");
+		return false;
+	}
+	static const String c99_path = "user://temp_sandbox_generated.c";
+	return compile_translation(code, cc, extra_cflags, c99_path, shared_library_path.replace("res://", ""));
+}
+
+/**
+ * The translation cache. When it is enabled, the first run of a program emits its binary
+ * translation and compiles it in the background, into user://. Every run after that, and
+ * every Sandbox made in this run once the compiler is done, loads it instead of translating
+ * the program again. The file name holds everything the translation depends on: the
+ * commits of the extension and of libriscv, the program and the translation options.
+ * The SHA-256 of each library is written next to it once it has been compiled, and a
+ * library is only loaded when it still matches, so one that was left half-written or
+ * has been replaced is not run.
+ **/
+#ifdef TRANSLATION_CACHE
+namespace {
+enum class CachedTranslation {
+	COMPILING,
+	COMPILED,
+	LOADED,
+	FAILED,
+};
+std::mutex translation_cache_mutex;
+struct CachedLibrary {
+	CachedTranslation state;
+	String sha256; // Once compiled in this run
+};
+// By file name, for all the Sandboxes in the process.
+std::unordered_map<std::string, CachedLibrary> translation_cache;
+static constexpr char TRANSLATION_CACHE_DIR[] = "user://sandbox_translations";
+static constexpr char TRANSLATION_BUILD[] = SANDBOX_COMMIT "/" SANDBOX_LIBRISCV_COMMIT;
+} // namespace
+
+static String translation_cache_path(std::string_view binary, bool ignore_instruction_limit, bool automatic_nbit_as) {
+	// The emitted code changes with libriscv, and how it is called with the extension, so
+	// a translation only fits the sources it was built from.
+	static const uint32_t build = hash_murmur3_buffer(TRANSLATION_BUILD, sizeof(TRANSLATION_BUILD) - 1);
+	const uint32_t program = hash_murmur3_buffer(binary.data(), binary.size());
+	char name[80];
+	snprintf(name, sizeof(name), "%08x-%08x-%zx-%d%d", build, program, binary.size(),
+			ignore_instruction_limit, automatic_nbit_as);
+	return String(TRANSLATION_CACHE_DIR) + "/" + name + TRANSLATION_SUFFIX;
+}
+
+// The hash recorded when the library was compiled, from this run or from the file next to it.
+static String expected_sha256(const String &path, const String &compiled_sha256) {
+	if (!compiled_sha256.is_empty()) {
+		return compiled_sha256;
+	}
+	Ref<FileAccess> fa = FileAccess::open(path + ".sha256", FileAccess::ModeFlags::READ);
+	if (fa.is_null() || !fa->is_open()) {
+		return String();
+	}
+	return fa->get_as_text().strip_edges();
+}
+#endif
+
+void Sandbox::load_cached_translation(std::string_view binary) {
+#ifdef TRANSLATION_CACHE
+	if (!SandboxProjectSettings::binary_translation_cache()) {
+		return;
+	}
+	const String path = translation_cache_path(binary, get_instructions_max() <= 0, m_bintr_automatic_nbit_as);
+	const std::string key = path.utf8().get_data();
+	std::lock_guard<std::mutex> lock(translation_cache_mutex);
+	auto it = translation_cache.find(key);
+	if (it != translation_cache.end() && it->second.state != CachedTranslation::COMPILED) {
+		return;
+	}
+	// Compiled in this run, or in an earlier one.
+	if (FileAccess::file_exists(path)) {
+		CachedLibrary &cached = translation_cache[key];
+		const String sha256 = expected_sha256(path, cached.sha256);
+		if (sha256.is_empty() || FileAccess::get_sha256(path) != sha256) {
+			ERR_PRINT("Sandbox: Cached binary translation does not match the library that was compiled: " + path);
+			cached.state = CachedTranslation::FAILED;
+			return;
+		}
+		const bool loaded = load_binary_translation(path, true);
+		cached.state = loaded ? CachedTranslation::LOADED : CachedTranslation::FAILED;
+	}
+#endif
+}
+
+void Sandbox::cache_translation(std::string_view binary) {
+#ifdef TRANSLATION_CACHE
+	if (!SandboxProjectSettings::binary_translation_cache() || this->get_restrictions()) {
+		return;
+	}
+	// Already running compiled code. JIT-compiled code is only kept for this run.
+	if (this->is_binary_translated() && !this->is_jit()) {
+		return;
+	}
+	const bool ignore_instruction_limit = get_instructions_max() <= 0;
+	const bool automatic_nbit_as = m_bintr_automatic_nbit_as;
+	const String path = translation_cache_path(binary, ignore_instruction_limit, automatic_nbit_as);
+	std::string key = path.utf8().get_data();
+	{
+		std::lock_guard<std::mutex> lock(translation_cache_mutex);
+		if (!translation_cache.emplace(key, CachedLibrary{ CachedTranslation::COMPILING, String() }).second) {
+			return;
+		}
+	}
+	ProjectSettings *project_settings = ProjectSettings::get_singleton();
+	DirAccess::make_dir_recursive_absolute(project_settings->globalize_path(TRANSLATION_CACHE_DIR));
+	const String library = project_settings->globalize_path(path);
+	const String c99 = library.get_basename() + ".c";
+	const String cc = SandboxProjectSettings::get_binary_translation_compiler();
+	auto options = std::make_shared<riscv::MachineOptions<RISCV_ARCH>>(machine().options());
+
+	// The program may be gone by the time the compiler is done, so the job has its own copy.
+	start_worker_thread([program = std::string(binary), options, ignore_instruction_limit, automatic_nbit_as, library, c99, cc, key = std::move(key)]() {
+		String sha256;
+		try {
+			const std::string code = emit_translation(program, *options, ignore_instruction_limit, automatic_nbit_as);
+			if (!code.empty() && compile_translation(String::utf8(code.c_str(), code.size()), cc, "", c99, library)) {
+				sha256 = FileAccess::get_sha256(library);
+				Ref<FileAccess> fa = FileAccess::open(library + ".sha256", FileAccess::ModeFlags::WRITE);
+				if (fa.is_valid() && fa->is_open()) {
+					fa->store_string(sha256);
+				}
+			}
+		} catch (const std::exception &e) {
+			ERR_PRINT(("Sandbox: Failed to cache binary translation: " + std::string(e.what())).c_str());
+		}
+		std::lock_guard<std::mutex> lock(translation_cache_mutex);
+		translation_cache[key] = CachedLibrary{ sha256.is_empty() ? CachedTranslation::FAILED : CachedTranslation::COMPILED, sha256 };
+	});
+#else
+	(void)binary;
+#endif
+}
+
+/**
+ * Tiered execution. libriscv translates a whole execute segment at a time, so the unit
+ * that tiers up is the program: with a tier-up threshold it starts out interpreted, with
+ * the JIT compiler off, and every call into it is counted. Calls are the entries that can
+ * be seen from outside the dispatch loop, and the count is shared by every instance of
+ * the program. Once the threshold is reached, the first instance to notice drops its
+ * execute segment, which is decoded again with the JIT compiler on when it is entered
+ * next. The JIT compiler runs in the background and patches the result into the decoder
+ * cache when background compilation is enabled. After that call the segment is published
+ * in the ELFImage, and every other instance of the program switches to it instead of
+ * compiling the program again.
+ **/
+int64_t Sandbox::get_jit_entries() const {
+	if (this->m_image != nullptr) {
+		return this->m_image->jit_entries.load(std::memory_order_relaxed);
+	}
+	return this->m_jit_entries;
+}
+
+void Sandbox::count_jit_entry() {
+	if (this->m_jit_publish_pending) {
+		this->publish_jit_segment();
+		return;
+	}
+	uint32_t entries = ++this->m_jit_entries;
+	if (this->m_image != nullptr) {
+		entries = this->m_image->jit_entries.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+	if (entries >= uint32_t(this->m_jit_tier_up_threshold)) {
+		this->tier_up();
+	}
+}
+
+void Sandbox::tier_up() {
+#if defined(RISCV_BINARY_TRANSLATION) || defined(RISCV_ASMJIT)
+	// A translation that came with the program is already as fast as it gets.
+	if (this->is_binary_translated()) {
+		this->m_jit_tier_pending = false;
+		return;
+	}
+	std::shared_ptr<riscv::DecodedExecuteSegment<RISCV_ARCH>> compiled;
+	if (this->m_image != nullptr) {
+		std::lock_guard<std::mutex> lock(this->m_image->execute_mutex);
+		if (this->m_image->jit_compiling) {
+			// Another instance is compiling the program. Keep interpreting until it is done.
+			return;
+		}
+		if (this->m_image->jit_compiled) {
+			compiled = this->m_image->execute_segment;
+		} else {
+			this->m_image->jit_compiling = true;
+			this->m_jit_publish_pending = true;
+		}
+	}
+	auto options = std::make_shared<riscv::MachineOptions<RISCV_ARCH>>(machine().options());
+#  ifdef RISCV_BINARY_TRANSLATION
+	options->translate_invoke_compiler = riscv::libtcc_enabled;
+#  endif
+#  ifdef RISCV_ASMJIT
+	options->asmjit_enabled = true;
+#  endif
+	// The interpreted segment is shared with the other instances of the program, and
+	// would be handed right back.
+	options->use_shared_execute_segments = false;
+	machine().set_options(std::move(options));
+	if (compiled != nullptr) {
+		// Calls into the program come from outside of it, so nothing is running on the
+		// interpreted segment that is being replaced.
+		auto &segment = machine().memory.exec_segment_for(machine().memory.start_address());
+		segment = std::move(compiled);
+		machine().cpu.set_execute_segment(*segment);
+		this->m_jit_tier_pending = false;
+	} else {
+		// Hot enough to be worth keeping for later runs too.
+		this->cache_translation(machine().memory.binary());
+		// Decoded and compiled again when the program is entered the next time.
+		machine().memory.evict_execute_segments();
+		this->m_jit_tier_pending = this->m_jit_publish_pending;
+	}
+	this->m_jit_tier_ups++;
+#else
+	this->m_jit_tier_pending = false;
+#endif
+}
+
+void Sandbox::publish_jit_segment() {
+	this->m_jit_publish_pending = false;
+	this->m_jit_tier_pending = false;
+	std::lock_guard<std::mutex> lock(this->m_image->execute_mutex);
+	this->m_image->execute_segment = machine().memory.exec_segment_for(machine().memory.start_address());
+	this->m_image->jit_compiling = false;
+	this->m_image->jit_compiled = true;
+}
+
 bool Sandbox::is_binary_translated() const {
 	// Get main execute segment
 	auto &main_seg = this->m_machine->memory.exec_segment_for(this->m_machine->memory.start_address());
@@ -0,0 +1,183 @@
+#include "sandbox.h"
+
+#include "mapped_file.h"
+#include <cstring>
+#include <godot_cpp/classes/time.hpp>
+
+// A machine that no longer runs anything, kept only so that forks can borrow its pages.
+struct Sandbox::ForkSource {
+	machine_t *machine = nullptr;
+	// The machine refers into the program it was loaded from instead of copying it.
+	// Holding a reference here keeps the program alive when the ELFScript is reloaded.
+	std::shared_ptr<const MappedFile> program_file;
+	PackedByteArray program_bytes;
+	// The template's state generation when it was frozen. As long as that has not changed,
+	// the template still matches the frozen machine and can be forked from it again.
+	uint64_t generation = 0;
+
+	machine_t *fork() const {
+		auto options = std::make_shared<riscv::MachineOptions<RISCV_ARCH>>(machine->options());
+		machine_t *fork = new machine_t{ *machine, *options };
+		fork->set_options(std::move(options));
+		return fork;
+	}
+
+	~ForkSource() {
+		try {
+			delete machine;
+		} catch (const std::exception &e) {
+			ERR_PRINT(("Sandbox exception: " + std::string(e.what())).c_str());
+		}
+	}
+};
+
+std::shared_ptr<const Sandbox::ForkSource> Sandbox::freeze_for_forking() {
+	if (this->m_fork_source != nullptr && this->m_fork_source->generation == this->m_state_generation) {
+		return this->m_fork_source;
+	}
+	// Pages can only be shared with a machine that never changes again, so this sandbox
+	// hands its machine over and carries on running in a fork of it, like everyone else.
+	auto source = std::make_shared<ForkSource>();
+	// The frozen machine must never be written to again, not even to roll back.
+	this->m_checkpoint = nullptr;
+	if (this->m_program_data.is_valid()) {
+		source->program_file = this->m_program_data->get_program_file();
+	} else {
+		source->program_bytes = this->m_program_bytes;
+	}
+	source->generation = this->m_state_generation;
+	try {
+		if (this->m_fork_source == nullptr) {
+			source->machine = this->m_machine;
+			this->m_machine = source->fork();
+		} else {
+			// Already running in a fork, which borrows from the previous source. A copy
+			// that stands on its own is frozen instead, so that the previous source goes
+			// away with the last of the forks that still borrow from it. This compares
+			// the whole arena, and is the cost of forking a sandbox that ran since it was
+			// last forked, such as vmcall_async() after a vmcall().
+			source->machine = this->copy_machine();
+			machine_t *fork = source->fork();
+			delete this->m_machine;
+			this->m_machine = fork;
+		}
+	} catch (const std::exception &e) {
+		ERR_PRINT(("Sandbox fork exception: " + std::string(e.what())).c_str());
+		// The machine is still ours, not the (failed) source's.
+		if (this->m_fork_source == nullptr) {
+			source->machine = nullptr;
+		}
+		return nullptr;
+	}
+	this->m_fork_source = source;
+
+	this->install_machine_callbacks();
+	return source;
+}
+
+machine_t *Sandbox::copy_machine() const {
+	const machine_t &m = machine();
+	auto options = std::make_shared<riscv::MachineOptions<RISCV_ARCH>>(m.options());
+	auto copy = std::make_unique<machine_t>(this->program_view(), *options);
+	copy->set_options(std::move(options));
+	copy->setup_native_heap(HEAP_SYSCALLS_BASE, this->m_heap_area, this->m_heap_size);
+	copy->setup_native_memory(MEMORY_SYSCALLS_BASE);
+
+	std::vector<uint8_t> state;
+	m.serialize_to(state);
+	if (copy->deserialize_from(state) < 0) {
+		throw std::runtime_error("Failed to copy machine state");
+	}
+	if (copy->memory.memory_arena_size() != m.memory.memory_arena_size()) {
+		throw std::runtime_error("Guest arena size does not match the machine copied");
+	}
+	// Only pages that differ are written, so that the copy is only backed by memory where
+	// the guest has been.
+	const size_t page_size = riscv::Page::size();
+	const uint8_t *src = (const uint8_t *)m.memory.memory_arena_ptr();
+	uint8_t *dst = (uint8_t *)copy->memory.memory_arena_ptr();
+	for (size_t offset = 0; offset < m.memory.memory_arena_size(); offset += page_size) {
+		if (std::memcmp(&dst[offset], &src[offset], page_size) != 0) {
+			std::memcpy(&dst[offset], &src[offset], page_size);
+		}
+	}
+	return copy.release();
+}
+
+bool Sandbox::fork_from(Sandbox *p_template) {
+	if (p_template == nullptr || p_template == this) {
+		ERR_PRINT("Sandbox: Invalid template to fork from.");
+		return false;
+	}
+	if (this->is_busy_on_worker_thread() || p_template->is_busy_on_worker_thread()) {
+		ERR_PRINT("Cannot fork a sandbox while a worker thread is running it.");
+		return false;
+	}
+	if (this->is_in_vmcall() || p_template->is_in_vmcall()) {
+		ERR_PRINT("Cannot fork a sandbox while a VM call is in progress.");
+		return false;
+	}
+	if (!p_template->has_program_loaded() || p_template->m_resumable_mode) {
+		ERR_PRINT("Sandbox: Can only fork from a sandbox that has finished initializing a program.");
+		return false;
+	}
+	const uint64_t fork_t0 = Time::get_singleton()->get_ticks_usec();
+
+	std::shared_ptr<const ForkSource> source = p_template->freeze_for_forking();
+	if (source == nullptr) {
+		return false;
+	}
+
+	// Settings that decide how the program runs are part of what is being copied.
+	this->m_max_refs = p_template->m_max_refs;
+	this->m_memory_max = p_template->m_memory_max;
+	this->m_insn_max = p_template->m_insn_max;
+	this->m_allocations_max = p_template->m_allocations_max;
+	this->m_precise_simulation = p_template->m_precise_simulation;
+	this->m_bintr_automatic_nbit_as = p_template->m_bintr_automatic_nbit_as;
+	this->m_bintr_register_caching = p_template->m_bintr_register_caching;
+	this->m_bintr_bg_compilation = p_template->m_bintr_bg_compilation;
+	this->m_heap_area = p_template->m_heap_area;
+	this->m_heap_size = p_template->m_heap_size;
+
+	this->set_program_data_internal(p_template->m_program_data);
+	this->m_program_bytes = p_template->m_program_bytes;
+	this->full_reset();
+	this->set_unboxed_arguments(p_template->get_unboxed_arguments());
+	this->m_source_version = p_template->m_source_version;
+	this->m_image = p_template->m_image;
+
+	try {
+		this->m_machine = source->fork();
+		this->m_fork_source = std::move(source);
+	} catch (const std::exception &e) {
+		ERR_PRINT(("Sandbox fork exception: " + std::string(e.what())).c_str());
+		this->reset_machine();
+		return false;
+	}
+
+	machine_t &m = machine();
+	this->install_machine_callbacks();
+	if (m.has_arena()) {
+		m.arena().set_max_chunks(get_allocations_max());
+	}
+	this->m_guest_heap = p_template->m_guest_heap;
+	this->m_arena_from_file = p_template->m_arena_from_file;
+	// The fork runs the template's execute segments, so it tiers up when the template would.
+	this->m_jit_tier_pending = p_template->m_jit_tier_pending;
+
+	// Guest memory still holds the indices of the template's permanent Variants, so they
+	// must resolve to the same slots here. Each fork gets its own copy to mutate.
+	this->m_states[0].copy_from(p_template->m_states[0]);
+
+	this->m_properties = p_template->m_properties;
+	this->m_public_api_functions = p_template->m_public_api_functions.duplicate();
+	this->m_lookup = p_template->m_lookup;
+	this->m_call_stubs = p_template->m_call_stubs;
+	// The buffer lives in guest memory, which the fork has a copy of.
+	this->m_command_buffer = p_template->m_command_buffer;
+
+	const uint64_t fork_t1 = Time::get_singleton()->get_ticks_usec();
+	m_accumulated_startup_time += (fork_t1 - fork_t0) / 1e6;
+	return true;
+}
@@ -1454,13 +1454,12 @@ PackedStringArray Sandbox::get_public_functions(const machine_t &machine) {
 	return result;
 }
 
-Sandbox::BinaryInfo Sandbox::get_program_info_from_binary(const PackedByteArray &binary) {
+Sandbox::BinaryInfo Sandbox::get_program_info_from_binary(std::string_view binary_view) {
 	BinaryInfo result;
-	if (binary.is_empty()) {
+	if (binary_view.empty()) {
 		return result;
 	}
 
-	const std::string_view binary_view = std::string_view{ (const char *)binary.ptr(), static_cast<size_t>(binary.size()) };
 	try {
 		// Instantiate Machine without loading the ELF
 		machine_t machine{ binary_view, riscv::MachineOptions<RISCV_ARCH>{
@@ -158,6 +158,7 @@ static String emit_class(ClassDBSingleton *class_db, const HashSet<String> &cpp_
 	for (int j = 0; j < methods.size(); j++) {
 		Dictionary method = methods[j];
 		String method_name = method["name"];
+		const String engine_method_name = method_name;
 		Dictionary return_value = method["return"];
 		const int type = int(return_value["type"]);
 		// Skip methods that are empty, and methods with '/' and '-' in the name.
@@ -317,7 +318,15 @@ static String emit_class(ClassDBSingleton *class_db, const HashSet<String> &cpp_
 			// Sadly, it breaks the call operator, so hold off on this for now.
 			api += ") {\n";
 			// Method body: return operator() (\"" + method_name + "\"", " + argument_list + ");\n";
-			if (is_void) {
+			if (Sandbox::is_ptrcall_method(method)) {
+				// Plain values only, so the method can be called with them in native form.
+				const String hash = itos(Sandbox::get_method_bind_hash(method)) + "u";
+				if (is_void) {
+					api += "      ptrcall<void>(\"" + engine_method_name + "\", " + hash;
+				} else {
+					api += "      return ptrcall<" + String(cpp_compatible_variant_type(type)) + ">(\"" + engine_method_name + "\", " + hash;
+				}
+			} else if (is_void) {
 				// Void return type.
 				api += "      voidcall(\"" + method_name + "\"";
 			} else {
@@ -0,0 +1,222 @@
+#include "sandbox_group.h"
+
+#include <godot_cpp/classes/os.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/core/object.hpp>
+
+void SandboxGroup::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("add_sandbox", "sandbox"), &SandboxGroup::add_sandbox);
+	ClassDB::bind_method(D_METHOD("remove_sandbox", "sandbox"), &SandboxGroup::remove_sandbox);
+	ClassDB::bind_method(D_METHOD("clear"), &SandboxGroup::clear);
+	ClassDB::bind_method(D_METHOD("get_sandbox_count"), &SandboxGroup::get_sandbox_count);
+	ClassDB::bind_method(D_METHOD("vmcall_all", "function", "args"), &SandboxGroup::vmcall_all, DEFVAL(Array()));
+
+	ClassDB::bind_method(D_METHOD("set_thread_count", "count"), &SandboxGroup::set_thread_count);
+	ClassDB::bind_method(D_METHOD("get_thread_count"), &SandboxGroup::get_thread_count);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "thread_count", PROPERTY_HINT_RANGE, "0,256,1"), "set_thread_count", "get_thread_count");
+
+	// Group for monitored scheduling.
+	ADD_GROUP("Group Monitoring", "monitor_");
+
+	ClassDB::bind_method(D_METHOD("get_stolen_calls"), &SandboxGroup::get_stolen_calls);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "monitor_stolen_calls", PROPERTY_HINT_NONE, "Calls taken from another worker by the last vmcall_all", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_stolen_calls");
+
+	ClassDB::bind_method(D_METHOD("get_main_thread_calls"), &SandboxGroup::get_main_thread_calls);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "monitor_main_thread_calls", PROPERTY_HINT_NONE, "System calls handed to the main thread by the last vmcall_all", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_main_thread_calls");
+}
+
+SandboxGroup::~SandboxGroup() {
+	this->stop_workers();
+}
+
+void SandboxGroup::add_sandbox(Sandbox *sandbox) {
+	if (sandbox == nullptr) {
+		return;
+	}
+	const uint64_t id = sandbox->get_instance_id();
+	if (std::find(m_sandboxes.begin(), m_sandboxes.end(), id) != m_sandboxes.end()) {
+		return;
+	}
+	m_sandboxes.push_back(id);
+}
+
+void SandboxGroup::remove_sandbox(Sandbox *sandbox) {
+	if (sandbox == nullptr) {
+		return;
+	}
+	m_sandboxes.erase(std::remove(m_sandboxes.begin(), m_sandboxes.end(), sandbox->get_instance_id()), m_sandboxes.end());
+}
+
+void SandboxGroup::set_thread_count(int count) {
+	if (m_in_vmcall_all) {
+		ERR_PRINT("SandboxGroup: Cannot change the thread count during vmcall_all().");
+		return;
+	}
+	m_thread_count = std::max(0, count);
+	// Started again with the new count on the next call.
+	this->stop_workers();
+}
+
+void SandboxGroup::start_workers() {
+	const unsigned count = m_thread_count > 0 ? m_thread_count : std::max(1, OS::get_singleton()->get_processor_count());
+	m_deques.clear();
+	for (unsigned i = 0; i < count; i++) {
+		m_deques.push_back(std::make_unique<WorkerDeque>());
+	}
+	for (unsigned i = 0; i < count; i++) {
+		m_workers.emplace_back([this, i]() {
+			this->worker_loop(i);
+		});
+	}
+}
+
+void SandboxGroup::stop_workers() {
+	m_queue.update([this]() {
+		m_stopping = true;
+	});
+	for (std::thread &worker : m_workers) {
+		worker.join();
+	}
+	m_workers.clear();
+	m_stopping = false;
+}
+
+void SandboxGroup::worker_loop(unsigned index) {
+	uint64_t round = 0;
+	bool stopping = false;
+	while (m_queue.wait_for_work([&]() {
+		stopping = m_stopping;
+		if (m_round != round) {
+			round = m_round;
+			return true;
+		}
+		return stopping;
+	})) {
+		if (stopping) {
+			return;
+		}
+		unsigned job;
+		while (this->take_job(index, job)) {
+			this->run_job(m_jobs[job]);
+		}
+	}
+}
+
+bool SandboxGroup::take_job(unsigned worker, unsigned &job) {
+	{
+		WorkerDeque &own = *m_deques[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty()) {
+			job = own.jobs.front();
+			own.jobs.pop_front();
+			return true;
+		}
+	}
+	for (size_t i = 1; i < m_deques.size(); i++) {
+		WorkerDeque &victim = *m_deques[(worker + i) % m_deques.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			job = victim.jobs.back();
+			victim.jobs.pop_back();
+			m_stolen_calls++;
+			return true;
+		}
+	}
+	return false;
+}
+
+void SandboxGroup::run_job(Job &job) {
+	job.context.enter();
+	try {
+		job.result = job.sandbox->vmcall_internal(job.address, m_argptrs.data(), int(m_argptrs.size()));
+	} catch (const std::exception &e) {
+		ERR_PRINT(("Sandbox exception: " + std::string(e.what())).c_str());
+	}
+	job.context.leave();
+
+	m_queue.update([this]() {
+		m_jobs_done++;
+	});
+}
+
+Array SandboxGroup::vmcall_all(const Variant &function, const Array &args) {
+	if (m_in_vmcall_all) {
+		ERR_PRINT("SandboxGroup: vmcall_all() is already in progress.");
+		return Array();
+	}
+	// Sandboxes that were freed are dropped here, instead of being tracked.
+	std::vector<uint64_t> alive;
+	alive.reserve(m_sandboxes.size());
+	m_jobs.clear();
+	for (const uint64_t id : m_sandboxes) {
+		Sandbox *sandbox = Object::cast_to<Sandbox>(ObjectDB::get_instance(id));
+		if (sandbox == nullptr) {
+			continue;
+		}
+		alive.push_back(id);
+		Job &job = m_jobs.emplace_back(&m_queue);
+		// A sandbox that is busy elsewhere is skipped, and returns null.
+		if (!sandbox->has_program_loaded() || sandbox->is_in_vmcall() || sandbox->is_async_worker()) {
+			continue;
+		}
+		job.address = sandbox->cached_address_of_variant(function);
+		if (job.address == 0) {
+			ERR_PRINT("Function not found: " + function.operator String() + " (Added to the public API?)");
+			continue;
+		}
+		job.sandbox = sandbox;
+	}
+	m_sandboxes = std::move(alive);
+
+	// Every worker reads the arguments, and none of them may change them.
+	std::vector<Variant> arguments(args.size());
+	m_argptrs.resize(arguments.size());
+	for (size_t i = 0; i < arguments.size(); i++) {
+		arguments[i] = args[i].duplicate(true);
+		m_argptrs[i] = &arguments[i];
+	}
+
+	if (m_workers.empty()) {
+		this->start_workers();
+	}
+	// Deal the calls out evenly, and let the workers even out the rest.
+	size_t runnable = 0;
+	for (unsigned i = 0; i < m_jobs.size(); i++) {
+		Job &job = m_jobs[i];
+		if (job.sandbox == nullptr) {
+			continue;
+		}
+		job.sandbox->m_worker = &job.context;
+		WorkerDeque &deque = *m_deques[runnable % m_deques.size()];
+		std::lock_guard<std::mutex> lock(deque.mutex);
+		deque.jobs.push_back(i);
+		runnable++;
+	}
+
+	m_in_vmcall_all = true;
+	m_stolen_calls = 0;
+	m_queue.update([this]() {
+		m_jobs_done = 0;
+		m_round++;
+	});
+	m_queue.wait_for([&]() {
+		return m_jobs_done == runnable;
+	});
+	// Commands handed over by the last calls to return.
+	m_queue.run_pending();
+	m_in_vmcall_all = false;
+
+	Array results;
+	results.resize(m_jobs.size());
+	m_main_thread_calls = 0;
+	for (size_t i = 0; i < m_jobs.size(); i++) {
+		Job &job = m_jobs[i];
+		if (job.sandbox != nullptr) {
+			job.sandbox->m_worker = nullptr;
+		}
+		m_main_thread_calls += job.context.get_main_thread_calls();
+		results[i] = std::move(job.result);
+	}
+	m_jobs.clear();
+	return results;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "sandbox.h"
+#include "sandbox_worker.h"
+#include <deque>
+#include <thread>
+
+/**
+ * @brief Runs the same function in many sandboxes at once, spread over a pool of threads.
+ *
+ * Sandboxes do not share guest state, so a call into one can run alongside calls into the
+ * others. Each sandbox is only ever run by one worker at a time, and the main thread waits
+ * in vmcall_all() until every call has returned. Meanwhile it runs the game API system calls
+ * that the sandboxes hand over to it, so that only the main thread touches the engine.
+ * Deferred calls and queue_free() are collected in a per-sandbox command buffer instead, and
+ * the guest does not wait for them. Workers start with an even share of the sandboxes, and
+ * steal from the others when they run out, as some calls take much longer than others.
+ **/
+class SandboxGroup : public RefCounted {
+	GDCLASS(SandboxGroup, RefCounted);
+
+protected:
+	static void _bind_methods();
+
+public:
+	SandboxGroup() {}
+	~SandboxGroup();
+
+	/// @brief Add a sandbox to the group. A sandbox that is freed is dropped from the group.
+	void add_sandbox(Sandbox *sandbox);
+	/// @brief Remove a sandbox from the group.
+	void remove_sandbox(Sandbox *sandbox);
+	/// @brief Remove all sandboxes from the group.
+	void clear() { m_sandboxes.clear(); }
+	/// @brief Number of sandboxes in the group.
+	int get_sandbox_count() const { return int(m_sandboxes.size()); }
+
+	/// @brief Call a function in every sandbox in the group, in parallel.
+	/// @param function The name of the function to call.
+	/// @param args The arguments to pass to the function, the same for every sandbox.
+	/// @return The return value of each call, in the order the sandboxes were added. A call
+	/// that fails, or a sandbox that has no such function, returns null.
+	Array vmcall_all(const Variant &function, const Array &args);
+
+	/// @brief Set the number of worker threads. Zero uses one thread per CPU core.
+	void set_thread_count(int count);
+	int get_thread_count() const { return m_thread_count; }
+
+	/// @brief Number of calls that a worker took from another worker in the last vmcall_all().
+	int64_t get_stolen_calls() const { return m_stolen_calls; }
+	/// @brief Number of system calls handed to the main thread in the last vmcall_all().
+	int64_t get_main_thread_calls() const { return m_main_thread_calls; }
+
+private:
+	// Made in place, as the worker context can be neither copied nor moved.
+	struct Job {
+		explicit Job(MainThreadQueue *queue) :
+				context(queue) {}
+
+		Sandbox *sandbox = nullptr;
+		gaddr_t address = 0;
+		SandboxWorkerContext context;
+		Variant result;
+	};
+	// Each worker takes from the front of its own deque, and steals from the back of others.
+	struct WorkerDeque {
+		std::mutex mutex;
+		std::deque<unsigned> jobs;
+	};
+	void start_workers();
+	void stop_workers();
+	void worker_loop(unsigned index);
+	bool take_job(unsigned worker, unsigned &job);
+	void run_job(Job &job);
+
+	std::vector<uint64_t> m_sandboxes;
+	int m_thread_count = 0;
+	bool m_in_vmcall_all = false;
+
+	// The current vmcall_all(), shared with the workers.
+	std::deque<Job> m_jobs;
+	std::vector<const Variant *> m_argptrs;
+	std::vector<std::unique_ptr<WorkerDeque>> m_deques;
+
+	// Guarded by the queue, see MainThreadQueue::update().
+	MainThreadQueue m_queue;
+	std::vector<std::thread> m_workers;
+	uint64_t m_round = 0;
+	size_t m_jobs_done = 0;
+	bool m_stopping = false;
+
+	// Stats
+	std::atomic<int64_t> m_stolen_calls = 0;
+	int64_t m_main_thread_calls = 0;
+};
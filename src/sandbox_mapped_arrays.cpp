@@ -0,0 +1,194 @@
+#include "sandbox.h"
+
+#include "syscalls_helpers.hpp"
+
+// Views are placed far above the arena, where the guest only reaches them through the
+// virtual pages that map them.
+static constexpr gaddr_t MAPPED_ARRAYS_BASE = gaddr_t(1) << 40;
+static constexpr unsigned MAX_MAPPED_ARRAYS = 64;
+static constexpr gaddr_t PAGE_SIZE = riscv::Page::size();
+
+static inline uintptr_t page_down(uintptr_t addr) { return addr & ~uintptr_t(PAGE_SIZE - 1); }
+static inline uintptr_t page_up(uintptr_t addr) { return page_down(addr + PAGE_SIZE - 1); }
+
+// The first and last page of a view also hold whatever is next to the array on the host,
+// which the guest may not see. Those pages are copies, and the part of the array on them is
+// host..host+r_head and r_tail..host+bytes. The pages in between are the array itself.
+static void copied_parts(uintptr_t host, size_t bytes, size_t &r_head, uintptr_t &r_tail) {
+	const uintptr_t head_end = std::min(page_up(host), host + bytes);
+	r_head = head_end - host;
+	r_tail = std::max(page_down(host + bytes), head_end);
+}
+
+template <typename PA>
+static uint8_t *packed_array_storage(Variant &var, bool writable, Variant &r_holder, size_t &r_elements, size_t &r_bytes) {
+	PA array = var;
+	r_elements = array.size();
+	r_bytes = r_elements * sizeof(array[0]);
+	if (r_elements == 0) {
+		return nullptr;
+	}
+	uint8_t *data;
+	if (writable) {
+		// The copy above shares the storage, so this gives it storage of its own, which
+		// the Variant then shares instead.
+		data = reinterpret_cast<uint8_t *>(array.ptrw());
+		var = array;
+	} else {
+		data = const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(array.ptr()));
+	}
+	r_holder = std::move(array);
+	return data;
+}
+
+gaddr_t Sandbox::map_packed_array(int32_t idx, bool writable, size_t &r_elements) {
+	if (UNLIKELY(this->m_bintr_automatic_nbit_as && this->is_binary_translated())) {
+		ERR_PRINT("PackedArray views cannot be used with an n-bit address space");
+		throw std::runtime_error("PackedArray views cannot be used with an n-bit address space");
+	}
+	if (UNLIKELY(this->m_mapped_arrays.size() >= MAX_MAPPED_ARRAYS)) {
+		ERR_PRINT("Too many PackedArray views");
+		throw std::runtime_error("Too many PackedArray views");
+	}
+	// A read-only view leaves the Variant alone, as it may be the caller's own.
+	Variant readonly;
+	if (!writable) {
+		readonly = riscv::get_scoped_variant_or_throw(*this, idx, "PackedArray view");
+	}
+	Variant &var = writable ? this->get_mutable_scoped_variant(idx) : readonly;
+
+	Variant holder;
+	size_t bytes = 0;
+	uint8_t *data = nullptr;
+	switch (var.get_type()) {
+		case Variant::PACKED_BYTE_ARRAY:
+			data = packed_array_storage<PackedByteArray>(var, writable, holder, r_elements, bytes);
+			break;
+		case Variant::PACKED_INT32_ARRAY:
+			data = packed_array_storage<PackedInt32Array>(var, writable, holder, r_elements, bytes);
+			break;
+		case Variant::PACKED_INT64_ARRAY:
+			data = packed_array_storage<PackedInt64Array>(var, writable, holder, r_elements, bytes);
+			break;
+		case Variant::PACKED_FLOAT32_ARRAY:
+			data = packed_array_storage<PackedFloat32Array>(var, writable, holder, r_elements, bytes);
+			break;
+		case Variant::PACKED_FLOAT64_ARRAY:
+			data = packed_array_storage<PackedFloat64Array>(var, writable, holder, r_elements, bytes);
+			break;
+		case Variant::PACKED_VECTOR2_ARRAY:
+			data = packed_array_storage<PackedVector2Array>(var, writable, holder, r_elements, bytes);
+			break;
+		case Variant::PACKED_VECTOR3_ARRAY:
+			data = packed_array_storage<PackedVector3Array>(var, writable, holder, r_elements, bytes);
+			break;
+		case Variant::PACKED_VECTOR4_ARRAY:
+			data = packed_array_storage<PackedVector4Array>(var, writable, holder, r_elements, bytes);
+			break;
+		case Variant::PACKED_COLOR_ARRAY:
+			data = packed_array_storage<PackedColorArray>(var, writable, holder, r_elements, bytes);
+			break;
+		default:
+			ERR_PRINT("PackedArray view: Not a Packed*Array of plain values, but " + String(GuestVariant::type_name(var.get_type())));
+			throw std::runtime_error("PackedArray view: Not a Packed*Array of plain values, but " + std::string(GuestVariant::type_name(var.get_type())));
+	}
+	if (data == nullptr) {
+		return 0;
+	}
+
+	// The view keeps the offset of the array within its first host page, so that every
+	// whole page of the array lines up with a guest page.
+	const uintptr_t host = uintptr_t(data);
+	const uintptr_t host_begin = page_down(host);
+	const uintptr_t host_end = page_up(host + bytes);
+	if (this->m_mapped_arrays.empty()) {
+		this->m_mapped_arrays_end = MAPPED_ARRAYS_BASE;
+	}
+	MappedPackedArray view;
+	view.window = this->m_mapped_arrays_end;
+	view.window_size = host_end - host_begin;
+	view.address = view.window + (host - host_begin);
+	view.data = data;
+	view.bytes = bytes;
+	view.state = &this->state();
+	view.writable = writable;
+	// An unmapped page between views catches running off the end of one.
+	this->m_mapped_arrays_end += view.window_size + PAGE_SIZE;
+
+	machine_t &m = this->machine();
+	riscv::PageAttributes attr;
+	attr.read = true;
+	attr.write = writable;
+	attr.exec = false;
+	size_t head;
+	uintptr_t tail;
+	copied_parts(host, bytes, head, tail);
+	const uintptr_t inner_begin = host + head;
+	if (tail > inner_begin) {
+		m.memory.insert_non_owned_memory(view.window + (inner_begin - host_begin), (void *)inner_begin, tail - inner_begin, attr);
+	}
+	m.memory.memcpy(view.address, data, head);
+	m.memory.memcpy(view.address + (tail - host), (const void *)tail, host + bytes - tail);
+	if (!writable) {
+		m.memory.set_page_attr(view.window, PAGE_SIZE, attr);
+		m.memory.set_page_attr(view.window + view.window_size - PAGE_SIZE, PAGE_SIZE, attr);
+	}
+	view.array = std::move(holder);
+	this->m_mapped_arrays.push_back(std::move(view));
+	return this->m_mapped_arrays.back().address;
+}
+
+Sandbox::MappedPackedArray &Sandbox::find_packed_array_view(gaddr_t address) {
+	for (MappedPackedArray &view : this->m_mapped_arrays) {
+		if (view.address == address) {
+			return view;
+		}
+	}
+	ERR_PRINT("Not a PackedArray view");
+	throw std::runtime_error("Not a PackedArray view");
+}
+
+void Sandbox::commit_packed_array(gaddr_t address) {
+	const MappedPackedArray &view = this->find_packed_array_view(address);
+	if (!view.writable) {
+		return;
+	}
+	const uintptr_t host = uintptr_t(view.data);
+	size_t head;
+	uintptr_t tail;
+	copied_parts(host, view.bytes, head, tail);
+	machine_t &m = this->machine();
+	m.memory.memcpy_out(view.data, view.address, head);
+	m.memory.memcpy_out((void *)tail, view.address + (tail - host), host + view.bytes - tail);
+}
+
+void Sandbox::unmap_packed_array(gaddr_t address) {
+	MappedPackedArray &view = this->find_packed_array_view(address);
+	this->remove_packed_array_view(view);
+	this->m_mapped_arrays.erase(this->m_mapped_arrays.begin() + (&view - this->m_mapped_arrays.data()));
+}
+
+void Sandbox::remove_packed_array_view(MappedPackedArray &view) {
+	if (view.writable) {
+		this->commit_packed_array(view.address);
+	}
+	machine_t &m = this->machine();
+	m.memory.free_pages(view.window, view.window_size);
+	// The guest may still have the pages of the view in its page caches.
+	m.memory.invalidate_reset_cache();
+}
+
+void Sandbox::unmap_packed_arrays(const CurrentState &state) {
+	for (size_t i = this->m_mapped_arrays.size(); i > 0; i--) {
+		MappedPackedArray &view = this->m_mapped_arrays[i - 1];
+		if (view.state != &state) {
+			continue;
+		}
+		try {
+			this->remove_packed_array_view(view);
+		} catch (const std::exception &e) {
+			ERR_PRINT(("Sandbox exception: " + std::string(e.what())).c_str());
+		}
+		this->m_mapped_arrays.erase(this->m_mapped_arrays.begin() + (i - 1));
+	}
+}
@@ -0,0 +1,160 @@
+#include "sandbox_pool.h"
+
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/core/class_db.hpp>
+
+void SandboxPool::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("acquire"), &SandboxPool::acquire);
+	ClassDB::bind_method(D_METHOD("release", "sandbox"), &SandboxPool::release);
+	ClassDB::bind_method(D_METHOD("get_available"), &SandboxPool::get_available);
+
+	ClassDB::bind_method(D_METHOD("set_program", "program"), &SandboxPool::set_program);
+	ClassDB::bind_method(D_METHOD("get_program"), &SandboxPool::get_program);
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "program", PROPERTY_HINT_RESOURCE_TYPE, "ELFScript"), "set_program", "get_program");
+
+	ClassDB::bind_method(D_METHOD("set_pool_size", "size"), &SandboxPool::set_pool_size);
+	ClassDB::bind_method(D_METHOD("get_pool_size"), &SandboxPool::get_pool_size);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "pool_size", PROPERTY_HINT_RANGE, "0,1024,1"), "set_pool_size", "get_pool_size");
+
+	// Group for monitored pool health.
+	ADD_GROUP("Pool Monitoring", "monitor_");
+
+	ClassDB::bind_method(D_METHOD("get_hit_rate"), &SandboxPool::get_hit_rate);
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "monitor_hit_rate", PROPERTY_HINT_NONE, "Fraction of acquires served from the pool", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_hit_rate");
+
+	ClassDB::bind_method(D_METHOD("get_restore_time"), &SandboxPool::get_restore_time);
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "monitor_restore_time", PROPERTY_HINT_NONE, "Average restore time in microseconds", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_restore_time");
+
+	ClassDB::bind_method(D_METHOD("get_dirty_pages"), &SandboxPool::get_dirty_pages);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "monitor_dirty_pages", PROPERTY_HINT_NONE, "Pages restored by the last release", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_dirty_pages");
+
+	ClassDB::bind_method(D_METHOD("get_dirty_pages_total"), &SandboxPool::get_dirty_pages_total);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "monitor_dirty_pages_total", PROPERTY_HINT_NONE, "Pages restored by all releases", PROPERTY_USAGE_EDITOR | PROPERTY_USAGE_READ_ONLY), "", "get_dirty_pages_total");
+}
+
+SandboxPool::~SandboxPool() {
+	this->clear();
+}
+
+void SandboxPool::clear() {
+	for (Sandbox *sandbox : m_idle) {
+		memdelete(sandbox);
+	}
+	m_idle.clear();
+	m_snapshot = nullptr;
+	if (m_template != nullptr) {
+		// Sandboxes still out there keep running: forks hold on to what they need.
+		memdelete(m_template);
+		m_template = nullptr;
+	}
+}
+
+void SandboxPool::set_program(Ref<ELFScript> program) {
+	if (program == m_program) {
+		return;
+	}
+	this->clear();
+	m_program = program;
+	m_hits = m_misses = m_restores = 0;
+	m_restore_usec_total = 0;
+	m_last_dirty_pages = m_dirty_pages_total = 0;
+	this->fill();
+}
+
+void SandboxPool::fill() {
+	if (m_program.is_null()) {
+		return;
+	}
+	// Fill the pool up front, so that the first acquires are hits.
+	while (int(m_idle.size()) < m_pool_size) {
+		Sandbox *sandbox = this->create_instance();
+		if (sandbox == nullptr)
+			break;
+		m_idle.push_back(sandbox);
+	}
+}
+
+void SandboxPool::set_pool_size(int size) {
+	m_pool_size = std::max(0, size);
+	while (int(m_idle.size()) > m_pool_size) {
+		memdelete(m_idle.back());
+		m_idle.pop_back();
+	}
+	this->fill();
+}
+
+bool SandboxPool::ensure_template() {
+	if (m_template != nullptr) {
+		return true;
+	}
+	if (m_program.is_null()) {
+		ERR_PRINT("SandboxPool: No program set.");
+		return false;
+	}
+	m_template = Sandbox::FromProgram(m_program);
+	if (!m_template->has_program_loaded()) {
+		memdelete(m_template);
+		m_template = nullptr;
+		return false;
+	}
+	m_snapshot = m_template->create_snapshot();
+	return m_snapshot != nullptr;
+}
+
+Sandbox *SandboxPool::create_instance() {
+	if (!this->ensure_template()) {
+		return nullptr;
+	}
+	Sandbox *sandbox = memnew(Sandbox);
+	if (!sandbox->fork_from(m_template)) {
+		memdelete(sandbox);
+		return nullptr;
+	}
+	return sandbox;
+}
+
+Sandbox *SandboxPool::acquire() {
+	if (!m_idle.empty()) {
+		m_hits++;
+		Sandbox *sandbox = m_idle.back();
+		m_idle.pop_back();
+		return sandbox;
+	}
+	m_misses++;
+	return this->create_instance();
+}
+
+void SandboxPool::release(Sandbox *sandbox) {
+	if (sandbox == nullptr) {
+		return;
+	}
+	if (sandbox->get_parent() != nullptr) {
+		sandbox->get_parent()->remove_child(sandbox);
+	}
+	if (int(m_idle.size()) >= m_pool_size || m_snapshot == nullptr || sandbox->get_program() != m_program) {
+		memdelete(sandbox);
+		return;
+	}
+
+	const uint64_t t0 = Time::get_singleton()->get_ticks_usec();
+	const int64_t dirty_pages = sandbox->restore_snapshot(*m_snapshot);
+	const uint64_t t1 = Time::get_singleton()->get_ticks_usec();
+	if (dirty_pages < 0) {
+		memdelete(sandbox);
+		return;
+	}
+	m_restores++;
+	m_restore_usec_total += t1 - t0;
+	m_last_dirty_pages = dirty_pages;
+	m_dirty_pages_total += dirty_pages;
+	m_idle.push_back(sandbox);
+}
+
+double SandboxPool::get_hit_rate() const {
+	const uint64_t total = m_hits + m_misses;
+	return total > 0 ? double(m_hits) / double(total) : 0.0;
+}
+
+double SandboxPool::get_restore_time() const {
+	return m_restores > 0 ? double(m_restore_usec_total) / double(m_restores) : 0.0;
+}
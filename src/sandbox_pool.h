@@ -0,0 +1,76 @@
+#pragma once
+
+#include "sandbox.h"
+#include <godot_cpp/classes/resource.hpp>
+
+/**
+ * @brief A pool of ready-to-use Sandbox instances running the same program.
+ *
+ * Loading a program means parsing the ELF and running it through main(), which is far
+ * too slow for sandboxes that only live for a moment. The pool keeps instances that were
+ * forked from one initialized template, and hands them out on acquire(). On release() an
+ * instance is put back into its state right after main() by restoring only the guest pages
+ * and registers that changed, instead of being torn down and loaded again.
+ **/
+class SandboxPool : public Resource {
+	GDCLASS(SandboxPool, Resource);
+
+protected:
+	static void _bind_methods();
+
+public:
+	static constexpr unsigned DEFAULT_POOL_SIZE = 8;
+
+	SandboxPool() {}
+	~SandboxPool();
+
+	/// @brief Set the program every sandbox in the pool runs. Frees all idle sandboxes.
+	void set_program(Ref<ELFScript> program);
+	Ref<ELFScript> get_program() const { return m_program; }
+
+	/// @brief Set the number of idle sandboxes the pool keeps ready.
+	void set_pool_size(int size);
+	int get_pool_size() const { return m_pool_size; }
+
+	/// @brief Take a sandbox out of the pool, creating one if the pool is empty.
+	/// @return The sandbox, now owned by the caller until it is released.
+	Sandbox *acquire();
+
+	/// @brief Return a sandbox to the pool, restoring it to its state after main().
+	/// @param sandbox A sandbox acquired from this pool. It is removed from the scene
+	/// tree, and freed instead when the pool is already full.
+	void release(Sandbox *sandbox);
+
+	/// @brief Number of sandboxes ready to be acquired.
+	int get_available() const { return int(m_idle.size()); }
+
+	/// @brief Fraction of acquire() calls that did not have to create a sandbox.
+	double get_hit_rate() const;
+	/// @brief Average time a release() spent restoring a sandbox, in microseconds.
+	double get_restore_time() const;
+	/// @brief Number of guest pages the last release() had to restore.
+	int64_t get_dirty_pages() const { return m_last_dirty_pages; }
+	/// @brief Number of guest pages restored by all releases so far.
+	int64_t get_dirty_pages_total() const { return m_dirty_pages_total; }
+
+private:
+	Sandbox *create_instance();
+	bool ensure_template();
+	void fill();
+	void clear();
+
+	Ref<ELFScript> m_program;
+	int m_pool_size = DEFAULT_POOL_SIZE;
+	// Initialized once, never called into, and forked from by every pooled instance.
+	Sandbox *m_template = nullptr;
+	std::shared_ptr<const Sandbox::Snapshot> m_snapshot;
+	std::vector<Sandbox *> m_idle;
+
+	// Stats
+	uint64_t m_hits = 0;
+	uint64_t m_misses = 0;
+	uint64_t m_restores = 0;
+	uint64_t m_restore_usec_total = 0;
+	int64_t m_last_dirty_pages = 0;
+	int64_t m_dirty_pages_total = 0;
+};
@@ -34,6 +34,11 @@ static constexpr char METHOD_ARGUMENTS_HINT[] = "Generate method arguments for t
 static constexpr char GENAPI_SKIPPED_CLASSES[] = "editor/script/generated_api_skipped_classes";
 static constexpr char GENAPI_SKIPPED_CLASSES_HINT[] = "Matching classes to skip when generating the run-time API";
 
+static constexpr char BINTR_CACHE[] = "editor/script/binary_translation_cache";
+static constexpr char BINTR_CACHE_HINT[] = "Compile binary translations of programs in the background, and load them from user:// in later runs. Runs native code from user://";
+static constexpr char BINTR_COMPILER[] = "editor/script/binary_translation_compiler";
+static constexpr char BINTR_COMPILER_HINT[] = "C compiler for the binary translation cache";
+
 static constexpr char PROGRAM_LIBRARIES[] = "editor/script/program_libraries";
 static constexpr char PROGRAM_LIBRARIES_HINT[] = "Custom libraries for downloadable Sandbox programs";
 
@@ -103,6 +108,9 @@ void SandboxProjectSettings::register_settings() {
 	skipped_classes.push_back("OS");
 	register_setting_plain(GENAPI_SKIPPED_CLASSES, skipped_classes, GENAPI_SKIPPED_CLASSES_HINT, false);
 
+	register_setting_plain(BINTR_CACHE, false, BINTR_CACHE_HINT, false);
+	register_setting_plain(BINTR_COMPILER, "cc", BINTR_COMPILER_HINT, false);
+
 	Dictionary libraries;
 	libraries["godot-sandbox-programs"] = "libriscv/godot-sandbox-programs";
 	register_setting_plain(PROGRAM_LIBRARIES, libraries, PROGRAM_LIBRARIES_HINT, false);
@@ -177,3 +185,11 @@ Array SandboxProjectSettings::generated_api_skipped_classes() {
 Dictionary SandboxProjectSettings::get_program_libraries() {
 	return get_setting<Dictionary>(PROGRAM_LIBRARIES);
 }
+
+bool SandboxProjectSettings::binary_translation_cache() {
+	return get_setting<bool>(BINTR_CACHE);
+}
+
+String SandboxProjectSettings::get_binary_translation_compiler() {
+	return get_setting<String>(BINTR_COMPILER);
+}
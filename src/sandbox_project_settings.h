@@ -30,4 +30,7 @@ public:
 	static Array generated_api_skipped_classes();
 
 	static Dictionary get_program_libraries();
+
+	static bool binary_translation_cache();
+	static String get_binary_translation_compiler();
 };
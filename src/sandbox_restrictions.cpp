@@ -104,6 +104,20 @@ godot::Object *Sandbox::get_explicitly_allowed_object(uintptr_t engine_object) c
 	return nullptr;
 }
 
+uint64_t Sandbox::get_object_id_from_handle(uintptr_t engine_object) const {
+	if (engine_object == 0)
+		return 0;
+	if (is_scoped_object(engine_object)) {
+		// Scoped objects are held by the call, so the pointer is still good.
+		return internal::gdextension_interface_object_get_instance_id(reinterpret_cast<GDExtensionConstObjectPtr>(engine_object));
+	}
+	for (const auto &[id, ptr] : m_allowed_objects) {
+		if (ptr == engine_object)
+			return id;
+	}
+	return 0;
+}
+
 void Sandbox::set_object_allowed_callback(const Callable &callback) {
 	if (is_in_vmcall()) {
 		ERR_PRINT("Cannot set object allowed callback during a VM call.");
@@ -0,0 +1,918 @@
+#include "sandbox.h"
+
+#include "dirty_pages.h"
+#include "mapped_file.h"
+#include "page_memory.h"
+#include <cstring>
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/classes/resource_loader.hpp>
+#include <godot_cpp/classes/time.hpp>
+#include <godot_cpp/templates/hashfuncs.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+#include <libriscv/native_heap.hpp>
+
+static constexpr size_t SNAPSHOT_PAGE_SIZE = riscv::Page::size();
+static const uint8_t zero_page[SNAPSHOT_PAGE_SIZE] = {};
+
+struct Sandbox::Snapshot {
+	static constexpr uint32_t ZERO_PAGE = UINT32_MAX;
+
+	gaddr_t arena_size = 0;
+	// Page number -> offset of its copy in page_data, or ZERO_PAGE.
+	// Most of a freshly initialized arena is untouched heap, so zeroed pages are
+	// remembered as such instead of being copied.
+	std::vector<uint32_t> page_index;
+	std::vector<uint8_t> page_data;
+
+	riscv::Registers<RISCV_ARCH> registers;
+	gaddr_t mmap_address = 0;
+	std::unique_ptr<riscv::Arena> heap;
+	CurrentState permanent;
+
+	const uint8_t *page(size_t index) const noexcept {
+		const uint32_t offset = page_index[index];
+		return offset == ZERO_PAGE ? zero_page : &page_data[offset];
+	}
+};
+
+// The guest as it was at the last checkpoint(). Only the state outside of guest memory is
+// kept, as long as the pages that are written to can be tracked. Otherwise the snapshot
+// holds every page, and rolling back compares all of them.
+struct Sandbox::Checkpoint {
+	std::unique_ptr<DirtyPageTracker> pages;
+	Snapshot state;
+	// Unique to each checkpoint() in the process, so that states saved against one are
+	// never applied against another, see save_state().
+	uint64_t id = 0;
+};
+static std::atomic<uint64_t> checkpoint_ids = 0;
+
+// The guest pages of an anonymous arena that the system has never backed, in memory or in
+// swap, and so read as zero without looking. Reading them anyway would have the system map
+// them, which for a large arena the guest barely uses is most of it. Empty when that
+// cannot be told.
+static std::vector<bool> untouched_pages(const machine_t &m, bool anonymous) {
+	std::vector<bool> untouched;
+	std::vector<bool> unbacked;
+	if (!anonymous || !unbacked_pages(m.memory.memory_arena_ptr(), m.memory.memory_arena_size(), unbacked)) {
+		return untouched;
+	}
+	const size_t pages = m.memory.memory_arena_size() / SNAPSHOT_PAGE_SIZE;
+	untouched.resize(pages);
+	for (size_t i = 0; i < pages; i++) {
+		untouched[i] = unbacked[i * SNAPSHOT_PAGE_SIZE / host_page_size()];
+	}
+	return untouched;
+}
+
+static void capture_pages(Sandbox::Snapshot &snapshot, const machine_t &m, bool anonymous) {
+	const uint8_t *arena = (const uint8_t *)m.memory.memory_arena_ptr();
+	const size_t pages = m.memory.memory_arena_size() / SNAPSHOT_PAGE_SIZE;
+	const std::vector<bool> untouched = untouched_pages(m, anonymous);
+	snapshot.page_index.resize(pages);
+	for (size_t i = 0; i < pages; i++) {
+		const uint8_t *src = &arena[i * SNAPSHOT_PAGE_SIZE];
+		if ((!untouched.empty() && untouched[i]) || std::memcmp(src, zero_page, SNAPSHOT_PAGE_SIZE) == 0) {
+			snapshot.page_index[i] = Sandbox::Snapshot::ZERO_PAGE;
+		} else {
+			snapshot.page_index[i] = snapshot.page_data.size();
+			snapshot.page_data.insert(snapshot.page_data.end(), src, src + SNAPSHOT_PAGE_SIZE);
+		}
+	}
+}
+
+// release: Whether pages that go back to zero may be given back to the system. Not while
+// a DirtyPageTracker watches the arena, as giving a page back is not a write it can catch,
+// and rolling back would then leave the page zeroed.
+static int64_t restore_pages(const Sandbox::Snapshot &snapshot, machine_t &m, bool anonymous, bool release) {
+	// Comparing is far cheaper than copying, and on a sandbox that has been
+	// running for a while only a small part of the arena is ever written to.
+	// Pages that go back to zero are given back to the system, so that a sandbox only
+	// holds on to the memory it used since the snapshot until it is restored.
+	uint8_t *arena = (uint8_t *)m.memory.memory_arena_ptr();
+	const std::vector<bool> untouched = untouched_pages(m, anonymous);
+	int64_t dirty_pages = 0;
+	size_t zero_begin = 0;
+	size_t zero_length = 0;
+	for (size_t i = 0; i < snapshot.page_index.size(); i++) {
+		const bool zero = snapshot.page_index[i] == Sandbox::Snapshot::ZERO_PAGE;
+		if (zero && !untouched.empty() && untouched[i]) {
+			continue;
+		}
+		uint8_t *dst = &arena[i * SNAPSHOT_PAGE_SIZE];
+		const uint8_t *src = snapshot.page(i);
+		if (std::memcmp(dst, src, SNAPSHOT_PAGE_SIZE) == 0) {
+			continue;
+		}
+		dirty_pages++;
+		if (zero && anonymous && release) {
+			if (zero_length != 0 && zero_begin + zero_length == i) {
+				zero_length++;
+				continue;
+			}
+			if (zero_length != 0) {
+				zero_pages(&arena[zero_begin * SNAPSHOT_PAGE_SIZE], zero_length * SNAPSHOT_PAGE_SIZE);
+			}
+			zero_begin = i;
+			zero_length = 1;
+		} else {
+			std::memcpy(dst, src, SNAPSHOT_PAGE_SIZE);
+		}
+	}
+	if (zero_length != 0) {
+		zero_pages(&arena[zero_begin * SNAPSHOT_PAGE_SIZE], zero_length * SNAPSHOT_PAGE_SIZE);
+	}
+	return dirty_pages;
+}
+
+std::shared_ptr<const Sandbox::Snapshot> Sandbox::create_snapshot() const {
+	if (!this->has_program_loaded() || this->is_in_vmcall()) {
+		ERR_PRINT("Sandbox: Cannot snapshot without a program, or during a VM call.");
+		return nullptr;
+	}
+	const machine_t &m = machine();
+	auto snapshot = std::make_shared<Snapshot>();
+
+	snapshot->arena_size = m.memory.memory_arena_size();
+	capture_pages(*snapshot, m, !this->m_arena_from_file);
+	this->capture_state(*snapshot);
+	return snapshot;
+}
+
+int64_t Sandbox::restore_snapshot(const Snapshot &snapshot) {
+	if (this->is_in_vmcall()) {
+		ERR_PRINT("Sandbox: Cannot restore a snapshot during a VM call.");
+		return -1;
+	}
+	machine_t &m = machine();
+	if (!this->has_program_loaded() || m.memory.memory_arena_size() != snapshot.arena_size) {
+		ERR_PRINT("Sandbox: Snapshot does not match the loaded program.");
+		return -1;
+	}
+
+	this->m_state_generation++;
+	const bool tracked = this->m_checkpoint != nullptr && this->m_checkpoint->pages != nullptr;
+	const int64_t dirty_pages = restore_pages(snapshot, m, !this->m_arena_from_file, !tracked);
+	this->apply_state(snapshot);
+	return dirty_pages;
+}
+
+void Sandbox::capture_state(Snapshot &snapshot) const {
+	const machine_t &m = machine();
+	snapshot.registers = m.cpu.registers();
+	snapshot.mmap_address = m.memory.mmap_address();
+	if (m.has_arena()) {
+		snapshot.heap = std::make_unique<riscv::Arena>(this->m_heap_area, this->m_heap_area + this->m_heap_size);
+		m.arena().transfer(*snapshot.heap);
+	}
+	snapshot.permanent.copy_from(this->m_states[0]);
+}
+
+void Sandbox::apply_state(const Snapshot &snapshot) {
+	machine_t &m = machine();
+	m.cpu.registers() = snapshot.registers;
+	m.memory.mmap_address() = snapshot.mmap_address;
+	if (snapshot.heap != nullptr && m.has_arena()) {
+		snapshot.heap->transfer(m.arena());
+		m.arena().set_max_chunks(get_allocations_max());
+	}
+	this->m_states[0].copy_from(snapshot.permanent);
+}
+
+bool Sandbox::checkpoint() {
+	if (!this->has_program_loaded() || this->is_in_vmcall()) {
+		ERR_PRINT("Sandbox: Cannot make a checkpoint without a program, or during a VM call.");
+		return false;
+	}
+	machine_t &m = machine();
+	if (this->m_checkpoint == nullptr) {
+		auto checkpoint = std::make_shared<Checkpoint>();
+		checkpoint->pages = DirtyPageTracker::start((uint8_t *)m.memory.memory_arena_ptr(), m.memory.memory_arena_size(), !this->m_arena_from_file);
+		checkpoint->state.arena_size = m.memory.memory_arena_size();
+		this->m_checkpoint = std::move(checkpoint);
+	} else if (this->m_checkpoint->pages != nullptr) {
+		this->m_checkpoint->pages->forget();
+	}
+	Checkpoint &checkpoint = *this->m_checkpoint;
+	if (checkpoint.pages == nullptr) {
+		checkpoint.state.page_index.clear();
+		checkpoint.state.page_data.clear();
+		capture_pages(checkpoint.state, m, !this->m_arena_from_file);
+	}
+	this->capture_state(checkpoint.state);
+	checkpoint.id = ++checkpoint_ids;
+	return true;
+}
+
+int64_t Sandbox::rollback() {
+	if (this->is_in_vmcall()) {
+		ERR_PRINT("Sandbox: Cannot roll back during a VM call.");
+		return -1;
+	}
+	if (this->m_checkpoint == nullptr) {
+		ERR_PRINT("Sandbox: There is no checkpoint to roll back to.");
+		return -1;
+	}
+	Checkpoint &checkpoint = *this->m_checkpoint;
+	this->m_state_generation++;
+	int64_t dirty_pages;
+	if (checkpoint.pages != nullptr) {
+		// Tracked pages are host pages, which may hold several guest pages each.
+		dirty_pages = checkpoint.pages->restore() * (DirtyPageTracker::page_size() / SNAPSHOT_PAGE_SIZE);
+	} else {
+		dirty_pages = restore_pages(checkpoint.state, machine(), !this->m_arena_from_file, true);
+	}
+	this->apply_state(checkpoint.state);
+	return dirty_pages;
+}
+
+/**
+ * Snapshot files, see save_snapshot() and load_snapshot().
+ *
+ * [header][page index][padding][page data][machine state][sandbox state]
+ *
+ * The page data holds every non-zero page of the flat arena, in arena order and aligned
+ * to SNAPSHOT_FILE_ALIGNMENT, so that runs of it can be mapped straight over the arena.
+ * The machine state is whatever libriscv serializes outside of the arena: registers,
+ * counters, the mmap address and the native heap. The sandbox state is a Dictionary
+ * encoded with var_to_bytes(). Everything is in host byte order: a snapshot is made for,
+ * and shipped with, one build of one program.
+ **/
+static constexpr char SNAPSHOT_FILE_MAGIC[8] = { 'G', 'D', 'S', 'N', 'A', 'P', 'S', 'H' };
+static constexpr uint32_t SNAPSHOT_FILE_VERSION = 1;
+// The largest host page size in common use (arm64 Linux with 64k pages).
+static constexpr uint64_t SNAPSHOT_FILE_ALIGNMENT = 65536;
+
+struct SnapshotFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t page_size;
+	uint32_t arch_width;
+	uint32_t program_hash;
+	uint64_t program_size;
+	uint32_t memory_max;
+	uint32_t allocations_max;
+	uint64_t arena_size;
+	uint64_t heap_area;
+	uint64_t heap_size;
+	// One uint32_t per arena page: its index in the page data, or ZERO_PAGE.
+	uint64_t page_index_offset;
+	uint64_t page_data_offset;
+	uint64_t page_data_count;
+	uint64_t machine_state_offset;
+	uint64_t machine_state_size;
+	uint64_t sandbox_state_offset;
+	uint64_t sandbox_state_size;
+};
+static_assert(std::is_trivially_copyable_v<SnapshotFileHeader>);
+
+static uint32_t snapshot_program_hash(std::string_view program) {
+	return hash_murmur3_buffer(program.data(), program.size());
+}
+
+// Permanent Variants are saved by value, with the slots the guest knows them by.
+// Objects only live as long as the process, and cannot be saved.
+static void save_permanent_variants(const Sandbox::CurrentState &permanent, Dictionary &state) {
+	Array variants;
+	for (const Variant &var : permanent.variants) {
+		variants.push_back(var);
+	}
+	PackedInt64Array slots;
+	Array external;
+	for (const Variant *var : permanent.scoped_variants) {
+		if (permanent.is_mutable_variant(*var)) {
+			slots.push_back(var - permanent.variants.data());
+		} else {
+			slots.push_back(-1);
+			external.push_back(*var);
+		}
+	}
+	PackedInt32Array generations;
+	for (uint16_t generation : permanent.generations) {
+		generations.push_back(generation);
+	}
+	PackedInt32Array free_slots;
+	for (uint32_t slot : permanent.free_slots) {
+		free_slots.push_back(slot);
+	}
+	state["variants"] = variants;
+	state["slots"] = slots;
+	state["external"] = external;
+	state["generations"] = generations;
+	state["free_slots"] = free_slots;
+}
+
+// Permanent Variants, resolving to the same slots as when they were saved.
+static void load_permanent_variants(Sandbox::CurrentState &permanent, const Dictionary &state, size_t max_refs) {
+	const Array variants = state.get("variants", Array());
+	const PackedInt64Array slots = state.get("slots", PackedInt64Array());
+	const Array external = state.get("external", Array());
+	permanent.variants.reserve(std::max<size_t>(max_refs, variants.size() + external.size()));
+	for (int i = 0; i < variants.size(); i++) {
+		permanent.variants.push_back(variants[i]);
+	}
+	int next_external = 0;
+	for (int i = 0; i < slots.size(); i++) {
+		int64_t index = slots[i];
+		if (index < 0 || index >= variants.size()) {
+			// No longer shared with anything, so it becomes a Variant of our own.
+			index = permanent.variants.size();
+			permanent.variants.push_back(external.size() > next_external ? external[next_external] : Variant());
+			next_external++;
+		}
+		permanent.scoped_variants.push_back(&permanent.variants[index]);
+	}
+	// Older saves have neither, as nothing was ever released back then.
+	const PackedInt32Array generations = state.get("generations", PackedInt32Array());
+	const PackedInt32Array free_slots = state.get("free_slots", PackedInt32Array());
+	for (int i = 0; i < generations.size() && i < slots.size(); i++) {
+		permanent.generations.push_back(uint16_t(generations[i]));
+	}
+	for (int i = 0; i < free_slots.size(); i++) {
+		const uint32_t slot = free_slots[i];
+		// Each free slot once, or two Variants would end up sharing it.
+		if (slot < permanent.generations.size() && (permanent.generations[slot] & Sandbox::PERMANENT_SLOT_RELEASED) &&
+				std::find(permanent.free_slots.begin(), permanent.free_slots.end(), slot) == permanent.free_slots.end()) {
+			permanent.free_slots.push_back(slot);
+		}
+	}
+}
+
+bool Sandbox::save_snapshot(const String &path) const {
+	if (!this->has_program_loaded() || this->is_in_vmcall()) {
+		ERR_PRINT("Sandbox: Cannot save a snapshot without a program, or during a VM call.");
+		return false;
+	}
+	const machine_t &m = machine();
+	const std::string_view program = this->program_view();
+
+	std::vector<uint8_t> machine_state;
+	try {
+		m.serialize_to(machine_state);
+	} catch (const std::exception &e) {
+		ERR_PRINT(("Sandbox snapshot exception: " + std::string(e.what())).c_str());
+		return false;
+	}
+
+	Array properties;
+	for (const SandboxProperty &prop : this->m_properties) {
+		Dictionary property;
+		property["name"] = prop.name();
+		property["type"] = prop.type();
+		property["setter"] = prop.setter_address();
+		property["getter"] = prop.getter_address();
+		property["address"] = prop.guest_variant_address();
+		property["default"] = prop.default_value();
+		properties.push_back(property);
+	}
+	Dictionary state;
+	state["program"] = this->m_program_data.is_valid() ? this->m_program_data->get_path() : String();
+	save_permanent_variants(this->m_states[0], state);
+	state["properties"] = properties;
+	state["public_api"] = this->m_public_api_functions;
+	state["command_buffer"] = int64_t(this->m_command_buffer);
+	const PackedByteArray sandbox_state = UtilityFunctions::var_to_bytes(state);
+
+	SnapshotFileHeader header{};
+	std::memcpy(header.magic, SNAPSHOT_FILE_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_FILE_VERSION;
+	header.page_size = SNAPSHOT_PAGE_SIZE;
+	header.arch_width = RISCV_ARCH;
+	header.program_hash = snapshot_program_hash(program);
+	header.program_size = program.size();
+	header.memory_max = this->m_memory_max;
+	header.allocations_max = this->m_allocations_max;
+	header.arena_size = m.memory.memory_arena_size();
+	header.heap_area = this->m_heap_area;
+	header.heap_size = this->m_heap_size;
+
+	const uint8_t *arena = (const uint8_t *)m.memory.memory_arena_ptr();
+	const size_t pages = header.arena_size / SNAPSHOT_PAGE_SIZE;
+	std::vector<uint32_t> page_index(pages);
+	for (size_t i = 0; i < pages; i++) {
+		if (std::memcmp(&arena[i * SNAPSHOT_PAGE_SIZE], zero_page, SNAPSHOT_PAGE_SIZE) == 0) {
+			page_index[i] = Snapshot::ZERO_PAGE;
+		} else {
+			page_index[i] = header.page_data_count++;
+		}
+	}
+	header.page_index_offset = sizeof(header);
+	const uint64_t page_index_end = header.page_index_offset + pages * sizeof(uint32_t);
+	header.page_data_offset = (page_index_end + SNAPSHOT_FILE_ALIGNMENT - 1) & ~(SNAPSHOT_FILE_ALIGNMENT - 1);
+	header.machine_state_offset = header.page_data_offset + header.page_data_count * SNAPSHOT_PAGE_SIZE;
+	header.machine_state_size = machine_state.size();
+	header.sandbox_state_offset = header.machine_state_offset + header.machine_state_size;
+	header.sandbox_state_size = sandbox_state.size();
+
+	PackedByteArray file_data;
+	file_data.resize(header.sandbox_state_offset + header.sandbox_state_size);
+	uint8_t *dst = file_data.ptrw();
+	std::memset(dst, 0, header.page_data_offset);
+	std::memcpy(dst, &header, sizeof(header));
+	std::memcpy(dst + header.page_index_offset, page_index.data(), pages * sizeof(uint32_t));
+	for (size_t i = 0; i < pages; i++) {
+		if (page_index[i] != Snapshot::ZERO_PAGE) {
+			std::memcpy(dst + header.page_data_offset + uint64_t(page_index[i]) * SNAPSHOT_PAGE_SIZE, &arena[i * SNAPSHOT_PAGE_SIZE], SNAPSHOT_PAGE_SIZE);
+		}
+	}
+	std::memcpy(dst + header.machine_state_offset, machine_state.data(), machine_state.size());
+	std::memcpy(dst + header.sandbox_state_offset, sandbox_state.ptr(), sandbox_state.size());
+
+	Ref<FileAccess> fa = FileAccess::open(path, FileAccess::ModeFlags::WRITE);
+	if (fa == nullptr || !fa->is_open()) {
+		ERR_PRINT("Sandbox: Failed to open snapshot file for writing: " + path);
+		return false;
+	}
+	fa->store_buffer(file_data);
+	fa->close();
+	return true;
+}
+
+bool Sandbox::load_snapshot(const String &path) {
+	if (this->is_in_vmcall()) {
+		ERR_PRINT("Cannot load a snapshot while a VM call is in progress.");
+		return false;
+	}
+	const uint64_t load_t0 = Time::get_singleton()->get_ticks_usec();
+
+	std::unique_ptr<MappedFile> file = MappedFile::open(path);
+	if (file == nullptr) {
+		ERR_PRINT("Sandbox: Failed to open snapshot file: " + path);
+		return false;
+	}
+	SnapshotFileHeader header;
+	if (file->size() < sizeof(header)) {
+		ERR_PRINT("Sandbox: Not a snapshot file: " + path);
+		return false;
+	}
+	std::memcpy(&header, file->data(), sizeof(header));
+	if (std::memcmp(header.magic, SNAPSHOT_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_FILE_VERSION) {
+		ERR_PRINT("Sandbox: Not a snapshot file, or one from another version: " + path);
+		return false;
+	}
+	const uint64_t pages = header.arena_size / SNAPSHOT_PAGE_SIZE;
+	if (header.page_size != SNAPSHOT_PAGE_SIZE || header.arch_width != RISCV_ARCH
+			|| header.page_index_offset + pages * sizeof(uint32_t) > file->size()
+			|| header.page_data_offset + header.page_data_count * SNAPSHOT_PAGE_SIZE > file->size()
+			|| header.machine_state_offset + header.machine_state_size > file->size()
+			|| header.sandbox_state_offset + header.sandbox_state_size > file->size()) {
+		ERR_PRINT("Sandbox: Snapshot file is damaged, or was made by a different build: " + path);
+		return false;
+	}
+
+	PackedByteArray sandbox_state_bytes;
+	sandbox_state_bytes.resize(header.sandbox_state_size);
+	std::memcpy(sandbox_state_bytes.ptrw(), file->data() + header.sandbox_state_offset, header.sandbox_state_size);
+	const Dictionary state = UtilityFunctions::bytes_to_var(sandbox_state_bytes);
+
+	// The snapshot starts from the program that was loaded when it was saved. Without a
+	// program of our own, that one is loaded, just not run.
+	if (this->m_program_data.is_null() && this->m_program_bytes.is_empty()) {
+		const String program_path = state.get("program", String());
+		if (!program_path.is_empty()) {
+			this->set_program_data_internal(ResourceLoader::get_singleton()->load(program_path));
+		}
+	}
+	const std::string_view program = this->program_view();
+	if (program.empty() || uint64_t(program.size()) != header.program_size || snapshot_program_hash(program) != header.program_hash) {
+		ERR_PRINT("Sandbox: Snapshot was made from a different program: " + path);
+		return false;
+	}
+
+	// The arena size follows from the memory limit, and must match page for page.
+	this->m_memory_max = header.memory_max;
+	this->m_allocations_max = header.allocations_max;
+	this->m_heap_area = header.heap_area;
+	this->m_heap_size = header.heap_size;
+	this->full_reset();
+	this->m_state_generation++;
+
+	try {
+		this->create_machine(program);
+		this->install_machine_callbacks();
+
+		machine_t &m = machine();
+		if (m.memory.memory_arena_size() != header.arena_size) {
+			throw std::runtime_error("Guest arena size does not match the snapshot");
+		}
+		m.setup_native_heap(HEAP_SYSCALLS_BASE, header.heap_area, header.heap_size);
+		m.setup_native_memory(MEMORY_SYSCALLS_BASE);
+
+		const uint8_t *machine_state = file->data() + header.machine_state_offset;
+		if (m.deserialize_from(std::vector<uint8_t>(machine_state, machine_state + header.machine_state_size)) < 0) {
+			throw std::runtime_error("Failed to restore machine state from the snapshot");
+		}
+		m.arena().set_max_chunks(get_allocations_max());
+
+		// Map runs of saved pages over the arena, so that they are only read from disk when
+		// the guest touches them. Where that is not possible, they are copied instead.
+		uint8_t *arena = (uint8_t *)m.memory.memory_arena_ptr();
+		const uint32_t *page_index = (const uint32_t *)(file->data() + header.page_index_offset);
+		for (uint64_t i = 0; i < pages;) {
+			uint8_t *dst = &arena[i * SNAPSHOT_PAGE_SIZE];
+			if (page_index[i] == Snapshot::ZERO_PAGE) {
+				// Fresh arenas are zeroed, except where the ELF loader just put the program.
+				if (std::memcmp(dst, zero_page, SNAPSHOT_PAGE_SIZE) != 0) {
+					std::memset(dst, 0, SNAPSHOT_PAGE_SIZE);
+				}
+				i++;
+				continue;
+			}
+			uint64_t run = 1;
+			while (i + run < pages && page_index[i + run] == page_index[i] + run) {
+				run++;
+			}
+			if (page_index[i] + run > header.page_data_count) {
+				throw std::runtime_error("Snapshot page index is out of range");
+			}
+			const uint64_t offset = header.page_data_offset + uint64_t(page_index[i]) * SNAPSHOT_PAGE_SIZE;
+			if (file->map_private(dst, run * SNAPSHOT_PAGE_SIZE, offset)) {
+				this->m_arena_from_file = true;
+			} else {
+				std::memcpy(dst, file->data() + offset, run * SNAPSHOT_PAGE_SIZE);
+			}
+			i += run;
+		}
+		this->find_guest_heap();
+	} catch (const std::exception &e) {
+		ERR_PRINT(("Sandbox snapshot exception: " + std::string(e.what())).c_str());
+		this->reset_machine();
+		return false;
+	}
+	if (this->m_program_data.is_valid()) {
+		this->m_source_version = this->m_program_data->get_source_version();
+	}
+
+	load_permanent_variants(this->m_states[0], state, this->m_max_refs);
+
+	const Array properties = state.get("properties", Array());
+	for (int i = 0; i < properties.size(); i++) {
+		const Dictionary property = properties[i];
+		const StringName name = property["name"];
+		const Variant::Type type = Variant::Type(int(property["type"]));
+		const uint64_t address = property["address"];
+		if (address != 0) {
+			this->m_properties.emplace_back(name, type, address, property["default"]);
+		} else {
+			this->m_properties.emplace_back(name, type, uint64_t(property["setter"]), uint64_t(property["getter"]), property["default"]);
+		}
+	}
+
+	this->m_public_api_functions = state.get("public_api", Array());
+	this->m_command_buffer = gaddr_t(int64_t(state.get("command_buffer", 0)));
+	for (int i = 0; i < this->m_public_api_functions.size(); i++) {
+		const Dictionary func = this->m_public_api_functions[i];
+		String name = func["name"];
+		const gaddr_t address = func.get("address", 0x0);
+		this->m_lookup.insert_or_assign(name.hash(), LookupEntry{ std::move(name), address });
+		this->add_call_stub(func);
+	}
+	if (this->m_program_data.is_valid() && !this->m_public_api_functions.is_empty()) {
+		this->m_program_data->set_public_api_functions(this->m_public_api_functions.duplicate());
+	}
+
+	const uint64_t load_t1 = Time::get_singleton()->get_ticks_usec();
+	m_accumulated_startup_time += (load_t1 - load_t0) / 1e6;
+	return true;
+}
+
+/**
+ * Saved states, see save_state() and restore_state().
+ *
+ * [header][machine state][permanent Variants][pages]
+ *
+ * A state only holds what differs from the checkpoint of the sandbox it was saved in, so
+ * that restoring one never depends on any other state. The machine state is whatever
+ * libriscv serializes outside of the arena, as in snapshot files. The permanent Variants
+ * are left out while they are the same as at the checkpoint, and otherwise encoded with
+ * var_to_bytes(). Each page that differs from the checkpoint is a page number, the size
+ * of its encoding, and then runs of 64-bit words: the number of unchanged words, the
+ * number of changed words, and the changed words XORed with the checkpoint. The end of
+ * a page is left unchanged.
+ **/
+static constexpr uint32_t STATE_MAGIC = 0x54534447; // "GDST"
+static constexpr uint32_t STATE_VERSION = 1;
+
+struct StateHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t checkpoint;
+	uint32_t page_size;
+	uint32_t page_count;
+	uint32_t machine_state_size;
+	uint32_t permanent_size;
+};
+static_assert(std::is_trivially_copyable_v<StateHeader>);
+
+struct StatePageHeader {
+	uint32_t page;
+	uint32_t size;
+};
+
+static inline uint64_t load_word(const uint8_t *src, size_t word) {
+	uint64_t value;
+	std::memcpy(&value, src + word * sizeof(uint64_t), sizeof(value));
+	return value;
+}
+
+// Append the difference between a page and the same page at the checkpoint.
+// Returns false when there is none. Host pages are at most 64 KiB, so that every
+// run of words fits in 16 bits.
+static bool encode_page(std::vector<uint8_t> &out, const uint8_t *page, const uint8_t *base, size_t page_size) {
+	const size_t words = page_size / sizeof(uint64_t);
+	const size_t begin = out.size();
+	size_t word = 0;
+	while (word < words) {
+		uint16_t same = 0;
+		while (word + same < words && load_word(page, word + same) == load_word(base, word + same)) {
+			same++;
+		}
+		if (word + same == words) {
+			break;
+		}
+		word += same;
+		uint16_t changed = 0;
+		while (word + changed < words && load_word(page, word + changed) != load_word(base, word + changed)) {
+			changed++;
+		}
+		const size_t offset = out.size();
+		out.resize(offset + 2 * sizeof(uint16_t) + changed * sizeof(uint64_t));
+		std::memcpy(&out[offset], &same, sizeof(same));
+		std::memcpy(&out[offset + sizeof(same)], &changed, sizeof(changed));
+		for (size_t i = 0; i < changed; i++) {
+			const uint64_t delta = load_word(page, word + i) ^ load_word(base, word + i);
+			std::memcpy(&out[offset + 2 * sizeof(uint16_t) + i * sizeof(uint64_t)], &delta, sizeof(delta));
+		}
+		word += changed;
+	}
+	return out.size() != begin;
+}
+
+// Check an encoded page before anything is written, so that a damaged state never
+// leaves guest memory half restored.
+static bool validate_page(std::span<const uint8_t> encoding, size_t page_size) {
+	const size_t words = page_size / sizeof(uint64_t);
+	const uint8_t *src = encoding.data();
+	const uint8_t *end = src + encoding.size();
+	size_t word = 0;
+	while (src < end) {
+		uint16_t same, changed;
+		if (size_t(end - src) < 2 * sizeof(uint16_t)) {
+			return false;
+		}
+		std::memcpy(&same, src, sizeof(same));
+		std::memcpy(&changed, src + sizeof(same), sizeof(changed));
+		src += 2 * sizeof(uint16_t);
+		word += size_t(same) + changed;
+		if (word > words || size_t(end - src) < changed * sizeof(uint64_t)) {
+			return false;
+		}
+		src += changed * sizeof(uint64_t);
+	}
+	return true;
+}
+
+// Rebuild a page from its state at the checkpoint and a validated encoding. The
+// checkpoint may be the page itself, when the page has not been written to since.
+static void decode_page(uint8_t *page, const uint8_t *base, std::span<const uint8_t> encoding, size_t page_size) {
+	const size_t words = page_size / sizeof(uint64_t);
+	const uint8_t *src = encoding.data();
+	const uint8_t *end = src + encoding.size();
+	size_t word = 0;
+	while (src < end) {
+		uint16_t same, changed;
+		std::memcpy(&same, src, sizeof(same));
+		std::memcpy(&changed, src + sizeof(same), sizeof(changed));
+		src += 2 * sizeof(uint16_t);
+		if (page != base) {
+			std::memcpy(page + word * sizeof(uint64_t), base + word * sizeof(uint64_t), same * sizeof(uint64_t));
+		}
+		word += same;
+		for (size_t i = 0; i < changed; i++, word++) {
+			const uint64_t value = load_word(base, word) ^ load_word(src, i);
+			std::memcpy(page + word * sizeof(uint64_t), &value, sizeof(value));
+		}
+		src += changed * sizeof(uint64_t);
+	}
+	if (page != base) {
+		std::memcpy(page + word * sizeof(uint64_t), base + word * sizeof(uint64_t), (words - word) * sizeof(uint64_t));
+	}
+}
+
+static bool same_permanent_variants(const Sandbox::CurrentState &a, const Sandbox::CurrentState &b) {
+	if (a.variants.size() != b.variants.size() || a.scoped_variants.size() != b.scoped_variants.size()) {
+		return false;
+	}
+	if (a.generations != b.generations || a.free_slots != b.free_slots) {
+		return false;
+	}
+	for (size_t i = 0; i < a.variants.size(); i++) {
+		if (a.variants[i] != b.variants[i]) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < a.scoped_variants.size(); i++) {
+		const Variant *va = a.scoped_variants[i];
+		const Variant *vb = b.scoped_variants[i];
+		const bool owned = a.is_mutable_variant(*va);
+		if (owned != b.is_mutable_variant(*vb)) {
+			return false;
+		}
+		if (owned ? (va - a.variants.data()) != (vb - b.variants.data()) : *va != *vb) {
+			return false;
+		}
+	}
+	return true;
+}
+
+PackedByteArray Sandbox::save_state() {
+	if (!this->has_program_loaded() || this->is_in_vmcall()) {
+		ERR_PRINT("Sandbox: Cannot save state without a program, or during a VM call.");
+		return PackedByteArray();
+	}
+	if (this->m_checkpoint == nullptr && !this->checkpoint()) {
+		return PackedByteArray();
+	}
+	const Checkpoint &checkpoint = *this->m_checkpoint;
+	const machine_t &m = machine();
+
+	std::vector<uint8_t> machine_state;
+	try {
+		m.serialize_to(machine_state);
+	} catch (const std::exception &e) {
+		ERR_PRINT(("Sandbox state exception: " + std::string(e.what())).c_str());
+		return PackedByteArray();
+	}
+	// Most frames leave the permanent Variants alone.
+	PackedByteArray permanent;
+	if (!same_permanent_variants(this->m_states[0], checkpoint.state.permanent)) {
+		Dictionary variants;
+		save_permanent_variants(this->m_states[0], variants);
+		permanent = UtilityFunctions::var_to_bytes(variants);
+	}
+
+	const uint8_t *arena = (const uint8_t *)m.memory.memory_arena_ptr();
+	std::vector<uint8_t> pages;
+	uint32_t page_count = 0;
+	auto add_page = [&](size_t page, const uint8_t *base, size_t page_size) {
+		const size_t offset = pages.size();
+		pages.resize(offset + sizeof(StatePageHeader));
+		if (encode_page(pages, arena + page * page_size, base, page_size)) {
+			const StatePageHeader record{ uint32_t(page), uint32_t(pages.size() - offset - sizeof(StatePageHeader)) };
+			std::memcpy(&pages[offset], &record, sizeof(record));
+			page_count++;
+		} else {
+			pages.resize(offset);
+		}
+	};
+	StateHeader header{};
+	if (checkpoint.pages != nullptr) {
+		// Only the pages written to since the checkpoint can differ from it.
+		header.page_size = DirtyPageTracker::page_size();
+		for (const uint32_t page : checkpoint.pages->written_pages()) {
+			add_page(page, checkpoint.pages->saved_page(page), header.page_size);
+		}
+	} else {
+		header.page_size = SNAPSHOT_PAGE_SIZE;
+		for (size_t i = 0; i < checkpoint.state.page_index.size(); i++) {
+			add_page(i, checkpoint.state.page(i), header.page_size);
+		}
+	}
+
+	header.magic = STATE_MAGIC;
+	header.version = STATE_VERSION;
+	header.checkpoint = checkpoint.id;
+	header.page_count = page_count;
+	header.machine_state_size = machine_state.size();
+	header.permanent_size = permanent.size();
+
+	PackedByteArray state;
+	state.resize(sizeof(header) + machine_state.size() + permanent.size() + pages.size());
+	uint8_t *dst = state.ptrw();
+	std::memcpy(dst, &header, sizeof(header));
+	dst += sizeof(header);
+	std::memcpy(dst, machine_state.data(), machine_state.size());
+	dst += machine_state.size();
+	std::memcpy(dst, permanent.ptr(), permanent.size());
+	dst += permanent.size();
+	std::memcpy(dst, pages.data(), pages.size());
+	return state;
+}
+
+bool Sandbox::restore_state(const PackedByteArray &state) {
+	if (this->is_in_vmcall()) {
+		ERR_PRINT("Sandbox: Cannot restore state during a VM call.");
+		return false;
+	}
+	StateHeader header;
+	if (size_t(state.size()) < sizeof(header)) {
+		ERR_PRINT("Sandbox: Not a saved state.");
+		return false;
+	}
+	std::memcpy(&header, state.ptr(), sizeof(header));
+	if (header.magic != STATE_MAGIC || header.version != STATE_VERSION) {
+		ERR_PRINT("Sandbox: Not a saved state.");
+		return false;
+	}
+	if (this->m_checkpoint == nullptr || header.checkpoint != this->m_checkpoint->id) {
+		ERR_PRINT("Sandbox: State was saved against another checkpoint.");
+		return false;
+	}
+	Checkpoint &checkpoint = *this->m_checkpoint;
+	machine_t &m = machine();
+	const size_t page_size = checkpoint.pages != nullptr ? DirtyPageTracker::page_size() : SNAPSHOT_PAGE_SIZE;
+	const size_t arena_pages = m.memory.memory_arena_size() / page_size;
+
+	// Everything is checked before anything is changed.
+	const uint8_t *src = state.ptr() + sizeof(header);
+	const uint8_t *end = state.ptr() + state.size();
+	if (header.page_size != page_size || size_t(end - src) < uint64_t(header.machine_state_size) + header.permanent_size) {
+		ERR_PRINT("Sandbox: Saved state is damaged.");
+		return false;
+	}
+	const uint8_t *machine_state = src;
+	src += header.machine_state_size;
+	Dictionary permanent;
+	if (header.permanent_size != 0) {
+		PackedByteArray bytes;
+		bytes.resize(header.permanent_size);
+		std::memcpy(bytes.ptrw(), src, header.permanent_size);
+		const Variant variants = UtilityFunctions::bytes_to_var(bytes);
+		if (variants.get_type() != Variant::DICTIONARY) {
+			ERR_PRINT("Sandbox: Saved state is damaged.");
+			return false;
+		}
+		permanent = variants;
+		src += header.permanent_size;
+	}
+	std::vector<uint32_t> pages;
+	std::vector<std::span<const uint8_t>> encodings;
+	pages.reserve(header.page_count);
+	encodings.reserve(header.page_count);
+	for (uint32_t i = 0; i < header.page_count; i++) {
+		StatePageHeader record;
+		if (size_t(end - src) < sizeof(record)) {
+			ERR_PRINT("Sandbox: Saved state is damaged.");
+			return false;
+		}
+		std::memcpy(&record, src, sizeof(record));
+		src += sizeof(record);
+		// Pages are saved in ascending order, which restoring them relies on.
+		if (record.page >= arena_pages || (!pages.empty() && record.page <= pages.back())
+				|| size_t(end - src) < record.size || !validate_page({ src, record.size }, page_size)) {
+			ERR_PRINT("Sandbox: Saved state is damaged.");
+			return false;
+		}
+		pages.push_back(record.page);
+		encodings.emplace_back(src, record.size);
+		src += record.size;
+	}
+
+	this->m_state_generation++;
+	try {
+		if (m.deserialize_from(std::vector<uint8_t>(machine_state, machine_state + header.machine_state_size)) < 0) {
+			throw std::runtime_error("Failed to restore machine state");
+		}
+		if (m.has_arena()) {
+			m.arena().set_max_chunks(get_allocations_max());
+		}
+	} catch (const std::exception &e) {
+		ERR_PRINT(("Sandbox state exception: " + std::string(e.what())).c_str());
+		return false;
+	}
+
+	uint8_t *arena = (uint8_t *)m.memory.memory_arena_ptr();
+	if (checkpoint.pages != nullptr) {
+		// Pages written to since the checkpoint that the state does not have are put back,
+		// leaving only the ones that are in both, whose checkpoint copy was saved.
+		checkpoint.pages->restore(pages);
+		const std::span<const uint32_t> written = checkpoint.pages->written_pages();
+		for (size_t i = 0, w = 0; i < pages.size(); i++) {
+			const bool is_written = w < written.size() && written[w] == pages[i];
+			w += is_written;
+			uint8_t *page = arena + size_t(pages[i]) * page_size;
+			const uint8_t *base = is_written ? checkpoint.pages->saved_page(pages[i]) : page;
+			decode_page(page, base, encodings[i], page_size);
+		}
+	} else {
+		for (size_t page = 0, i = 0; page < arena_pages; page++) {
+			uint8_t *dst = arena + page * page_size;
+			const uint8_t *base = checkpoint.state.page(page);
+			if (i < pages.size() && pages[i] == page) {
+				decode_page(dst, base, encodings[i], page_size);
+				i++;
+			} else if (std::memcmp(dst, base, page_size) != 0) {
+				std::memcpy(dst, base, page_size);
+			}
+		}
+	}
+
+	if (header.permanent_size == 0) {
+		this->m_states[0].copy_from(checkpoint.state.permanent);
+	} else {
+		CurrentState variants;
+		load_permanent_variants(variants, permanent, this->m_max_refs);
+		this->m_states[0].copy_from(variants);
+	}
+	return true;
+}
@@ -1,4 +1,5 @@
 #include "guest_datatypes.h"
+#include "sandbox_worker.h"
 #include "syscalls.h"
 
 #include <algorithm>
@@ -57,10 +58,9 @@ godot::Object *get_object_from_address(const Sandbox &emu, uint64_t addr) {
 	ERR_PRINT(buffer);
 	throw std::runtime_error(buffer);
 }
-/// @brief Look up a scoped object and confirm it is a T, throwing if it is not.
+/// @brief Confirm that an object is a T, throwing if it is not.
 template <typename T>
-inline T *get_class_from_address(const Sandbox &emu, uint64_t addr) {
-	godot::Object *obj = get_object_from_address(emu, addr);
+inline T *cast_object_or_throw(godot::Object *obj) {
 	T *result = fast_cast_to<T>(obj);
 	if (UNLIKELY(result == nullptr)) {
 		const godot::String class_name = godot::String(T::get_class_static());
@@ -69,6 +69,11 @@ inline T *get_class_from_address(const Sandbox &emu, uint64_t addr) {
 	}
 	return result;
 }
+/// @brief Look up a scoped object and confirm it is a T, throwing if it is not.
+template <typename T>
+inline T *get_class_from_address(const Sandbox &emu, uint64_t addr) {
+	return cast_object_or_throw<T>(get_object_from_address(emu, addr));
+}
 
 inline godot::Node *get_node_from_address(const Sandbox &emu, uint64_t addr) {
 	SYS_TRACE("get_node_from_address", addr);
@@ -152,6 +157,23 @@ static inline void object_call(Sandbox &emu, godot::Object *obj, const Variant &
 	object_callp(obj, vargs, argc + 1, result);
 }
 
+// The same as object_call(), but straight through the method's own bind, which does
+// not need the method name as its first argument.
+static inline void method_bind_call(Sandbox &emu, GDExtensionMethodBindPtr bind, godot::Object *obj, const GuestVariant *args, int argc, CallResult &result) {
+	VariantScratch scratch;
+	const Variant *vargs[8];
+	for (int i = 0; i < argc; i++) {
+		if (args[i].is_scoped_variant()) {
+			vargs[i] = args[i].toVariantPtr(emu);
+		} else {
+			vargs[i] = scratch.emplace(args[i].toVariant(emu));
+		}
+	}
+	GDExtensionCallError error;
+	internal::gdextension_interface_object_method_bind_call(bind, obj->_owner, reinterpret_cast<GDExtensionConstVariantPtr *>(vargs), argc, &result.get(), &error);
+	result.mark_constructed();
+}
+
 /// @brief Call a method on an Object, after checking that the sandbox allows it.
 static inline void object_call_checked(Sandbox &emu, godot::Object *obj,
 		const Sandbox::CachedName &cached_method, std::string_view method_name,
@@ -1281,6 +1303,14 @@ APICALL(api_vclone) {
 	}
 }
 
+APICALL(api_vrelease) {
+	auto [idx] = machine.sysargs<int32_t>();
+	Sandbox &emu = riscv::emu(machine);
+	SYS_TRACE("vrelease", idx);
+
+	emu.release_permanent_variant(idx);
+}
+
 APICALL(api_vstore) {
 	auto [vidx, type, gdata, gsize] = machine.sysargs<unsigned *, int32_t, gaddr_t, gaddr_t>();
 	auto &emu = riscv::emu(machine);
@@ -1585,12 +1615,39 @@ APICALL(api_obj) {
 	}
 }
 
+// A method or property name, read from the guest as characters, or passed as a handle to a
+// name the guest interned earlier: ECALL_NAME_IS_HANDLE as the length, and the handle in place
+// of the address. Returned by value, as an allowed-method or allowed-property callback may
+// re-enter the sandbox and evict the cache entry, and the name we vet must be the name we use.
+static inline Variant guest_object_name(machine_t &machine, gaddr_t g_name, unsigned len) {
+	Sandbox &emu = riscv::emu(machine);
+	if (len == ECALL_NAME_IS_HANDLE) {
+		return emu.get_interned_name(g_name, Variant::STRING_NAME);
+	}
+	// Reuse the StringName built for this call site, keyed on the guest address it came from.
+	const std::string_view view = memview_with_terminator(machine, g_name, len).substr(0, size_t(len) + 1);
+	return emu.cached_guest_name(g_name, view.substr(0, len), view.back() == '\0').variant;
+}
+
+APICALL(api_intern_name) {
+	auto [g_name, len, type] = machine.sysargs<gaddr_t, unsigned, int>();
+	Sandbox &emu = riscv::emu(machine);
+	PENALIZE(150'000);
+	SYS_TRACE("intern_name", g_name, len, type);
+
+	if (UNLIKELY(type != Variant::STRING_NAME && type != Variant::NODE_PATH)) {
+		ERR_PRINT("Interned names are StringNames or NodePaths, not " + String(GuestVariant::type_name(type)));
+		throw std::runtime_error("Interned names are StringNames or NodePaths, not " + std::string(GuestVariant::type_name(type)));
+	}
+	const std::string_view name = machine.memory.memview(g_name, len);
+	machine.set_result(emu.intern_name(name, Variant::Type(type)));
+}
+
 APICALL(api_obj_property_get) {
 	auto [addr, g_property, g_property_len, vret] = machine.sysargs<uint64_t, gaddr_t, unsigned, GuestVariant *>();
-	const std::string_view method = machine.memory.memview(g_property, g_property_len);
 	auto &emu = riscv::emu(machine);
 	PENALIZE(150'000);
-	SYS_TRACE("obj_property_get", addr, method, vret);
+	SYS_TRACE("obj_property_get", addr, g_property, g_property_len, vret);
 
 	godot::Object *obj = nullptr;
 	if ((uint16_t)addr != addr) {
@@ -1604,13 +1661,11 @@ APICALL(api_obj_property_get) {
 		}
 		obj = var.operator godot::Object *();
 	}
-	// Reuse the StringName built for this call site. Held by value, as the allowed-property
-	// callback below may re-enter the sandbox and evict the cache entry.
-	const StringName prop_name = emu.cached_guest_name(g_property, method, false).sname;
+	const StringName prop_name = guest_object_name(machine, g_property, g_property_len);
 
 	if (UNLIKELY(!emu.is_allowed_property(obj, prop_name, false))) {
 		ERR_PRINT("Banned property accessed: " + prop_name);
-		throw std::runtime_error("Banned property accessed: " + std::string(method));
+		throw std::runtime_error("Banned property accessed: " + std::string(String(prop_name).utf8().get_data()));
 	}
 
 	vret->create(emu, obj->get(prop_name));
@@ -1618,10 +1673,9 @@ APICALL(api_obj_property_get) {
 
 APICALL(api_obj_property_set) {
 	auto [addr, g_property, g_property_len, g_value] = machine.sysargs<uint64_t, gaddr_t, unsigned, const GuestVariant *>();
-	const std::string_view method = machine.memory.memview(g_property, g_property_len);
 	auto &emu = riscv::emu(machine);
 	PENALIZE(150'000);
-	SYS_TRACE("obj_property_set", addr, method, value);
+	SYS_TRACE("obj_property_set", addr, g_property, g_property_len, g_value);
 
 	godot::Object *obj = nullptr;
 	if ((uint16_t)addr != addr) {
@@ -1635,19 +1689,17 @@ APICALL(api_obj_property_set) {
 		}
 		obj = var.operator godot::Object *();
 	}
-	// Reuse the StringName built for this call site. Held by value, as the allowed-property
-	// callback below may re-enter the sandbox and evict the cache entry.
-	const StringName prop_name = emu.cached_guest_name(g_property, method, false).sname;
+	const StringName prop_name = guest_object_name(machine, g_property, g_property_len);
 
 	if (UNLIKELY(!emu.is_allowed_property(obj, prop_name, true))) {
 		ERR_PRINT("Banned property set: " + prop_name);
-		throw std::runtime_error("Banned property set: " + std::string(method));
+		throw std::runtime_error("Banned property set: " + std::string(String(prop_name).utf8().get_data()));
 	}
 
 	obj->set(prop_name, g_value->toVariant(emu));
 }
 
-APICALL(api_obj_callp) {
+APICALL_DEFERRABLE(api_obj_callp) {
 	auto [addr, g_method, g_method_len, deferred, vret_ptr, args_addr, args_size] = machine.sysargs<uint64_t, gaddr_t, unsigned, bool, gaddr_t, gaddr_t, unsigned>();
 	auto &emu = riscv::emu(machine);
 	PENALIZE(250'000); // Costly Object call operation.
@@ -1661,21 +1713,23 @@ APICALL(api_obj_callp) {
 	// Zero-argument calls are the common case, and have nothing to translate or validate.
 	const GuestVariant *g_args = args_size ? machine.memory.memarray<GuestVariant>(args_addr, args_size) : nullptr;
 
-	const std::string_view method_view = memview_with_terminator(machine, g_method, g_method_len).substr(0, size_t(g_method_len) + 1);
-	// Reuse the StringName built for this call site, keyed on the guest address it came from.
-	// Held by value: the allowed-method callback below may re-enter the sandbox and evict the
-	// cache entry, and the method we vet must be the method we go on to call.
-	const Variant method = emu.cached_guest_name(g_method, method_view.substr(0, g_method_len), method_view.back() == '\0').variant;
+	const Variant method = guest_object_name(machine, g_method, g_method_len);
 
 	// Check for banned methods.
 	if (UNLIKELY(!emu.is_allowed_method(obj, method))) {
 		ERR_PRINT("Banned method called: " + method.operator String());
-		throw std::runtime_error("Banned method called: " + std::string(method_view.substr(0, g_method_len)));
+		throw std::runtime_error("Banned method called: " + std::string(method.operator String().utf8().get_data()));
 	}
 
 	if (!deferred) {
 		CallResult result;
-		object_call(emu, obj, method, g_args, args_size, result);
+		// The guest API makes the system call inline, so the PC tells call sites apart.
+		const GDExtensionMethodBindPtr bind = emu.cached_method_bind(machine.cpu.pc(), obj, method.operator StringName());
+		if (bind != nullptr) {
+			method_bind_call(emu, bind, obj, g_args, args_size, result);
+		} else {
+			object_call(emu, obj, method, g_args, args_size, result);
+		}
 		if (vret_ptr != 0) {
 			GuestVariant *vret = machine.memory.memarray<GuestVariant>(vret_ptr, 1);
 			vret->create(emu, std::move(result.get()));
@@ -1705,32 +1759,168 @@ APICALL(api_obj_callp) {
 	}
 }
 
-APICALL(api_get_node) {
-	auto [addr, name] = machine.sysargs<uint64_t, std::string_view>();
+// Typed calls go straight to the engine method, as with a call made from C++, so a script
+// on the object is not consulted. The generated API uses these for methods whose arguments
+// and return value are all plain values, see Sandbox::is_ptrcall_method().
+APICALL(api_obj_ptrcall) {
+	auto [addr, g_method, g_method_len, hash, args_addr, args_size, ret_addr] = machine.sysargs<uint64_t, gaddr_t, unsigned, unsigned, gaddr_t, unsigned, gaddr_t>();
+	auto &emu = riscv::emu(machine);
+	PENALIZE(100'000); // No Variants to create, and no method to look up.
+	SYS_TRACE("obj_ptrcall", addr, g_method, g_method_len, hash, args_addr, args_size, ret_addr);
+
+	godot::Object *obj = get_object_from_address(emu, addr);
+	const Variant method = guest_object_name(machine, g_method, g_method_len);
+
+	if (UNLIKELY(!emu.is_allowed_method(obj, method))) {
+		ERR_PRINT("Banned method called: " + method.operator String());
+		throw std::runtime_error("Banned method called: " + std::string(method.operator String().utf8().get_data()));
+	}
+	// The argument types come from ClassDB, never from the guest. A hash that does not
+	// match means that the guest was generated against another version of the method.
+	const Sandbox::ResolvedMethod *typed = emu.cached_ptrcall_method(machine.cpu.pc(), obj, method.operator StringName(), hash);
+	if (UNLIKELY(typed == nullptr)) {
+		ERR_PRINT("Method cannot be called with native arguments: " + method.operator String());
+		throw std::runtime_error("Method cannot be called with native arguments: " + std::string(method.operator String().utf8().get_data()));
+	}
+	if (UNLIKELY(args_size != typed->argc)) {
+		ERR_PRINT("Wrong number of arguments to " + method.operator String() + ": " + itos(args_size));
+		throw std::runtime_error("Wrong number of arguments to " + std::string(method.operator String().utf8().get_data()) + ": " + std::to_string(args_size));
+	}
+	const PtrCallSlot *g_args = args_size ? machine.memory.memarray<PtrCallSlot>(args_addr, args_size) : nullptr;
+
+	PtrCallSlot args[8];
+	GDExtensionConstTypePtr argptrs[8];
+	for (unsigned i = 0; i < args_size; i++) {
+		switch (typed->arg_types[i]) {
+			case Variant::BOOL:
+				*reinterpret_cast<GDExtensionBool *>(&args[i]) = g_args[i].data[0] != 0;
+				break;
+			case Variant::OBJECT: {
+				// Both Object * and Ref<T> arguments are passed as a pointer to the object.
+				// The method casts it without checking, so it has to be of the right class.
+				const uint64_t address = g_args[i].data[0];
+				godot::Object *arg = address ? get_object_from_address(emu, address) : nullptr;
+				const StringName &arg_class = typed->arg_classes[i];
+				if (UNLIKELY(arg != nullptr && !arg_class.is_empty() && !arg->is_class(arg_class))) {
+					ERR_PRINT("Object argument " + itos(i) + " to " + method.operator String() + " is not a " + String(arg_class));
+					throw std::runtime_error("Object argument " + std::to_string(i) + " to " + std::string(method.operator String().utf8().get_data()) + " is not a " + std::string(String(arg_class).utf8().get_data()));
+				}
+				*reinterpret_cast<GDExtensionObjectPtr *>(&args[i]) = arg ? arg->_owner : nullptr;
+				break;
+			}
+			default:
+				args[i] = g_args[i];
+				break;
+		}
+		argptrs[i] = &args[i];
+	}
+
+	PtrCallSlot ret{};
+	internal::gdextension_interface_object_method_bind_ptrcall(typed->bind, obj->_owner, argptrs, &ret);
+	if (ret_addr != 0 && typed->return_type != Variant::NIL) {
+		if (typed->return_type == Variant::BOOL) {
+			const GDExtensionBool value = *reinterpret_cast<const GDExtensionBool *>(&ret);
+			ret.data[0] = value != 0;
+		}
+		machine.memory.memcpy(ret_addr, &ret, sizeof(ret));
+	}
+}
+
+// On a worker thread, a deferred call is queued along with its arguments, and the guest
+// carries on without waiting. The call was never going to report back to the guest.
+// Only the handle is checked here. The object is looked up, and checked against the
+// restrictions, on the main thread where the call runs.
+static bool api_obj_callp_defer(machine_t &machine) {
+	auto [addr, g_method, g_method_len, deferred, vret_ptr, args_addr, args_size] = machine.sysargs<uint64_t, gaddr_t, unsigned, bool, gaddr_t, gaddr_t, unsigned>();
+	if (!deferred || vret_ptr != 0 || args_size > 8) {
+		return false;
+	}
 	Sandbox &emu = riscv::emu(machine);
-	PENALIZE(150'000);
-	SYS_TRACE("get_node", addr, String::utf8(name.data(), name.size()));
+	const GuestVariant *g_args = args_size ? machine.memory.memarray<GuestVariant>(args_addr, args_size) : nullptr;
+	// Objects among the arguments have to be looked up now, on the main thread.
+	for (unsigned i = 0; i < args_size; i++) {
+		if (g_args[i].type == Variant::OBJECT) {
+			return false;
+		}
+	}
+	PENALIZE(250'000);
 
-	Node *node = nullptr;
-	const std::string c_name(name);
+	const uint64_t id = emu.get_object_id_from_handle(uintptr_t(addr));
+	if (UNLIKELY(id == 0)) {
+		ERR_PRINT("Object is not scoped");
+		throw std::runtime_error("Object is not scoped");
+	}
+	// Guest memory keeps changing, so everything is copied out of it now.
+	Array args;
+	args.resize(args_size);
+	for (unsigned i = 0; i < args_size; i++) {
+		args[i] = g_args[i].toVariant(emu);
+	}
+	StringName method;
+	if (g_method_len == ECALL_NAME_IS_HANDLE) {
+		method = emu.get_interned_name(g_method, Variant::STRING_NAME);
+	} else {
+		const std::string_view method_view = machine.memory.memview(g_method, g_method_len);
+		method = StringName(String::utf8(method_view.data(), method_view.size()));
+	}
+
+	emu.defer_to_main_thread([&emu, id, method = std::move(method), args = std::move(args)]() {
+		godot::Object *obj = ObjectDB::get_instance(id);
+		if (obj == nullptr) {
+			return;
+		}
+		if (UNLIKELY(!emu.is_allowed_method(obj, method))) {
+			ERR_PRINT("Banned method called: " + String(method));
+			return;
+		}
+		Callable(obj, method).bindv(args).call_deferred();
+	});
+	return true;
+}
+
+APICALL(api_get_node) {
+	auto [addr, g_path, g_path_len] = machine.sysargs<uint64_t, gaddr_t, unsigned>();
+	Sandbox &emu = riscv::emu(machine);
+	PENALIZE(15'000);
+	SYS_TRACE("get_node", addr, g_path, g_path_len);
 
+	Node *base_node = nullptr;
 	if (addr == 0) {
-		auto *owner_node = emu.get_tree_base();
-		if (owner_node == nullptr) {
+		base_node = emu.get_tree_base();
+		if (base_node == nullptr) {
 			ERR_PRINT("Sandbox has no parent Node");
 			machine.set_result(0);
 			return;
 		}
-		node = owner_node->get_node<Node>(NodePath(c_name.c_str()));
 	} else {
-		Node *base_node = get_node_from_address(emu, addr);
-		node = base_node->get_node<Node>(NodePath(c_name.c_str()));
+		base_node = get_node_from_address(emu, addr);
+	}
+	// A path the guest interned earlier comes as a handle, see ECALL_INTERN_NAME.
+	const bool interned = g_path_len == ECALL_NAME_IS_HANDLE;
+	std::string_view name;
+	NodePath path;
+	if (interned) {
+		path = emu.get_interned_name(g_path, Variant::NODE_PATH);
+	} else {
+		name = machine.memory.memview(g_path, g_path_len);
+	}
+	// Guests look up the same paths every frame, usually from a string literal.
+	if (Node *node = emu.cached_node_path(base_node, g_path, name, interned ? &path : nullptr)) {
+		machine.set_result(emu.add_scoped_object(node));
+		return;
 	}
+	PENALIZE(135'000);
+
+	if (!interned) {
+		path = NodePath(String::utf8(name.data(), name.size()));
+	}
+	Node *node = base_node->get_node<Node>(path);
 	if (node == nullptr) {
-		ERR_PRINT(("Node not found: " + c_name).c_str());
+		ERR_PRINT("Node not found: " + String(path));
 		machine.set_result(0);
 		return;
 	}
+	emu.cache_node_path(base_node, g_path, name, path, node, interned);
 
 	machine.set_result(emu.add_scoped_object(node));
 }
@@ -1810,7 +2000,7 @@ APICALL(api_node_create) {
 	machine.set_result(emu.add_scoped_object(node));
 }
 
-APICALL(api_node) {
+APICALL_DEFERRABLE(api_node) {
 	auto [op, addr, gvar] = machine.sysargs<int, uint64_t, gaddr_t>();
 	Sandbox &emu = riscv::emu(machine);
 	PENALIZE(250'000); // Costly Node operations.
@@ -2062,6 +2252,39 @@ APICALL(api_node) {
 	}
 }
 
+// On a worker thread, queue_free() is queued, and the guest carries on without waiting.
+// As with api_obj_callp_defer(), the node is looked up and checked on the main thread.
+static bool api_node_defer(machine_t &machine) {
+	auto [op, addr, gvar] = machine.sysargs<int, uint64_t, gaddr_t>();
+	if (Node_Op(op) != Node_Op::QUEUE_FREE) {
+		return false;
+	}
+	Sandbox &emu = riscv::emu(machine);
+	PENALIZE(250'000);
+
+	if (UNLIKELY(uintptr_t(addr) == Sandbox::engine_ptr(&emu))) {
+		ERR_PRINT("Cannot queue free the sandbox");
+		throw std::runtime_error("Cannot queue free the sandbox");
+	}
+	const uint64_t id = emu.get_object_id_from_handle(uintptr_t(addr));
+	if (UNLIKELY(id == 0)) {
+		ERR_PRINT("Object is not scoped");
+		throw std::runtime_error("Object is not scoped");
+	}
+	emu.defer_to_main_thread([&emu, id]() {
+		godot::Node *node = Object::cast_to<godot::Node>(ObjectDB::get_instance(id));
+		if (node == nullptr) {
+			return;
+		}
+		if (UNLIKELY(!emu.is_allowed_method(node, "queue_free"))) {
+			ERR_PRINT("Banned method called: queue_free");
+			return;
+		}
+		node->queue_free();
+	});
+	return true;
+}
+
 APICALL(api_node2d) {
 	// Node2D operation, Node2D address, and the variant to get/set the value.
 	auto [op, addr, gvar] = machine.sysargs<int, uint64_t, gaddr_t>();
@@ -2200,6 +2423,117 @@ APICALL(api_node3d) {
 	}
 }
 
+// Resolve the object of a deferred command once per run of commands on the same object.
+static godot::Object *command_object(Sandbox &emu, uint64_t addr) {
+	if ((uint16_t)addr != addr) {
+		return get_object_from_address(emu, addr);
+	}
+	// It's likely a Variant index, see api_obj_property_set().
+	const Variant &var = get_scoped_variant_or_throw(emu, uint32_t(addr), "deferred command");
+	if (var.get_type() != Variant::OBJECT) {
+		ERR_PRINT("Deferred command: Variant is not an Object, but " + String(GuestVariant::type_name(var.get_type())));
+		throw std::runtime_error("Deferred command: Variant is not an Object");
+	}
+	return var.operator godot::Object *();
+}
+
+static void apply_command(Sandbox &emu, godot::Object *obj, const Command &cmd) {
+	static_assert(sizeof(GuestVariant) == sizeof(Command::value), "Command values are guest Variants");
+	const GuestVariant &value = *reinterpret_cast<const GuestVariant *>(cmd.value);
+	// The same checks as the system calls that the commands stand in for.
+	const auto allowed = [&emu, obj](const StringName &property) {
+		if (UNLIKELY(!emu.is_allowed_property(obj, property, true))) {
+			ERR_PRINT("Banned property set: " + property);
+			throw std::runtime_error("Banned property set: " + std::string(String(property).utf8().get_data()));
+		}
+	};
+
+	switch (cmd.op) {
+		case Command_Op::NODE2D_SET_POSITION:
+			allowed("position");
+			cast_object_or_throw<godot::Node2D>(obj)->set_position(value.toVariant(emu));
+			break;
+		case Command_Op::NODE2D_SET_ROTATION:
+			allowed("rotation");
+			cast_object_or_throw<godot::Node2D>(obj)->set_rotation(value.toVariant(emu));
+			break;
+		case Command_Op::NODE2D_SET_SCALE:
+			allowed("scale");
+			cast_object_or_throw<godot::Node2D>(obj)->set_scale(value.toVariant(emu));
+			break;
+		case Command_Op::NODE2D_SET_TRANSFORM:
+			allowed("transform");
+			cast_object_or_throw<godot::Node2D>(obj)->set_transform(*value.toVariantPtr(emu));
+			break;
+		case Command_Op::NODE3D_SET_POSITION:
+			allowed("position");
+			cast_object_or_throw<godot::Node3D>(obj)->set_position(value.toVariant(emu));
+			break;
+		case Command_Op::NODE3D_SET_ROTATION:
+			allowed("rotation");
+			cast_object_or_throw<godot::Node3D>(obj)->set_rotation(value.toVariant(emu));
+			break;
+		case Command_Op::NODE3D_SET_SCALE:
+			allowed("scale");
+			cast_object_or_throw<godot::Node3D>(obj)->set_scale(value.toVariant(emu));
+			break;
+		case Command_Op::NODE3D_SET_TRANSFORM:
+			allowed("transform");
+			cast_object_or_throw<godot::Node3D>(obj)->set_transform(*value.toVariantPtr(emu));
+			break;
+		case Command_Op::OBJ_PROP_SET: {
+			if (UNLIKELY(cmd.name_len >= sizeof(cmd.name))) {
+				ERR_PRINT("Deferred property set: Name too long");
+				throw std::runtime_error("Deferred property set: Name too long");
+			}
+			const StringName property = String::utf8(cmd.name, cmd.name_len);
+			allowed(property);
+			obj->set(property, value.toVariant(emu));
+			break;
+		}
+		case Command_Op::QUEUE_FREE: {
+			godot::Node *node = cast_object_or_throw<godot::Node>(obj);
+			if (UNLIKELY(node == &emu)) {
+				ERR_PRINT("Cannot queue free the sandbox");
+				throw std::runtime_error("Cannot queue free the sandbox");
+			}
+			if (UNLIKELY(!emu.is_allowed_method(node, "queue_free"))) {
+				ERR_PRINT("Banned method called: queue_free");
+				throw std::runtime_error("Banned method called: queue_free");
+			}
+			node->queue_free();
+			break;
+		}
+		default:
+			ERR_PRINT("Invalid deferred command");
+			throw std::runtime_error("Invalid deferred command");
+	}
+}
+
+APICALL(api_command_buffer) {
+	auto [op, addr] = machine.sysargs<Command_Buffer_Op, gaddr_t>();
+	Sandbox &emu = riscv::emu(machine);
+	SYS_TRACE("command_buffer", int(op), addr);
+
+	switch (op) {
+		case Command_Buffer_Op::SET:
+			if (addr != 0) {
+				// Fail early on a buffer that can't be read.
+				machine.memory.memarray<CommandBuffer>(addr, 1);
+			}
+			emu.set_command_buffer(addr);
+			break;
+		case Command_Buffer_Op::FLUSH: {
+			const unsigned count = emu.flush_command_buffer();
+			PENALIZE(count * 20'000);
+			break;
+		}
+		default:
+			ERR_PRINT("Invalid command buffer operation");
+			throw std::runtime_error("Invalid command buffer operation");
+	}
+}
+
 APICALL(api_throw) {
 	auto [type, msg, vaddr, vfunc] = machine.sysargs<std::string_view, std::string_view, gaddr_t, gaddr_t>();
 	SYS_TRACE("throw", String::utf8(type.data(), type.size()), String::utf8(msg.data(), msg.size()), vaddr);
@@ -2306,6 +2640,44 @@ APICALL(api_array_ops) {
 			vp->set(emu, result);
 			break;
 		}
+		case Array_Op::GET_SLICE: {
+			// A slice that runs past the end of the array is cut short.
+			const unsigned count = machine.cpu.reg(14); // A4
+			if (UNLIKELY(idx < 0 || idx > array.size())) {
+				ERR_PRINT("Array slice out of bounds: " + itos(idx));
+				throw std::runtime_error("Array slice out of bounds: " + std::to_string(idx));
+			}
+			const unsigned n = std::min<int64_t>(count, array.size() - idx);
+			PENALIZE(1'000 * n);
+			GuestVariant *vp = machine.memory.memarray<GuestVariant>(vaddr, n);
+			for (unsigned i = 0; i < n; i++) {
+				vp[i].create(emu, Variant(array[idx + i]));
+			}
+			machine.set_result(n);
+			break;
+		}
+		case Array_Op::SET_SLICE: {
+			const unsigned count = machine.cpu.reg(14); // A4
+			if (UNLIKELY(idx < 0 || int64_t(idx) + count > array.size())) {
+				ERR_PRINT("Array slice out of bounds: " + itos(idx) + " + " + itos(count));
+				throw std::runtime_error("Array slice out of bounds: " + std::to_string(idx) + " + " + std::to_string(count));
+			}
+			PENALIZE(1'000 * uint64_t(count));
+			const GuestVariant *vp = machine.memory.memarray<GuestVariant>(vaddr, count);
+			for (unsigned i = 0; i < count; i++) {
+				const Variant value = vp[i].toVariant(emu);
+				GDExtensionBool valid = false;
+				GDExtensionBool oob = false;
+				internal::gdextension_interface_variant_set_indexed(
+						const_cast<Variant &>(var_array)._native_ptr(), idx + i,
+						value._native_ptr(), &valid, &oob);
+				if (UNLIKELY(!valid || oob)) {
+					ERR_PRINT("Array::set_slice(): the element could not be assigned: " + itos(idx + i));
+					throw std::runtime_error("Array::set_slice(): the element could not be assigned: " + std::to_string(idx + i));
+				}
+			}
+			break;
+		}
 		default:
 			ERR_PRINT("Invalid Array operation");
 			throw std::runtime_error("Invalid Array operation");
@@ -2460,6 +2832,48 @@ APICALL(api_dict_ops) {
 			vp->create(emu, Variant(v));
 			break;
 		}
+		case Dictionary_Op::GET_ENTRIES: {
+			// Entries are copied in the order the Dictionary iterates them, continuing after
+			// the key at a3, or from the first entry when a3 is zero. Each step is a lookup
+			// of the previous key, so a caller walking a large Dictionary in chunks does
+			// linear work in total. Iteration ends early if the cursor key has been erased.
+			const unsigned count = std::min<unsigned>(machine.cpu.reg(14), dict.size()); // A4
+			Variant iter;
+			bool valid = false;
+			bool more;
+			if (vaddr == 0) {
+				more = var_dict.iter_init(iter, valid);
+			} else {
+				// Read the cursor before writing any entries, as it may live in the same buffer.
+				iter = machine.memory.memarray<GuestVariant>(vaddr, 1)->toVariant(emu);
+				more = var_dict.iter_next(iter, valid);
+			}
+			PENALIZE(2'000 * count);
+			GuestVariant *vp = machine.memory.memarray<GuestVariant>(vkey, 2 * count);
+			unsigned n = 0;
+			while (more && valid && n < count) {
+				vp[2 * n + 0].create(emu, Variant(iter));
+				vp[2 * n + 1].create(emu, dict.get(iter, Variant()));
+				if (++n < count) {
+					more = var_dict.iter_next(iter, valid);
+				}
+			}
+			machine.set_result(n);
+			break;
+		}
+		case Dictionary_Op::SET_ENTRIES: {
+			const unsigned count = machine.cpu.reg(14); // A4
+			if (UNLIKELY(dict.is_read_only())) {
+				ERR_PRINT("Dictionary::set_entries(): the Dictionary is read-only");
+				throw std::runtime_error("Dictionary::set_entries(): the Dictionary is read-only");
+			}
+			PENALIZE(2'000 * uint64_t(count));
+			const GuestVariant *vp = machine.memory.memarray<GuestVariant>(vkey, 2 * size_t(count));
+			for (unsigned i = 0; i < count; i++) {
+				dict[vp[2 * i + 0].toVariant(emu)] = vp[2 * i + 1].toVariant(emu);
+			}
+			break;
+		}
 		default:
 			ERR_PRINT("Invalid Dictionary operation");
 			throw std::runtime_error("Invalid Dictionary operation");
@@ -2908,6 +3322,24 @@ APICALL(api_packed_array_ops)
 		}
 		return;
 	}
+	case int(PackedArray_Op::MAP): {
+		auto [unused_op, arr_idx, writable, view_ptr] = machine.sysargs<int, int32_t, bool, gaddr_t>();
+		PackedArrayView *view = machine.memory.memarray<PackedArrayView>(view_ptr, 1);
+		size_t elements = 0;
+		view->data = emu.map_packed_array(arr_idx, writable, elements);
+		view->size = elements;
+		return;
+	}
+	case int(PackedArray_Op::COMMIT): {
+		auto [unused_op, address] = machine.sysargs<int, gaddr_t>();
+		emu.commit_packed_array(address);
+		return;
+	}
+	case int(PackedArray_Op::UNMAP): {
+		auto [unused_op, address] = machine.sysargs<int, gaddr_t>();
+		emu.unmap_packed_array(address);
+		return;
+	}
 	default:
 		// Unknown operation
 		ERR_PRINT("Invalid PackedArray operation");
@@ -2935,6 +3367,64 @@ void Sandbox::initialize_syscalls_runtime() {
 	};
 }
 
+void Sandbox::discard_command_buffer() {
+	try {
+		CommandBuffer *buffer = machine().memory.memarray<CommandBuffer>(this->m_command_buffer, 1);
+		buffer->count = 0;
+	} catch (const std::exception &e) {
+		// The buffer is no longer readable, so there is nothing left to apply.
+		this->m_command_buffer = 0;
+	}
+}
+
+unsigned Sandbox::flush_command_buffer() {
+	if (this->m_command_buffer == 0) {
+		return 0;
+	}
+	if (UNLIKELY(this->is_on_worker_thread())) {
+		unsigned count = 0;
+		m_worker->run_on_main_thread([this, &count]() {
+			count = this->flush_command_buffer();
+		});
+		return count;
+	}
+	machine_t &machine = this->machine();
+	CommandBuffer *buffer = machine.memory.memarray<CommandBuffer>(this->m_command_buffer, 1);
+	const unsigned count = buffer->count;
+	if (count == 0) {
+		return 0;
+	}
+	// Emptied up front: a command that fails is not applied again by the next flush.
+	buffer->count = 0;
+	if (UNLIKELY(count > buffer->capacity)) {
+		ERR_PRINT("Deferred commands: Count exceeds capacity");
+		throw std::runtime_error("Deferred commands: Count exceeds capacity");
+	}
+	// Copied out, as applying a command may run the guest again, and it may append to the
+	// buffer. Sorted by object, keeping the order per object, so that each object is only
+	// resolved once and its commands are applied back to back.
+	const Command *guest_commands = machine.memory.memarray<Command>(buffer->commands, count);
+	std::vector<Command> commands(guest_commands, guest_commands + count);
+	std::stable_sort(commands.begin(), commands.end(), [](const Command &a, const Command &b) {
+		return a.object < b.object;
+	});
+
+	godot::Object *obj = nullptr;
+	uint64_t obj_address = 0;
+	for (const Command &cmd : commands) {
+		try {
+			if (obj == nullptr || cmd.object != obj_address) {
+				obj = riscv::command_object(*this, cmd.object);
+				obj_address = cmd.object;
+			}
+			riscv::apply_command(*this, obj, cmd);
+		} catch (const std::exception &e) {
+			ERR_PRINT(("Sandbox exception: " + std::string(e.what())).c_str());
+		}
+	}
+	return count;
+}
+
 void Sandbox::initialize_syscalls() {
 	using namespace riscv;
 
@@ -2953,6 +3443,8 @@ void Sandbox::initialize_syscalls() {
 			{ ECALL_GET_OBJ, api_get_obj },
 			{ ECALL_OBJ, api_obj },
 			{ ECALL_OBJ_CALLP, api_obj_callp },
+			{ ECALL_OBJ_PTRCALL, api_obj_ptrcall },
+			{ ECALL_INTERN_NAME, api_intern_name },
 			{ ECALL_GET_NODE, api_get_node },
 			{ ECALL_NODE, api_node },
 			{ ECALL_NODE2D, api_node2d },
@@ -2965,6 +3457,7 @@ void Sandbox::initialize_syscalls() {
 			{ ECALL_VCREATE, api_vcreate },
 			{ ECALL_VFETCH, api_vfetch },
 			{ ECALL_VCLONE, api_vclone },
+			{ ECALL_VRELEASE, api_vrelease },
 			{ ECALL_VSTORE, api_vstore },
 
 			{ ECALL_ARRAY_OPS, api_array_ops },
@@ -2996,6 +3489,8 @@ void Sandbox::initialize_syscalls() {
 			{ ECALL_PACKED_ARRAY_OPS, api_packed_array_ops },
 
 			{ ECALL_UTILITY, api_utility },
+
+			{ ECALL_COMMAND_BUFFER, api_command_buffer },
 	});
 
 	// Add system calls from other modules.
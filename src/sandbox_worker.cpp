@@ -0,0 +1,194 @@
+#include "sandbox_worker.h"
+
+#include "sandbox.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+// The thread that runs a call knows which call it is, so that system calls made from the
+// main thread on behalf of the call are not handed over again.
+static thread_local SandboxWorkerContext *current_context = nullptr;
+
+static std::mutex queues_mutex;
+static std::vector<MainThreadQueue *> queues;
+
+MainThreadQueue::MainThreadQueue() {
+	std::lock_guard<std::mutex> lock(queues_mutex);
+	queues.push_back(this);
+}
+
+MainThreadQueue::~MainThreadQueue() {
+	std::lock_guard<std::mutex> lock(queues_mutex);
+	queues.erase(std::remove(queues.begin(), queues.end(), this), queues.end());
+}
+
+void MainThreadQueue::run(std::function<void()> &&function) {
+	Waiter waiter;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_cancelled) {
+			throw std::runtime_error("Sandbox: Call on a worker thread was cancelled");
+		}
+		m_entries.push_back({ std::move(function), &waiter });
+	}
+	m_cond.notify_all();
+	if (on_queued) {
+		on_queued();
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	// Once the main thread has taken the function, it is running, and must be waited for
+	// even when cancelled, as it refers to the waiter on this stack.
+	m_cond.wait(lock, [&] { return waiter.done || (m_cancelled && !waiter.taken); });
+	if (!waiter.done) {
+		m_entries.erase(std::find_if(m_entries.begin(), m_entries.end(), [&](const Entry &entry) {
+			return entry.waiter == &waiter;
+		}));
+		throw std::runtime_error("Sandbox: Call on a worker thread was cancelled");
+	}
+	if (waiter.exception) {
+		std::rethrow_exception(waiter.exception);
+	}
+}
+
+void MainThreadQueue::post(std::vector<std::function<void()>> &&functions) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_cancelled) {
+			return;
+		}
+		for (auto &function : functions) {
+			m_entries.push_back({ std::move(function), nullptr });
+		}
+	}
+	m_cond.notify_all();
+	if (on_queued) {
+		on_queued();
+	}
+}
+
+void MainThreadQueue::run_pending() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_entries.empty()) {
+		Entry entry = std::move(m_entries.front());
+		m_entries.pop_front();
+		if (entry.waiter) {
+			entry.waiter->taken = true;
+		}
+		lock.unlock();
+
+		try {
+			if (before_each) {
+				before_each();
+			}
+			entry.function();
+		} catch (const std::exception &e) {
+			if (entry.waiter) {
+				entry.waiter->exception = std::current_exception();
+			} else {
+				ERR_PRINT(("Sandbox exception: " + std::string(e.what())).c_str());
+			}
+		}
+
+		lock.lock();
+		if (entry.waiter) {
+			entry.waiter->done = true;
+			m_cond.notify_all();
+		}
+	}
+}
+
+void MainThreadQueue::wait_for(const std::function<bool()> &done) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!done()) {
+		m_cond.wait(lock, [&] { return !m_entries.empty() || done(); });
+		lock.unlock();
+		this->run_pending();
+		lock.lock();
+	}
+}
+
+bool MainThreadQueue::wait_for_work(const std::function<bool()> &ready) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cond.wait(lock, [&] { return m_cancelled || ready(); });
+	return !m_cancelled;
+}
+
+void MainThreadQueue::cancel() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_cancelled = true;
+	}
+	// A guest that never makes another system call runs until its execution timeout.
+	m_cond.notify_all();
+}
+
+void MainThreadQueue::cancel_all() {
+	std::lock_guard<std::mutex> lock(queues_mutex);
+	for (MainThreadQueue *queue : queues) {
+		queue->cancel();
+	}
+}
+
+void SandboxWorkerContext::enter() {
+	current_context = this;
+}
+
+void SandboxWorkerContext::leave() {
+	this->flush();
+	current_context = nullptr;
+}
+
+bool SandboxWorkerContext::is_worker_thread() const {
+	return current_context == this;
+}
+
+void SandboxWorkerContext::run_on_main_thread(std::function<void()> &&function) {
+	// Commands from before this call must be seen by it.
+	this->flush();
+	m_main_thread_calls++;
+	m_waiting = true;
+	try {
+		m_queue->run(std::move(function));
+	} catch (...) {
+		m_waiting = false;
+		throw;
+	}
+	m_waiting = false;
+}
+
+void SandboxWorkerContext::defer_to_main_thread(std::function<void()> &&function) {
+	m_commands.push_back(std::move(function));
+}
+
+void SandboxWorkerContext::flush() {
+	if (m_commands.empty()) {
+		return;
+	}
+	m_main_thread_calls += m_commands.size();
+	m_queue->post(std::move(m_commands));
+	m_commands.clear();
+}
+
+void Sandbox::run_syscall_on_main_thread(machine_t &machine, void (*handler)(machine_t &)) {
+	if (!m_worker->is_worker_thread()) {
+		handler(machine);
+		return;
+	}
+	m_worker->run_on_main_thread([&machine, handler]() {
+		handler(machine);
+	});
+}
+
+void Sandbox::defer_to_main_thread(std::function<void()> &&function) {
+	m_worker->defer_to_main_thread(std::move(function));
+}
+
+bool Sandbox::is_on_worker_thread() const {
+	return m_worker != nullptr && m_worker->is_worker_thread();
+}
+
+bool Sandbox::is_busy_on_worker_thread() const {
+	return m_worker != nullptr && !m_worker->is_worker_thread() && !m_worker->is_waiting_for_main_thread();
+}
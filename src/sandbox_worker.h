@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Work handed from worker threads to the main thread.
+ *
+ * A sandbox that runs on a worker thread may not touch the engine, so its game API system
+ * calls are queued here instead. The main thread runs them in the order they were queued,
+ * whenever it services the queue, and the worker either waits for the result or carries on.
+ **/
+class MainThreadQueue {
+public:
+	MainThreadQueue();
+	~MainThreadQueue();
+
+	/// @brief Run a function on the main thread, and wait for it to finish.
+	/// @throw The exception thrown by the function, or std::runtime_error when cancelled.
+	void run(std::function<void()> &&function);
+	/// @brief Queue functions for the main thread, without waiting for them.
+	void post(std::vector<std::function<void()>> &&functions);
+
+	/// @brief Run everything queued so far. Called from the main thread.
+	void run_pending();
+	/// @brief Block until done() returns true, running queued work in the meantime.
+	/// Called from the main thread. done() is called with the queue locked.
+	void wait_for(const std::function<bool()> &done);
+
+	/// @brief Change state that wait_for() or wait_for_work() is waiting on.
+	template <typename F>
+	void update(F &&change) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			change();
+		}
+		m_cond.notify_all();
+	}
+	/// @brief Block a worker thread until ready() returns true, or the queue is cancelled.
+	/// ready() is called with the queue locked.
+	/// @return False if the queue was cancelled.
+	bool wait_for_work(const std::function<bool()> &ready);
+
+	/// @brief Called from a worker thread whenever something was queued, eg. to have the
+	/// main thread come and run it.
+	std::function<void()> on_queued;
+	/// @brief Called from the main thread before each queued function runs.
+	std::function<void()> before_each;
+
+	/// @brief Fail every function waiting on the main thread, now and from now on.
+	void cancel();
+	/// @brief Cancel every queue. Called before the extension unloads, when the main thread
+	/// will not be coming back to them.
+	static void cancel_all();
+
+private:
+	struct Waiter {
+		std::exception_ptr exception;
+		bool taken = false;
+		bool done = false;
+	};
+	struct Entry {
+		std::function<void()> function;
+		// Null for posted functions, which no one waits for.
+		Waiter *waiter = nullptr;
+	};
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::deque<Entry> m_entries;
+	bool m_cancelled = false;
+};
+
+/**
+ * @brief Connects a sandbox running on a worker thread to the main thread.
+ *
+ * Installed on a sandbox for the length of a call on a worker thread. Work that only changes
+ * the engine, and that the guest does not wait for, is collected in a command buffer, which
+ * is handed over in one go before the next call that waits, and when the call returns.
+ **/
+class SandboxWorkerContext {
+public:
+	SandboxWorkerContext(MainThreadQueue *queue = nullptr) :
+			m_queue(queue) {}
+
+	/// @brief Start running a call on this thread.
+	void enter();
+	/// @brief Finish running a call on this thread, handing over the command buffer.
+	void leave();
+	/// @brief True when called from the thread running the call.
+	bool is_worker_thread() const;
+	/// @brief True while the worker waits for the main thread, see run_on_main_thread().
+	/// The guest is not running then, and the main thread may call into it.
+	bool is_waiting_for_main_thread() const { return m_waiting; }
+
+	/// @brief Run a function on the main thread, and wait for it to finish.
+	void run_on_main_thread(std::function<void()> &&function);
+	/// @brief Run a function on the main thread later, after the commands before it. The
+	/// function may not refer to the sandbox's call state, which keeps changing meanwhile.
+	void defer_to_main_thread(std::function<void()> &&function);
+	/// @brief Hand the command buffer over to the main thread.
+	void flush();
+
+	/// @brief Number of functions handed to the main thread so far.
+	unsigned get_main_thread_calls() const { return m_main_thread_calls; }
+
+private:
+	MainThreadQueue *m_queue;
+	std::vector<std::function<void()>> m_commands;
+	unsigned m_main_thread_calls = 0;
+	std::atomic<bool> m_waiting = false;
+};
@@ -2,7 +2,36 @@
 #include "fast_cast.hpp"
 #include <libriscv/machine.hpp>
 
-#define APICALL(func) static void func(machine_t &machine [[maybe_unused]])
+// Game API system calls touch the engine, which is only safe from the main thread.
+// When the guest runs on a worker thread, see Sandbox::vmcall_async() and SandboxGroup,
+// the handler is run on the main thread instead, while the worker waits for it.
+#define APICALL(func)                                                                 \
+	static void func##_handler(machine_t &machine [[maybe_unused]]);                   \
+	static void func(machine_t &machine) {                                            \
+		if (UNLIKELY(riscv::emu(machine).is_async_worker())) {                        \
+			riscv::emu(machine).run_syscall_on_main_thread(machine, func##_handler); \
+			return;                                                                   \
+		}                                                                             \
+		func##_handler(machine);                                                      \
+	}                                                                                 \
+	static void func##_handler(machine_t &machine [[maybe_unused]])
+
+// Like APICALL(), but on a worker thread func##_defer() gets to look at the system call
+// first. It returns true when it has dealt with it there, eg. by queuing a command that
+// the guest does not need to wait for, and false to run the handler on the main thread.
+#define APICALL_DEFERRABLE(func)                                                          \
+	static void func##_handler(machine_t &machine [[maybe_unused]]);                       \
+	static bool func##_defer(machine_t &machine);                                         \
+	static void func(machine_t &machine) {                                                \
+		if (UNLIKELY(riscv::emu(machine).is_async_worker())) {                            \
+			if (riscv::emu(machine).is_on_worker_thread() && func##_defer(machine))       \
+				return;                                                                   \
+			riscv::emu(machine).run_syscall_on_main_thread(machine, func##_handler);     \
+			return;                                                                       \
+		}                                                                                 \
+		func##_handler(machine);                                                          \
+	}                                                                                     \
+	static void func##_handler(machine_t &machine [[maybe_unused]])
 
 #ifdef ENABLE_SYSCALL_TRACE
 #define SYS_TRACE(name, result, ...) sys_trace(name, result, ##__VA_ARGS__)
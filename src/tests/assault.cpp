@@ -104,19 +104,22 @@ static constexpr Shape SHAPES[] = {
 	{ ECALL_VCREATE, { Arg::OUT, Arg::OP, Arg::OP, Arg::VPTR } },
 	{ ECALL_VFETCH, { Arg::IDX_ANY, Arg::OUT, Arg::OP } },
 	{ ECALL_VCLONE, { Arg::VPTR, Arg::OUT } },
+	{ ECALL_VRELEASE, { Arg::IDX_ANY } },
 	{ ECALL_VSTORE, { Arg::OUT, Arg::OP, Arg::VPTR, Arg::SMALL } },
 	{ ECALL_VASSIGN, { Arg::IDX_ANY, Arg::IDX_ANY } },
 	{ ECALL_OBJ, { Arg::OP, Arg::ADDR, Arg::VPTR } },
 	{ ECALL_OBJ_PROP_GET, { Arg::ADDR, Arg::NAME, Arg::NAMELEN, Arg::OUT } },
 	{ ECALL_OBJ_PROP_SET, { Arg::ADDR, Arg::NAME, Arg::NAMELEN, Arg::VPTR } },
 	{ ECALL_OBJ_CALLP, { Arg::ADDR, Arg::NAME, Arg::NAMELEN, Arg::OP, Arg::OUT, Arg::VPTR, Arg::SMALL } },
+	{ ECALL_OBJ_PTRCALL, { Arg::ADDR, Arg::NAME, Arg::NAMELEN, Arg::ANY, Arg::VPTR, Arg::SMALL, Arg::OUT } },
 	{ ECALL_GET_NODE, { Arg::ADDR, Arg::NAME, Arg::NAMELEN } },
+	{ ECALL_INTERN_NAME, { Arg::NAME, Arg::NAMELEN, Arg::OP } },
 	{ ECALL_NODE_CREATE, { Arg::OP, Arg::NAME, Arg::NAMELEN, Arg::NAME, Arg::NAMELEN } },
 	{ ECALL_NODE, { Arg::OP, Arg::ADDR, Arg::VPTR } },
 	{ ECALL_NODE2D, { Arg::OP, Arg::ADDR, Arg::VPTR } },
 	{ ECALL_NODE3D, { Arg::OP, Arg::ADDR, Arg::VPTR } },
 	{ ECALL_THROW, { Arg::NAME, Arg::NAMELEN, Arg::NAME, Arg::NAMELEN, Arg::VPTR, Arg::VPTR } },
-	{ ECALL_ARRAY_OPS, { Arg::OP, Arg::IDX_ARRAY, Arg::SMALL, Arg::VPTR } },
+	{ ECALL_ARRAY_OPS, { Arg::OP, Arg::IDX_ARRAY, Arg::SMALL, Arg::VPTR, Arg::SMALL } },
 	{ ECALL_ARRAY_AT, { Arg::IDX_ARRAY, Arg::SMALL, Arg::OUT } },
 	{ ECALL_ARRAY_SIZE, { Arg::IDX_ARRAY } },
 	{ ECALL_DICTIONARY_OPS, { Arg::OP, Arg::IDX_DICT, Arg::VPTR, Arg::VPTR, Arg::VPTR } },
@@ -511,8 +514,9 @@ struct SyscallFuzzer {
 				return scoped_object_handle;
 			case Arg::OP_PACKED:
 				// api_packed_array_ops takes a Variant type tag as its operation, so the
-				// range that means anything to it starts at PACKED_BYTE_ARRAY.
-				return pick(8) ? uint64_t(Variant::PACKED_BYTE_ARRAY) + pick(10) : rng() % 64;
+				// range that means anything to it starts at PACKED_BYTE_ARRAY. Its other
+				// operations, the PackedArray views, come right after the first 64.
+				return pick(8) ? uint64_t(Variant::PACKED_BYTE_ARRAY) + pick(10) : rng() % (int(PackedArray_Op::UNMAP) + 1);
 			case Arg::IDX_ANY:
 				return scoped_variant_count ? rng() % scoped_variant_count : argument();
 			case Arg::IDX_ARRAY:
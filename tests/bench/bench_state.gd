@@ -0,0 +1,62 @@
+# Saving and restoring guest state, the way rollback netcode does every frame.
+#
+# A frame of game logic is test_step_game_state() in tests.elf: it writes to a
+# few pages of a 32 KiB array and leaves the rest of guest memory alone. Rollback
+# saves one state per frame and, when a late input arrives, restores an older
+# state and replays from there -- up to 8 times per frame -- so save and restore
+# latency is what decides how many frames can be rolled back.
+extends "res://bench/bench_harness.gd"
+
+const FRAMES := 8
+const ENTITIES := 200
+const REPS := 100
+
+func _frame(s: Sandbox, frame: int) -> void:
+	s.vmcall("test_step_game_state", frame, ENTITIES)
+
+func test_bench_save_restore_state():
+	var s : Sandbox = Sandbox.new()
+	s.set_program(load("res://tests/tests.elf"))
+	if not s.has_function("test_step_game_state"):
+		s.free()
+		return
+	s.set_instructions_max(0)
+	var group := "save + restore state"
+
+	# The states of the last FRAMES frames, saved against one checkpoint.
+	var states : Array[PackedByteArray] = []
+	for frame in range(FRAMES):
+		states.append(s.save_state())
+		_frame(s, frame)
+
+	var save := func():
+		for r in range(REPS):
+			_frame(s, r)
+			s.save_state()
+	var restore := func():
+		for r in range(REPS):
+			_frame(s, r)
+			s.restore_state(states[r % FRAMES])
+	var step := func():
+		for r in range(REPS):
+			_frame(s, r)
+	var rollback := func():
+		for r in range(REPS):
+			_frame(s, r)
+			s.rollback()
+	# Every case runs the same frame first, so that there is something to save or
+	# restore, and "frame only" is what the others cost on top of it.
+	_bench(group, "frame only", REPS, step, "frame")
+	_bench(group, "frame + save_state()", REPS, save, "frame")
+	_bench(group, "frame + restore_state()", REPS, restore, "frame")
+	_bench(group, "frame + rollback()", REPS, rollback, "frame")
+	_note(group, "mode", _mode(s))
+	_note(group, "state_bytes", states[FRAMES - 1].size())
+	_report(group, "frame only")
+
+	# The states saved before the timing must still restore after it.
+	assert_true(s.restore_state(states[0]), "the oldest state should restore")
+	s.free()
+
+func after_all():
+	_persist()
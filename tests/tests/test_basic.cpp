@@ -28,6 +28,22 @@ PUBLIC Variant test_static_storage(Variant key, Variant val) {
 	d[key] = val;
 	return d;
 }
+
+// Deterministic game state for the rollback tests, a few pages of guest memory.
+static int64_t game_state[4096];
+
+PUBLIC Variant test_step_game_state(long frame, long entities) {
+	for (long i = 0; i < entities; i++) {
+		int64_t &value = game_state[(i * 67) % 4096];
+		value = value * 31 + frame + i;
+	}
+	int64_t checksum = 0;
+	for (int64_t value : game_state) {
+		checksum = checksum * 7 + value;
+	}
+	return checksum;
+}
+
 PUBLIC Variant test_failing_static_storage(Variant key, Variant val) {
 	// This works only once: it's being created after initialization
 	static Dictionary fd = Dictionary::Create();
@@ -59,6 +75,62 @@ PUBLIC Variant test_permanent_dict(Dictionary input) {
 	return pd;
 }
 
+PUBLIC Variant test_release_permanent(long rounds) {
+	// Many more permanent Variants than there are slots, one at a time.
+	for (long i = 0; i < rounds; i++) {
+		Variant d = Dictionary::Create();
+		d.make_permanent();
+		d.release_permanent();
+	}
+	Variant kept = Array::Create();
+	kept.make_permanent();
+	return kept;
+}
+
+// Small blocks of every size class, grown and freed out of order.
+PUBLIC Variant test_small_allocations(long rounds) {
+	std::vector<char *> blocks;
+	long checksum = 0;
+	for (long i = 0; i < rounds; i++) {
+		const size_t size = 1 + (i * 37) % 1024;
+		char *block = (char *)malloc(size);
+		memset(block, i & 0xFF, size);
+		block = (char *)realloc(block, size + 100);
+		checksum += (unsigned char)block[size - 1];
+		blocks.push_back(block);
+		if (i % 3 == 2) {
+			free(blocks[blocks.size() / 2]);
+			blocks.erase(blocks.begin() + blocks.size() / 2);
+		}
+	}
+	for (char *block : blocks) {
+		free(block);
+	}
+	return checksum;
+}
+
+PUBLIC Variant test_touch_memory(long bytes) {
+	// Written through a volatile pointer, as the compiler may otherwise drop writes
+	// to a block that is freed right after.
+	volatile char *block = (volatile char *)malloc(bytes);
+	for (long i = 0; i < bytes; i++) {
+		block[i] = 1;
+	}
+	free((void *)block);
+	return Nil;
+}
+
+PUBLIC Variant test_stale_permanent() {
+	Variant a = Array::Create();
+	a.make_permanent();
+	Variant copy = a;
+	a.release_permanent();
+	// Takes the slot that a had, which the copy must not reach.
+	Variant b = Dictionary::Create();
+	b.make_permanent();
+	return copy;
+}
+
 PUBLIC Variant test_check_if_permanent(String test) {
 	if (test == "string") {
 		printf("Checking if string %d is permanent\n", ps.get_variant_index());
@@ -233,14 +305,81 @@ PUBLIC Variant test_array_assign2(Array arr, const size_t idx) {
 	return arr;
 }
 
+// Iterating fetches a chunk of elements per system call, and a range is written in one.
+PUBLIC Variant test_array_sum(Array arr) {
+	int64_t sum = 0;
+	for (const Variant &v : arr) {
+		sum += int64_t(v);
+	}
+	return sum;
+}
+PUBLIC Variant test_array_set_range(Array arr) {
+	std::vector<Variant> values(arr.size());
+	values.resize(arr.get_range(0, values.data(), values.size()));
+	for (Variant &v : values) {
+		v = int64_t(v) * 2;
+	}
+	arr.set_range(0, values.data(), values.size());
+	return arr;
+}
+
 PUBLIC Variant test_dict(Dictionary arg) {
 	return arg;
 }
 
+PUBLIC Variant test_dict_sum(Dictionary dict) {
+	int64_t sum = 0;
+	for (const auto &[key, value] : dict) {
+		sum += int64_t(key) * int64_t(value);
+	}
+	return sum;
+}
+PUBLIC Variant test_dict_set_entries(Dictionary dict) {
+	DictionaryEntry entries[3] = { { 1, "one" }, { 2, "two" }, { 3, "three" } };
+	dict.set_entries(entries, 3);
+	return dict;
+}
+
 PUBLIC Variant test_sub_dictionary(Dictionary dict) {
 	return Dictionary(dict["1"].value());
 }
 
+// The same call site, called on objects of different classes in turn.
+PUBLIC Variant test_call_site_classes(Array objects) {
+	Array classes = Array::Create();
+	for (int i = 0; i < objects.size(); i++) {
+		classes.push_back(objects[i].get().as_object().get_class());
+	}
+	return classes;
+}
+
+// A hash that does not match the engine's method is refused, instead of trusted.
+PUBLIC Variant test_ptrcall_wrong_hash(Object node) {
+	node.ptrcall<void>("set_position", 0u, Vector2(1, 2));
+	return "Fail";
+}
+
+// Looked up from the same string literal every time.
+PUBLIC Variant test_get_grandchild(Node base) {
+	return base.get_node("Child/Grandchild");
+}
+
+// Names interned once, and passed as handles from then on.
+PUBLIC Variant test_interned_names(Node base) {
+	static const Name path = Name::node_path("Child/Grandchild");
+	static const Name name = Name::intern("name");
+	static const Name get_class = Name::intern("get_class");
+	static const Name editor_description = Name::intern("editor_description");
+	Node node = base.get_node(path);
+	node.set(editor_description, "Interned");
+	Array result = Array::Create();
+	result.push_back(node.get(name));
+	result.push_back(node.call(get_class));
+	result.push_back(node.get(editor_description));
+	result.push_back(Name::intern("name").handle() == name.handle());
+	return result;
+}
+
 PUBLIC Variant test_rid(RID rid) {
 	return rid;
 }
@@ -277,6 +416,27 @@ PUBLIC Variant test_reused_name_buffer(Object obj) {
 	return results;
 }
 
+// Writes are held back until the call returns, and a read applies the ones before it.
+// More writes than fit in the buffer apply it early, in the order they were made.
+PUBLIC Variant test_deferred_writes(Object obj2d, Object other2d, Object obj3d) {
+	Node2D a(obj2d), b(other2d);
+	Node3D c(obj3d);
+	set_deferred_writes(true);
+
+	a.set_position(Vector2(1, 2));
+	b.set_rotation(0.5f);
+	c.set_position(Vector3(1, 2, 3));
+	a.set("z_index", 4);
+	const Vector2 read_back = a.get_position();
+
+	for (int i = 0; i < 300; i++) {
+		b.set_scale(Vector2(i, i));
+	}
+	a.set_position(Vector2(5, 6));
+	b.queue_free();
+	return read_back;
+}
+
 PUBLIC Variant test_basis(Basis basis) {
 	Basis b = basis;
 	return b;
@@ -344,6 +504,24 @@ PUBLIC Variant test_pa_string(PackedArray<std::string> arr) {
 	return PackedArray<std::string> (arr.fetch());
 }
 
+// Mapped arrays are used in place. A large array is mostly the host's own storage, with only
+// its first and last page copied, and a small one is only copies.
+PUBLIC Variant test_pa_map_sum(PackedArray<float> arr) {
+	double sum = 0.0;
+	for (float f : arr.map()) {
+		sum += f;
+	}
+	return sum;
+}
+PUBLIC Variant test_pa_map_double(PackedArray<Vector3> arr) {
+	auto view = arr.map(true);
+	for (Vector3 &v : view) {
+		v = v * 2.0f;
+	}
+	view.commit();
+	return arr;
+}
+
 PUBLIC Variant test_create_pa_u8() {
 	PackedByteArray arr({ 1, 2, 3, 4 });
 	return arr;
@@ -467,6 +645,13 @@ PUBLIC Variant test_exception() {
 	return "This should not be reached";
 }
 
+PUBLIC Variant test_int_or_exception(long value) {
+	if (value < 0) {
+		asm volatile("unimp");
+	}
+	return value;
+}
+
 static bool timer_got_called = false;
 PUBLIC Variant test_timers() {
 	long val1 = 11;
@@ -599,6 +784,12 @@ PUBLIC Variant test_many_unboxed_arguments2(int a1, int a2, int a3, int a4, int
 	return int(a1) + int(a2) + int(a3) + int(a4) + int(a5) + int(a6) + int(a7) + int(v1.x) + int(v1.y) + int(v2.x) + int(v2.y) + int(v3.x) + int(v3.y) + int(v4.x) + int(v4.y);
 }
 
+// Published with a signature, which lets the host place its arguments without looking at them.
+static Variant test_typed_call_stub(long i, double f, Vector2 v2, Vector3i v3i, Color c, String s) {
+	return i + int(f) + int(v2.x + v2.y) + v3i.x + v3i.y + v3i.z + int(c.r + c.a) + s.size();
+}
+static const bool test_typed_call_stub_added = (ADD_API_FUNCTION(test_typed_call_stub, "int", "int i, double f, Vector2 v2, Vector3i v3i, Color c, String s"), true);
+
 PUBLIC Variant get_tree_base_parent() {
 	return get_parent();
 }
@@ -54,6 +54,7 @@ func test_instantiation():
 
 	# Create a new sandbox from a buffer
 	var buffer : PackedByteArray = Sandbox_TestsTests.get_content()
+	assert_eq(buffer, FileAccess.get_file_as_bytes(Sandbox_TestsTests.resource_path), "Content is the program file")
 	for i in 10:
 		var s2 = Sandbox.FromBuffer(buffer)
 		assert_true(s2.has_program_loaded(), "Program loaded from buffer")
@@ -114,6 +115,30 @@ func test_environment():
 	s.queue_free()
 
 
+func test_name_cache():
+	var s = Sandbox.new()
+	s.set_program(Sandbox_TestsTests)
+	assert_eq(s.get_name_cache_size(), 128)
+	assert_eq(s.get_function_cache_size(), 16)
+	# Rounded up to whole sets of 4 entries
+	s.set_name_cache_size(5)
+	assert_eq(s.get_name_cache_size(), 8)
+
+	# Once a name is in the cache, calling with it again never misses
+	var n : Node = Node.new()
+	assert_eq_deep(s.vmcall("test_call_site_classes", [n]), ["Node"])
+	var before : Dictionary = s.get_name_cache_stats()
+	assert_eq_deep(s.vmcall("test_call_site_classes", [n, n, n]), ["Node", "Node", "Node"])
+	var after : Dictionary = s.get_name_cache_stats()
+	assert_eq(after["names"]["size"], 8)
+	assert_eq(after["names"]["misses"], before["names"]["misses"])
+	assert_eq(after["names"]["hits"], before["names"]["hits"] + 3)
+	assert_eq(after["functions"]["size"], 16)
+
+	n.free()
+	s.queue_free()
+
+
 func test_binary_translation():
 	# Create a new sandbox
 	var s = Sandbox.new()
@@ -171,6 +196,47 @@ func test_binary_translation_properties():
 	s.queue_free()
 
 
+func test_jit_tier_up():
+	var s = Sandbox.new()
+	assert_eq(s.jit_tier_up_threshold, 0)
+	s.jit_tier_up_threshold = -1
+	assert_eq(s.jit_tier_up_threshold, 0)
+	s.jit_tier_up_threshold = 3
+	s.set_program(Sandbox_TestsTests)
+	assert_eq(s.monitor_jit_tier_ups, 0)
+
+	# The program is interpreted until it has been called 3 times, counted across every
+	# sandbox running it, so only this sandbox's own calls are certain to be counted.
+	var tiered : bool = Sandbox.is_jit_enabled() and not s.is_binary_translated()
+	var entries : int = s.monitor_jit_entries
+	for i in range(3):
+		assert_eq(s.vmcall("test_ping_pong", i), i)
+	if Sandbox.is_jit_enabled():
+		assert_true(s.monitor_jit_entries > entries)
+	else:
+		assert_eq(s.monitor_jit_entries, entries)
+	assert_eq(s.monitor_jit_tier_ups, 1 if tiered else 0)
+
+	# Once tiered up, calls are no longer counted, and keep returning the same results.
+	entries = s.monitor_jit_entries
+	for i in range(3):
+		assert_eq(s.vmcall("test_ping_pong", i), i)
+	assert_eq(s.monitor_jit_entries, entries)
+	assert_eq(s.monitor_jit_tier_ups, 1 if tiered else 0)
+
+	# Another sandbox running the program is past the shared threshold on its first call,
+	# and switches to the code compiled for the first one instead of compiling it again.
+	var s2 = Sandbox.new()
+	s2.jit_tier_up_threshold = 3
+	s2.set_program(Sandbox_TestsTests)
+	assert_eq(s2.vmcall("test_ping_pong", 1), 1)
+	assert_eq(s2.monitor_jit_tier_ups, 1 if tiered else 0)
+	assert_eq(s2.vmcall("test_ping_pong", 2), 2)
+
+	s2.queue_free()
+	s.queue_free()
+
+
 func test_types():
 	# Create a new sandbox
 	var s = Sandbox.new()
@@ -246,6 +312,47 @@ func test_types():
 	var n3d : Node3D = Node3D.new()
 	n3d.name = "Node3D"
 	assert_eq(s.vmcall("test_object", n3d), n3d)
+	# Method calls are cached per call site, and the class may change between calls
+	var n2d : Node2D = Node2D.new()
+	var classes : Array = s.vmcall("test_call_site_classes", [n3d, n3d, n2d, n3d, n2d, n2d])
+	assert_eq_deep(classes, ["Node3D", "Node3D", "Node2D", "Node3D", "Node2D", "Node2D"])
+	# Calls with native arguments are checked against the engine's own method
+	var exceptions = s.get_exceptions()
+	assert_eq(s.vmcall("test_ptrcall_wrong_hash", n2d), null)
+	assert_engine_error("Method cannot be called with native arguments: set_position")
+	assert_engine_error("Exception: Method cannot be called with native arguments: set_position")
+	assert_eq(s.get_exceptions(), exceptions + 1)
+	assert_eq(n2d.position, Vector2(0, 0))
+	# Node paths are cached, and checked against the tree on every lookup
+	var base : Node = Node.new()
+	var child : Node = Node.new()
+	child.name = "Child"
+	base.add_child(child)
+	var grandchild : Node = Node.new()
+	grandchild.name = "Grandchild"
+	child.add_child(grandchild)
+	assert_eq(s.vmcall("test_get_grandchild", base), grandchild)
+	assert_eq(s.vmcall("test_get_grandchild", base), grandchild)
+	grandchild.name = "Renamed"
+	var replacement : Node = Node.new()
+	replacement.name = "Grandchild"
+	child.add_child(replacement)
+	assert_eq(s.vmcall("test_get_grandchild", base), replacement)
+	child.remove_child(replacement)
+	grandchild.name = "Grandchild"
+	var moved : Node = Node.new()
+	moved.name = "Child"
+	child.name = "Old"
+	base.add_child(moved)
+	child.remove_child(grandchild)
+	moved.add_child(grandchild)
+	assert_eq(s.vmcall("test_get_grandchild", base), grandchild)
+	# Names can be interned once, and passed as handles
+	for i in 2:
+		assert_eq_deep(s.vmcall("test_interned_names", base), ["Grandchild", "Node", "Interned", true])
+	replacement.free()
+	base.free()
+	n2d.queue_free()
 	n3d.queue_free()
 
 	# Array, Dictionary and String as references
@@ -257,6 +364,20 @@ func test_types():
 	a_pp.clear()
 	assigned_array = [0, 1, 2, 3, 4, 5, 6, 7, 8]
 	assert_eq_deep(s.vmcall("test_array_assign2", a_pp), assigned_array)
+	# Arrays and Dictionaries transferred a chunk at a time
+	for count in [0, 5, 100]:
+		var a_range : Array = []
+		var d_range : Dictionary = {}
+		for i in count:
+			a_range.push_back(i)
+			d_range[i] = i + 1
+		assert_eq(s.vmcall("test_array_sum", a_range), count * (count - 1) / 2)
+		assert_eq(s.vmcall("test_dict_sum", d_range), (count - 1) * count * (count + 1) / 3)
+		assert_same(s.vmcall("test_array_set_range", a_range), a_range)
+		if count > 0:
+			assert_eq(a_range[count - 1], 2 * (count - 1))
+	var d_entries : Dictionary = {3: "3"}
+	assert_eq_deep(s.vmcall("test_dict_set_entries", d_entries), {1: "one", 2: "two", 3: "three"})
 	var d_pp : Dictionary
 	assert_same(s.vmcall("test_dict", d_pp), d_pp)
 	var s_pp : String = "12345"
@@ -284,6 +405,20 @@ func test_types():
 	assert_eq_deep(s.vmcall("test_pa_color", pa_color_pp), pa_color_pp)
 	var pa_string_pp : PackedStringArray = ["Hello", "from", "the", "other", "side"]
 	assert_eq_deep(s.vmcall("test_pa_string", pa_string_pp), pa_string_pp)
+	# Packed arrays mapped into the guest
+	for count in [3, 20000]:
+		var pfa32_map : PackedFloat32Array
+		var pa_vec3_map : PackedVector3Array
+		for i in count:
+			pfa32_map.push_back(i)
+			pa_vec3_map.push_back(Vector3(i, -i, 1))
+		assert_eq(s.vmcall("test_pa_map_sum", pfa32_map), count * (count - 1) / 2.0)
+		var doubled : PackedVector3Array = s.vmcall("test_pa_map_double", pa_vec3_map)
+		assert_eq(doubled.size(), count)
+		assert_eq(doubled[0], Vector3(0, 0, 2))
+		assert_eq(doubled[count - 1], Vector3(count - 1, 1 - count, 1) * 2)
+		# The caller's own array is left alone
+		assert_eq(pa_vec3_map[count - 1], Vector3(count - 1, 1 - count, 1))
 	# Packed arrays created in the guest
 	assert_eq(s.vmcall("test_create_pa_u8"), PackedByteArray([1, 2, 3, 4]))
 	assert_eq_deep(s.vmcall("test_create_pa_u8_ptr"), PackedByteArray([1, 2, 3, 4, 5, 6, 7, 8, 9, 10]))
@@ -422,6 +557,16 @@ func test_vmcallv():
 	assert_eq(s.has_function("test_many_unboxed_arguments2"), true)
 	assert_same(s.vmcall("test_many_unboxed_arguments2", 1, 2, 3, 4, 5, 6, 7, Vector2(8.0, 9.0), Vector2(10.0, 11.0), Vector2(12.0, 13.0), Vector2(14.0, 15.0)), 120)
 
+	# Arguments of the published types take the precomputed path, anything else the
+	# regular one, and both must arrive the same way.
+	assert_eq(s.has_function("test_typed_call_stub"), true)
+	var unboxed : bool = s.get_unboxed_arguments()
+	s.set_unboxed_arguments(true)
+	assert_same(s.vmcall("test_typed_call_stub", 1, 2.0, Vector2(3.0, 4.0), Vector3i(5, 6, 7), Color(8.0, 0.0, 0.0, 9.0), "1234"), 49)
+	assert_same(s.vmcall("test_typed_call_stub", true, 2.0, Vector2(3.0, 4.0), Vector3i(5, 6, 7), Color(8.0, 0.0, 0.0, 9.0), "1234"), 49)
+	assert_eq_deep(s.vmcall_batch("test_typed_call_stub", [[1, 2.0, Vector2(3.0, 4.0), Vector3i(5, 6, 7), Color(8.0, 0.0, 0.0, 9.0), "1234"]]), [49])
+	s.set_unboxed_arguments(unboxed)
+
 	s.queue_free()
 
 func execute_vmcallv_comparison(s : Sandbox, vmfunc : String):
@@ -686,8 +831,248 @@ func test_static_storage():
 	assert_eq_deep(pd, {"key": "value"})
 	assert_true(s.vmcall("test_check_if_permanent", "dict"), "Permanent dictionary is permanent")
 
+	# Released permanent Variants give their slots back
+	exceptions = s.get_exceptions()
+	assert_eq_deep(s.vmcall("test_release_permanent", s.get_max_refs() * 4), [])
+	assert_eq(s.get_exceptions(), exceptions, "No exceptions thrown")
+	# And handles to a released one no longer work, even once the slot is in use again
+	result = s.vmcall("test_stale_permanent")
+	assert_engine_error("Invalid permanent variant index")
+	assert_eq(result, null)
+
 	s.queue_free()
 
+func test_fork_from():
+	var t : Sandbox = Sandbox.new()
+	t.set_program(Sandbox_TestsTests)
+	assert_eq_deep(t.vmcallv("test_static_storage", "key", "value"), {"key": "value"})
+
+	# A fork starts out exactly where the template is right now
+	var f : Sandbox = Sandbox.new()
+	assert_true(f.fork_from(t), "Forked from template")
+	assert_true(f.has_program_loaded(), "Fork has the program loaded")
+	assert_eq_deep(f.get_functions(), t.get_functions())
+	assert_eq(f.vmcall("test_int", 1234), 1234)
+	assert_eq_deep(f.vmcallv("test_static_storage", "key2", "value2"), {"key": "value", "key2": "value2"})
+
+	# ... and from then on, neither sees the changes of the other
+	assert_eq_deep(t.vmcallv("test_static_storage", "key3", "value3"), {"key": "value", "key3": "value3"})
+	assert_eq_deep(f.vmcallv("test_static_storage", "key4", "value4"), {"key": "value", "key2": "value2", "key4": "value4"})
+
+	# Forks keep working after the template is gone
+	var f2 : Sandbox = Sandbox.new()
+	assert_true(f2.fork_from(t), "Forked from template again")
+	t.free()
+	assert_eq_deep(f2.vmcallv("test_static_storage", "key5", "value5"), {"key": "value", "key3": "value3", "key5": "value5"})
+
+	# Forking from a fork
+	var f3 : Sandbox = Sandbox.new()
+	assert_true(f3.fork_from(f2), "Forked from a fork")
+	assert_eq(f3.vmcall("test_int", 5678), 5678)
+
+	# Invalid templates
+	var empty : Sandbox = Sandbox.new()
+	assert_false(f.fork_from(empty), "Cannot fork from an empty sandbox")
+	assert_engine_error("Can only fork from a sandbox that has finished initializing a program.")
+	assert_true(f.has_program_loaded(), "Failed fork leaves the sandbox as it was")
+
+	f.free()
+	f2.free()
+	f3.free()
+	empty.free()
+
+func test_snapshot_file():
+	var path = "user://test_snapshot_file.snapshot"
+	var t : Sandbox = Sandbox.new()
+	t.set_program(Sandbox_TestsTests)
+	assert_eq_deep(t.vmcallv("test_static_storage", "key", "value"), {"key": "value"})
+	assert_true(t.save_snapshot(path), "Saved snapshot")
+
+	# Without a program, the one the snapshot was made from is used
+	var s : Sandbox = Sandbox.new()
+	assert_true(s.load_snapshot(path), "Loaded snapshot")
+	assert_true(s.has_program_loaded(), "Snapshot has the program loaded")
+	assert_eq(s.get_program(), Sandbox_TestsTests)
+	assert_eq_deep(s.get_functions(), t.get_functions())
+	assert_eq(s.vmcall("test_int", 1234), 1234)
+	assert_eq_deep(s.vmcallv("test_static_storage", "key2", "value2"), {"key": "value", "key2": "value2"})
+
+	# Loading again starts over from the snapshot
+	assert_true(s.load_snapshot(path), "Loaded snapshot again")
+	assert_eq_deep(s.vmcallv("test_static_storage", "key3", "value3"), {"key": "value", "key3": "value3"})
+
+	# Snapshots only work with the program they were made from
+	var other : Sandbox = Sandbox.new()
+	var other_program : PackedByteArray = Sandbox_TestsTests.get_content()
+	other_program.append(0)
+	other.load_buffer(other_program)
+	assert_false(other.load_snapshot(path), "Cannot load a snapshot of another program")
+	assert_engine_error("Sandbox: Snapshot was made from a different program: " + path)
+	assert_false(s.load_snapshot("user://does_not_exist.snapshot"), "Cannot load a missing snapshot")
+	assert_engine_error("Sandbox: Failed to open snapshot file: user://does_not_exist.snapshot")
+
+	t.free()
+	s.free()
+	other.free()
+	DirAccess.remove_absolute(path)
+
+func test_checkpoint_rollback():
+	var s : Sandbox = Sandbox.new()
+	assert_false(s.checkpoint(), "Cannot make a checkpoint without a program")
+	assert_engine_error("Sandbox: Cannot make a checkpoint without a program, or during a VM call.")
+	s.set_program(Sandbox_TestsTests)
+	assert_eq(s.rollback(), -1, "No checkpoint to roll back to")
+	assert_engine_error("Sandbox: There is no checkpoint to roll back to.")
+
+	assert_eq_deep(s.vmcallv("test_static_storage", "key", "value"), {"key": "value"})
+	assert_true(s.checkpoint(), "Made a checkpoint")
+	assert_eq_deep(s.vmcallv("test_static_storage", "key2", "value2"), {"key": "value", "key2": "value2"})
+	assert_gt(s.rollback(), 0, "Pages were restored")
+
+	# The checkpoint is kept, and can be rolled back to again and again
+	for i in range(3):
+		assert_eq_deep(s.vmcallv("test_static_storage", "key3", "value3"), {"key": "value", "key3": "value3"})
+		s.rollback()
+
+	# A new checkpoint replaces the old one
+	assert_eq_deep(s.vmcallv("test_static_storage", "key4", "value4"), {"key": "value", "key4": "value4"})
+	assert_true(s.checkpoint(), "Made another checkpoint")
+	assert_eq(s.rollback(), 0, "Nothing was written since the checkpoint")
+	assert_eq_deep(s.vmcallv("test_static_storage", "key5", "value5"), {"key": "value", "key4": "value4", "key5": "value5"})
+	s.rollback()
+	assert_eq_deep(s.vmcallv("test_static_storage", "key6", "value6"), {"key": "value", "key4": "value4", "key6": "value6"})
+
+	# Forking from the sandbox drops its checkpoint
+	var f : Sandbox = Sandbox.new()
+	assert_true(f.fork_from(s), "Forked from the sandbox")
+	assert_eq(s.rollback(), -1, "Checkpoint was dropped")
+	assert_engine_error("Sandbox: There is no checkpoint to roll back to.")
+
+	# ... and so does resetting it
+	assert_true(s.checkpoint(), "Made a checkpoint after forking")
+	s.reset()
+	assert_eq(s.rollback(), -1, "Checkpoint was dropped")
+	assert_engine_error("Sandbox: There is no checkpoint to roll back to.")
+
+	s.free()
+	f.free()
+
+func test_memory_committed():
+	var s : Sandbox = Sandbox.new()
+	s.set_program(Sandbox_TestsTests)
+	assert_gt(s.monitor_memory_reserved, 0)
+	assert_between(s.monitor_memory_committed, 1, s.monitor_memory_reserved)
+
+	# Memory is backed as the program uses it, and given back on rolling back
+	assert_true(s.checkpoint(), "Made a checkpoint")
+	var committed : int = s.monitor_memory_committed
+	s.vmcall("test_touch_memory", 4 << 20)
+	var touched : int = s.monitor_memory_committed
+	assert_gt(touched, committed + (2 << 20), "Touched memory is committed")
+	assert_gt(s.rollback(), 0, "Pages were restored")
+	assert_lt(s.monitor_memory_committed, touched - (2 << 20), "Memory used since the checkpoint was given back")
+
+	s.free()
+
+func test_save_restore_state():
+	var s : Sandbox = Sandbox.new()
+	s.set_program(Sandbox_TestsTests)
+
+	# One state per frame, as rollback netcode keeps them
+	var states : Array[PackedByteArray] = []
+	var checksums : Array[int] = []
+	for frame in range(8):
+		states.append(s.save_state())
+		checksums.append(s.vmcall("test_step_game_state", frame, 100 + frame * 10))
+
+	# Every state restores on its own, in any order, and replays the same frames
+	for frame in [5, 2, 7, 0, 3]:
+		assert_true(s.restore_state(states[frame]), "Restored frame %d" % frame)
+		for f in range(frame, 8):
+			assert_eq(s.vmcall("test_step_game_state", f, 100 + f * 10), checksums[f], "Replayed frame %d from %d" % [f, frame])
+
+	# The permanent Variants go back too
+	assert_true(s.restore_state(states[0]))
+	assert_eq_deep(s.vmcallv("test_static_storage", "key", "value"), {"key": "value"})
+	var with_key := s.save_state()
+	assert_eq_deep(s.vmcallv("test_static_storage", "key2", "value2"), {"key": "value", "key2": "value2"})
+	assert_true(s.restore_state(with_key))
+	assert_eq_deep(s.vmcallv("test_static_storage", "key3", "value3"), {"key": "value", "key3": "value3"})
+	assert_true(s.restore_state(states[0]))
+	assert_eq_deep(s.vmcallv("test_static_storage", "key4", "value4"), {"key4": "value4"})
+
+	# States are only good for the checkpoint they were saved against
+	assert_true(s.checkpoint())
+	assert_false(s.restore_state(states[1]), "Cannot restore a state from an earlier checkpoint")
+	assert_engine_error("Sandbox: State was saved against another checkpoint.")
+	assert_false(s.restore_state(PackedByteArray([1, 2, 3])), "Cannot restore garbage")
+	assert_engine_error("Sandbox: Not a saved state.")
+	var damaged := s.save_state()
+	damaged.resize(damaged.size() - 1)
+	assert_false(s.restore_state(damaged), "Cannot restore a damaged state")
+	assert_engine_error("Sandbox: Saved state is damaged.")
+
+	s.free()
+
+func test_vmcall_batch():
+	var s : Sandbox = Sandbox.new()
+	s.set_program(Sandbox_TestsTests)
+	var calls_made = s.get_calls_made()
+
+	# Single arguments, argument tuples and packed arrays
+	assert_eq_deep(s.vmcall_batch("test_int", [1, 2, 3]), [1, 2, 3])
+	assert_eq_deep(s.vmcall_batch("test_int", [[4], [5]]), [4, 5])
+	assert_eq_deep(s.vmcall_batch("test_int", PackedInt64Array([6, 7])), [6, 7])
+	assert_eq_deep(s.vmcall_batch("test_int", []), [])
+	assert_eq(s.get_calls_made(), calls_made + 7, "Every call in a batch is counted")
+
+	# Calls see the effects of the calls before them
+	var results = s.vmcall_batch("test_static_storage", [["a", 1], ["b", 2]])
+	assert_eq(results.size(), 2)
+	assert_eq_deep(results[1], {"a": 1, "b": 2})
+
+	# Batches are equivalent to calling vmcall() for each entry
+	assert_eq(s.vmcall_batch("test_string", ["1234"])[0], s.vmcall("test_string", "1234"))
+
+	# A call that fails returns null, and the calls after it still run
+	var exceptions = s.get_exceptions()
+	assert_eq_deep(s.vmcall_batch("test_int_or_exception", [1, -1, 3]), [1, null, 3])
+	assert_eq(s.get_exceptions(), exceptions + 1)
+	s.set_precise_simulation(true)
+	assert_eq_deep(s.vmcall_batch("test_int_or_exception", [4, -1, 6]), [4, null, 6])
+	assert_eq(s.get_exceptions(), exceptions + 2)
+	s.set_precise_simulation(false)
+
+	assert_eq_deep(s.vmcall_batch("does_not_exist", [1]), [])
+	assert_engine_error("Function not found: does_not_exist (Added to the public API?)")
+
+	s.free()
+
+func test_vmcall_async():
+	var s : Sandbox = Sandbox.new()
+	s.set_program(Sandbox_TestsTests)
+	s.vmcall("test_static_storage", "a", 1)
+
+	var call = s.vmcall_async("test_int", [1234])
+	assert_not_null(call)
+	assert_eq(await call.completed, 1234)
+	assert_true(call.is_completed())
+	assert_eq(call.get_result(), 1234)
+
+	# The call runs in a fork: it sees the state before the call, and does not change it
+	call = s.vmcall_async("test_static_storage", ["b", 2])
+	assert_eq_deep(call.wait(), {"a": 1, "b": 2})
+	assert_eq_deep(s.vmcall("test_static_storage", "c", 3), {"a": 1, "c": 3})
+
+	# System calls are run on the main thread while the worker waits
+	call = s.vmcall_async("test_fetch_string", ["1234"])
+	assert_eq(await call.completed, "1234")
+
+	assert_null(s.vmcall_async("does_not_exist"))
+	assert_engine_error("Function not found: does_not_exist (Added to the public API?)")
+
+	s.free()
+
 func callable_function():
 	return
 
@@ -727,6 +1112,27 @@ func test_reused_name_buffer():
 	n.queue_free()
 	s.queue_free()
 
+func test_deferred_writes():
+	var s : Sandbox = Sandbox.new()
+	s.set_program(Sandbox_TestsTests)
+
+	var a : Node2D = Node2D.new()
+	var b : Node2D = Node2D.new()
+	var c : Node3D = Node3D.new()
+	# Reading a value back applies the writes before it
+	assert_eq(s.vmcall("test_deferred_writes", a, b, c), Vector2(1, 2))
+	# The rest are applied when the call returns
+	assert_eq(a.position, Vector2(5, 6))
+	assert_eq(a.z_index, 4)
+	assert_eq(b.rotation, 0.5)
+	assert_eq(b.scale, Vector2(299, 299))
+	assert_true(b.is_queued_for_deletion())
+	assert_eq(c.position, Vector3(1, 2, 3))
+
+	a.queue_free()
+	c.queue_free()
+	s.queue_free()
+
 func test_variant_slot_reuse():
 	var s : Sandbox = Sandbox.new()
 	s.set_program(Sandbox_TestsTests)
@@ -752,3 +1158,19 @@ func test_string_mutation():
 	assert_eq(s.vmcall("test_permanent_string_append"), "perm++")
 
 	s.queue_free()
+
+func test_small_allocations():
+	var s : Sandbox = Sandbox.new()
+	s.set_program(Sandbox_TestsTests)
+
+	var chunks : int = s.monitor_heap_chunk_count
+	var allocations : int = s.monitor_heap_allocation_counter
+	var expected : int = 0
+	for i in range(3000):
+		expected += i & 0xFF
+	assert_eq(s.vmcall("test_small_allocations", 3000), expected)
+	# Every block was freed, whether the guest or the host heap handed it out
+	assert_eq(s.monitor_heap_chunk_count, chunks)
+	assert_true(s.monitor_heap_allocation_counter >= allocations + 3000, "Small blocks are counted")
+
+	s.queue_free()
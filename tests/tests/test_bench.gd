@@ -77,6 +77,18 @@ func test_bench_obj_callp():
 		for i in range(n):
 			_gds_get_name(node))
 
+	# The same calls made one at a time versus as one batch, 2000 per batch.
+	var batch : Array = []
+	batch.resize(2000)
+	batch.fill(node)
+	_bench("roundtrip: empty x2000", func(n):
+		for i in range(n / batch.size()):
+			for arg in batch:
+				call_nothing.call(arg))
+	_bench("vmcall_batch: empty x2000", func(n):
+		for i in range(n / batch.size()):
+			s.vmcall_batch("bench_single_nothing", batch))
+
 	assert_true(true)
 	s.queue_free()
 	node.queue_free()
@@ -0,0 +1,48 @@
+extends GutTest
+
+var Sandbox_TestsTests = load("res://tests/tests.elf")
+
+func test_sandbox_group():
+	var group = SandboxGroup.new()
+	group.thread_count = 4
+	var sandboxes : Array = []
+	for i in 16:
+		var s : Sandbox = Sandbox.new()
+		s.set_program(Sandbox_TestsTests)
+		sandboxes.append(s)
+		group.add_sandbox(s)
+	group.add_sandbox(sandboxes[0])
+	assert_eq(group.get_sandbox_count(), 16, "A sandbox is only added once")
+
+	var results = group.vmcall_all("test_int", [1234])
+	assert_eq(results.size(), 16)
+	for r in results:
+		assert_eq(r, 1234)
+
+	# Each sandbox has its own guest state
+	sandboxes[0].vmcall("test_static_storage", "a", 1)
+	results = group.vmcall_all("test_static_storage", ["b", 2])
+	assert_eq_deep(results[0], {"a": 1, "b": 2})
+	for i in range(1, 16):
+		assert_eq_deep(results[i], {"b": 2})
+
+	# System calls are run on the main thread while the workers wait
+	results = group.vmcall_all("test_fetch_string", ["1234"])
+	for r in results:
+		assert_eq(r, "1234")
+	assert_gt(group.monitor_main_thread_calls, 0)
+
+	# Freed sandboxes are dropped from the group
+	sandboxes.pop_back().free()
+	assert_eq(group.vmcall_all("test_int", [5]).size(), 15)
+	assert_eq(group.get_sandbox_count(), 15)
+	group.remove_sandbox(sandboxes[0])
+	assert_eq(group.get_sandbox_count(), 14)
+
+	results = group.vmcall_all("does_not_exist")
+	assert_eq(results.size(), 14)
+	assert_null(results[0])
+	assert_engine_error("Function not found: does_not_exist (Added to the public API?)")
+
+	for s in sandboxes:
+		s.free()
@@ -0,0 +1,37 @@
+extends GutTest
+
+var Sandbox_TestsTests = load("res://tests/tests.elf")
+
+func test_sandbox_pool():
+	var pool = SandboxPool.new()
+	pool.pool_size = 4
+	pool.program = Sandbox_TestsTests
+	assert_eq(pool.get_available(), 4, "Pool is filled when the program is set")
+
+	var s : Sandbox = pool.acquire()
+	assert_true(s.has_program_loaded(), "Pooled sandbox has the program loaded")
+	assert_eq(pool.get_available(), 3)
+	assert_eq(s.vmcall("test_int", 1234), 1234)
+
+	# Dirty the static storage, then hand the sandbox back
+	assert_eq_deep(s.vmcallv("test_static_storage", "key", "value"), {"key": "value"})
+	pool.release(s)
+	assert_eq(pool.get_available(), 4)
+	assert_gt(pool.monitor_dirty_pages, 0, "Release restored the dirtied pages")
+
+	# Every sandbox comes out of the pool as it was right after main()
+	for i in 8:
+		var s2 : Sandbox = pool.acquire()
+		assert_eq_deep(s2.vmcallv("test_static_storage", "key2", "value2"), {"key2": "value2"})
+		pool.release(s2)
+	assert_eq(pool.monitor_hit_rate, 1.0, "All acquires were served from the pool")
+
+	# An empty pool creates new sandboxes, and releases past the pool size free them
+	var taken : Array = []
+	for i in 6:
+		taken.append(pool.acquire())
+	assert_eq(pool.get_available(), 0)
+	assert_lt(pool.monitor_hit_rate, 1.0, "Acquiring from an empty pool is a miss")
+	for t in taken:
+		pool.release(t)
+	assert_eq(pool.get_available(), 4)